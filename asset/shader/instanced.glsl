@@ -0,0 +1,40 @@
+#type vertex
+#version 460 core
+
+layout(location = 0) in vec2 a_Corner;		// Of the unit quad, per vertex
+
+layout(location = 1) in vec4 a_Axes;		// Per instance from here on
+layout(location = 2) in vec3 a_Origin;
+layout(location = 3) in vec4 a_Color;
+layout(location = 4) in vec4 a_TexCoords;
+layout(location = 5) in float a_TexIndex;
+
+uniform mat4 u_ViewProjection;
+
+out vec4 v_Color;
+out vec2 v_TexCoord;
+out float v_TexIndex;
+
+void main() {
+	v_TexCoord = mix(a_TexCoords.xy, a_TexCoords.zw, a_Corner + 0.5);
+	v_TexIndex = a_TexIndex;
+	v_Color = a_Color;
+
+	vec2 position = a_Origin.xy + a_Corner.x * a_Axes.xy + a_Corner.y * a_Axes.zw;
+	gl_Position = u_ViewProjection * vec4(position, a_Origin.z, 1.0);
+}
+
+#type fragment
+#version 460 core
+
+layout(location = 0) out vec4 color;
+
+in vec4 v_Color;
+in vec2 v_TexCoord;
+in float v_TexIndex;
+
+uniform sampler2D u_Textures[32];
+
+void main() {
+	color = texture(u_Textures[int(v_TexIndex)], v_TexCoord) * v_Color;
+}
@@ -47,19 +47,9 @@ public:
 		frame_buffer.resize(viewport_size);
 		::ImGui::Image(frame_buffer.color_attachment_id(), viewport_size, {0, 1}, {1, 0}); // {0, 1} {1, 0} to display it correctly and not inverted
 
-		rg::for_each(
-				ecs.view<component::Camera>()
-					| vw::filter([] (auto&& entt_cam) {
-							return std::get<1>(entt_cam).has_value();
-						}),
-				[&] (auto&& entt_comps) {
-					auto& cam = std::get<1>(entt_comps);
-					SAGE_ASSERT(cam.has_value());
-
-					if (not cam->has_fixed_aspect_ratio)
-						cam->camera.set_viewport_size(viewport_size);
-				}
-			);
+		for (auto&& [_, cam] : ecs.view<component::Camera>())
+			if (not cam.has_fixed_aspect_ratio)
+				cam.camera.set_viewport_size(viewport_size);
 
 
 		::ImGui::End();
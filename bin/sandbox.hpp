@@ -54,16 +54,15 @@ private:
 
 public:
 	Level(ECS& ecs) {
-		for (auto& e : map[0]) {
-			e = *ecs.create();
-			e.set(component::Name{"Tile of Dirt"}, component::Sprite{color_dirt});
-		}
+		const auto dirt = ecs.create_n(Prefab{component::Name{"Tile of Dirt"}, component::Sprite{color_dirt}}, rank);
+		const auto water = ecs.create_n(Prefab{component::Name{"Tile of Water"}, component::Sprite{color_water}}, rank * (rank - 1));
+		SAGE_ASSERT(dirt.size() == rank and water.size() == rank * (rank - 1));
 
-		for (auto& row : map | vw::drop(1))
-			for (auto& e : row) {
-				e = *ecs.create();
-				e.set(component::Name{"Tile of Water"}, component::Sprite{color_water});
-			}
+		for (const auto [e, handle] : vw::zip(map[0], dirt))
+			e = ECS::Entity{handle, &ecs};
+
+		for (const auto [e, handle] : vw::zip(map | vw::drop(1) | vw::join, water))
+			e = ECS::Entity{handle, &ecs};
 	}
 
 public:
@@ -79,7 +78,7 @@ public:
 
 		for (const auto& [x, row] : map | vw::enumerate)
 			for (const auto& [y, tile] : row | vw::enumerate)
-				renderer.draw(std::get<0>(*tile.components<component::Sprite>())->color,
+				renderer.draw(std::get<0>(*tile.components<const component::Sprite>())->color,
 						Simple_Args{ .position={x, map.size() - y, 0.f}, .size={1, 1} }
 					);
 
@@ -87,10 +86,10 @@ public:
 			auto comps = square.components();
 			SAGE_ASSERT(comps.has_value());
 
-			auto& sprite = std::get<std::optional<component::Sprite>&>(*comps);
-			auto& position = std::get<std::optional<component::Position>&>(*comps);
-			SAGE_ASSERT(sprite.has_value());
-			SAGE_ASSERT(position.has_value());
+			auto* sprite = std::get<component::Sprite*>(*comps);
+			auto* position = std::get<component::Position*>(*comps);
+			SAGE_ASSERT(sprite != nullptr);
+			SAGE_ASSERT(position != nullptr);
 
 			renderer.draw(sprite->color, Simple_Args{ .position=position->position, .size={1, 1} });
 		}
@@ -106,9 +105,9 @@ public:
 				auto comps = tile.components<component::Name, component::Sprite>();
 				SAGE_ASSERT(comps.has_value());
 
-				auto& [name, sprite] = *comps;
-				SAGE_ASSERT(name.has_value());
-				SAGE_ASSERT(sprite.has_value());
+				auto [name, sprite] = *comps;
+				SAGE_ASSERT(name != nullptr);
+				SAGE_ASSERT(sprite != nullptr);
 
 				if (y > 0)
 					ImGui::SameLine();
@@ -118,15 +117,12 @@ public:
 				ImGui::PushStyleColor(ImGuiCol_ButtonHovered,	ImVec4{sprite->color.r, sprite->color.g, sprite->color.b, sprite->color.a});
 				ImGui::PushStyleColor(ImGuiCol_ButtonActive,	ImVec4{sprite->color.r, sprite->color.g, sprite->color.b, sprite->color.a});
 
+				// Through set_components so that the name index follows
 				if (ImGui::Button(" ")) {
-					if (name->name.contains("Water")) {
-						name = component::Name{"Tile of Dirt"s};
-						sprite = component::Sprite{color_dirt};
-					}
-					else {
-						name = component::Name{"Tile of Water"s};
-						sprite = component::Sprite{color_water};
-					}
+					if (name->view().contains("Water"))
+						ecs.set_components(tile, component::Name{"Tile of Dirt"}, component::Sprite{color_dirt});
+					else
+						ecs.set_components(tile, component::Name{"Tile of Water"}, component::Sprite{color_water});
 				}
 
 				ImGui::PopStyleColor(3);
@@ -144,8 +140,8 @@ public:
 					if (square_is_valid) {
 						auto comps = square.components<component::Sprite>();
 						SAGE_ASSERT(comps.has_value());
-						auto& sprite = std::get<std::optional<component::Sprite>&>(*comps);
-						SAGE_ASSERT(sprite.has_value());
+						auto* sprite = std::get<component::Sprite*>(*comps);
+						SAGE_ASSERT(sprite != nullptr);
 						return glm::value_ptr(sprite->color);
 					}
 					else {
@@ -166,11 +162,11 @@ public:
 							[&] (const auto&... ns) {
 								(
 								 std::invoke([&, n = 0] mutable {
-										SAGE_ASSERT(ns.has_value());
+										SAGE_ASSERT(ns != nullptr);
 
 										static int item_current_idx = 0; // Here we store our selection data as an index.
 										static bool is_selected = false;
-										if (ImGui::Selectable(ns->name.c_str(), &is_selected))
+										if (ImGui::Selectable(ns->str().c_str(), &is_selected))
 											item_current_idx = n;
 
 										// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
@@ -200,12 +196,13 @@ public:
 				square = *ecs.create();
 				square.set(component::Name{"Square"s}, component::Sprite{}, component::Transform{}, component::Camera{}, component::Position{});
 
-				cam.set_position(std::get<0>(*square.components<component::Position>())->position);
+				cam.set_position(std::get<0>(*square.components<const component::Position>())->position);
 			}
 		}
 
 		ImGui::SameLine();
 		ImGui::Text(square.is_valid() ? "Zoom from square" : "Zoom from mouse scroll");
+		ImGui::Text("Entities: %zu, %s", ecs.size(), fmt::format("{}", ecs.memory()).c_str());
 
 		// Components
 		if (square.is_valid()) {
@@ -218,7 +215,7 @@ public:
 						[&] (auto&&... cs) {
 						(
 							std::invoke([&] {
-									using Cs = std::decay_t<decltype(cs)>::value_type;
+									using Cs = std::remove_pointer_t<std::decay_t<decltype(cs)>>;
 
 									ImGui::TableNextRow();
 
@@ -227,7 +224,7 @@ public:
 									ImGui::Text("%s", Cs::type_name().data());
 
 									ImGui::TableNextColumn();
-									ImGui::Text("%s", fmt::format("{}", cs).c_str());
+									ImGui::Text("%s", cs != nullptr ? fmt::format("{}", *cs).c_str() : "None");
 								})
 							, ...
 						);
@@ -238,8 +235,8 @@ public:
 				ImGui::EndTable();
 			}
 
-			auto& cam_comp = std::get<std::optional<component::Camera>&>(*comps);
-			SAGE_ASSERT(cam_comp.has_value());
+			auto* cam_comp = std::get<component::Camera*>(*comps);
+			SAGE_ASSERT(cam_comp != nullptr);
 
 			auto size = cam_comp->camera.size();
 			ImGui::DragFloat("Square Camera Size", &size, 0.25f, 0.25f, 30.f);
@@ -292,10 +289,15 @@ struct Rocket_Flame : particle::system::Base {
 	using Renderer = oslinux::Renderer_2D;
 	using User_State = Game_State;
 
+private:
+	std::vector<graphics::renderer::Sprite_Instance> sprites;	// Of the live particles, reused every frame
+
 public:
 	Rocket_Flame(const size_t max_particles = 100)
 		: Base{max_particles}
-	{}
+	{
+		sprites.reserve(max_particles);
+	}
 
 public:
 	auto update(const std::chrono::milliseconds dt, oslinux::Input& input, camera::Controller<Input>&, ECS&, Game_State& gs) -> void {
@@ -351,15 +353,18 @@ public:
 
 	auto render(oslinux::Renderer_2D& renderer, ECS&, Game_State&) -> void {
 		Base::render([&] (const auto& particles) {
-				rg::for_each(particles, [&] (const auto& p) {
-						using Simple_Args = oslinux::Renderer_2D::Simple_Args;
-						renderer.draw(p.properties.color, Simple_Args{
+				sprites.clear();
+				rg::transform(particles, std::back_inserter(sprites), [] (const auto& p) {
+						return graphics::renderer::Sprite_Instance{
 								.position = {p.properties.position, 1.f},
 								.size = {p.properties.size, p.properties.size},
-								.rotation = p.properties.rotation
-							});
+								.rotation = p.properties.rotation,
+								.color = p.properties.color,
+							};
 					});
 			});
+
+		renderer.draw_many(sprites);
 	}
 
 	auto event_callback(const Event&, camera::Controller<Input>&, ECS&, Game_State&) -> void {
@@ -58,7 +58,7 @@ public:
 		, renderer{profiler}
 		, layers{ImGui{&window}, Ls{}...}
 		, imgui{layers.front()}
-		, ecs{1000ul}
+		, ecs{1000ul, std::nullopt, profiler}
 		, user_state{ecs}
 	{
 		SAGE_LOG_DEBUG(*this);
@@ -99,6 +99,14 @@ public:
 					layers.update(delta, input, camera_controller, ecs, user_state);
 				}
 
+				{
+					PROFILER_TIME(profiler, "ECS Commands");
+
+					// Sync point for the structural changes recorded by the layers
+					ecs.play_commands();
+					ecs.notify_observers();
+				}
+
 				{
 					PROFILER_TIME(profiler, "Render Layers");
 
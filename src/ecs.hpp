@@ -5,12 +5,73 @@
 #include "src/math.hpp"
 #include "src/util.hpp"
 #include "src/camera.hpp"
+#include "src/job.hpp"
+#include "src/memory.hpp"
+#include "src/name.hpp"
+#include "src/perf.hpp"
 
 namespace sage::inline ecs {
 
 namespace entity {
 
-using ID = util::ID;
+// Packed index and generation of an entity slot.
+//
+// The generation of a slot is bumped every time its entity is destroyed, so a Handle that
+// outlived its entity will not match the slot once it is recycled. With 12 bits the generation
+// wraps after 4096 reuses of the same slot which is plenty for stale handle detection.
+struct Handle {
+	using Rep = uint32_t;
+	using Index = Rep;
+	using Generation = Rep;
+
+	static constexpr auto index_bits = 20u;
+	static constexpr auto generation_bits = util::bits<Rep> - index_bits;
+
+	static constexpr auto index_mask = Rep{(1u << index_bits) - 1};
+	static constexpr auto generation_mask = Rep{(1u << generation_bits) - 1};
+
+	// All index bits set is reserved for null so the ECS can hold at most null_index entities.
+	static constexpr auto null_index = index_mask;
+
+private:
+	Rep _raw;
+
+public:
+	constexpr Handle()
+		: _raw{std::numeric_limits<Rep>::max()}
+	{}
+
+	constexpr Handle(const Index idx, const Generation gen)
+		: _raw{((gen & generation_mask) << index_bits) | (idx & index_mask)}
+	{
+		SAGE_ASSERT(idx <= index_mask, "Index {} does not fit in {} bits", idx, index_bits);
+	}
+
+public:
+	constexpr auto index() const -> Index {
+		return _raw & index_mask;
+	}
+
+	constexpr auto generation() const -> Generation {
+		return _raw >> index_bits;
+	}
+
+	constexpr auto raw() const -> Rep {
+		return _raw;
+	}
+
+	constexpr auto is_null() const -> bool {
+		return index() == null_index;
+	}
+
+	constexpr auto operator<=> (const Handle&) const = default;
+
+public:
+	static constexpr auto null() -> Handle {
+		return {};
+	}
+};
+static_assert(sizeof(Handle) == sizeof(Handle::Rep));
 
 }// ecs::entity
 
@@ -30,533 +91,5203 @@ concept Concept =
 		return std::string_view{#klass};	\
 	}
 
-// TODO: The components need rework to be flexible. The problem is that if the templates
-//       are kept then the Components... cant really be passed to App...
-
-struct Name {
-private:
-	inline static auto counter = 1ul;
-
-public:
-	std::string name = fmt::format("Unamed Entity {}", counter++);
+// Components registered at runtime are referred to by the Id that Basic_ECS::register_component() returns
+using Id = uint32_t;
 
-	SAGE_ECS_TYPE_NAME_GETTER(Name)
+// What the ECS needs to store a component that it only knows at runtime, e.g. one described
+// by a data file. The functions work on raw, suitably aligned, memory.
+struct Info {
+	std::string_view name;
+	size_t size = 0;
+	size_t alignment = 1;
+	void (*construct)(void* at) = nullptr;				// Default construct
+	void (*relocate)(void* to, void* from) = nullptr;	// Move construct `to` from `from` and destroy `from`
+	void (*destroy)(void* at) = nullptr;
 };
 
-struct Transform {
-	glm::mat4 trans = math::identity<glm::mat4>;
-
-	SAGE_ECS_TYPE_NAME_GETTER(Transform)
-};
+template <Concept C>
+constexpr auto info_of() -> Info {
+	return {
+		.name = C::type_name(),
+		.size = sizeof(C),
+		.alignment = alignof(C),
+		.construct = [] (void* at) { std::construct_at(static_cast<C*>(at)); },
+		.relocate = [] (void* to, void* from) {
+				auto* c = static_cast<C*>(from);
+				std::construct_at(static_cast<C*>(to), std::move(*c));
+				std::destroy_at(c);
+			},
+		.destroy = [] (void* at) { std::destroy_at(static_cast<C*>(at)); },
+	};
+}
 
-struct Sprite {
-	glm::vec4 color = math::identity<glm::vec4>;
+namespace storage {
 
-	SAGE_ECS_TYPE_NAME_GETTER(Sprite)
-};
+using Index = entity::Handle::Index;
 
-struct Camera {
-	camera::Scene_Camera camera;
-	bool has_fixed_aspect_ratio = false;
+// Storage policies, a component picks one with a member alias otherwise it is Dense:
+//
+// struct Rare {
+//     using Storage = component::storage::Sparse;
+//     ...
+// };
+//
+// Dense:     One slot per entity. Fastest lookup but every entity pays for the component.
+// Sparse:    Sparse set. Only the entities that have the component pay for it (and an Index per entity)
+//            and iterating the component touches only them.
+// Archetype: Entities with the same set of Archetype components are stored together in chunks of
+//            SoA columns, so views over them stream contiguous memory. Adding/removing one of them
+//            moves the entity to another archetype which is the price to pay.
+// Tag:       Empty marker components, one bit per entity. Views of Tags (and Dense components)
+//            walk the set bits of the Tags a word at a time. Tags have no change ticks.
+struct Dense {};
+struct Sparse {};
+struct Archetype {};
+struct Tag {};
 
-	SAGE_ECS_TYPE_NAME_GETTER(Camera)
+template <typename C>
+struct Policy {
+	using Type = Dense;
 };
 
-struct Position {
-	glm::vec3 position;
-
-	SAGE_ECS_TYPE_NAME_GETTER(Position)
+template <typename C>
+	requires requires { typename C::Storage; }
+struct Policy<C> {
+	using Type = C::Storage;
 };
 
-#define _ALL_COMPONENTS \
-	component::Name,	\
-	component::Transform,	\
-	component::Sprite,	\
-	component::Camera,	\
-	component::Position
-	/* Add new component here with no comma at the end and dont forget the '\' at the end of the item above */
-
-}// sage::ecs::components
+template <typename C>
+using Policy_Of = Policy<C>::Type;
 
+template <typename C>
+concept Is_Dense = std::same_as<Policy_Of<C>, Dense>;
 
-// TODO: Rethink what is returned by components_of, view.
-//       How should unset components be filtered? Atm the are optional but perhaps they should
-//       be skipped entirely with a vw::filter?
-template <component::Concept... Components>
-struct Basic_ECS {
-	using IDs = std::vector<entity::ID>;
-	using Component_Storage = util::Polymorphic_Storage<std::optional<Components>...>;
+template <typename C>
+concept Is_Sparse = std::same_as<Policy_Of<C>, Sparse>;
 
-	// Returned to the user but should only be constructed and assigned by ECS.
-	struct Entity {
-		friend struct Basic_ECS;	// Only ECS can tweak internals
+template <typename C>
+concept Is_Archetype = std::same_as<Policy_Of<C>, Archetype>;
 
-	private:
-		entity::ID _id;
-		Basic_ECS* ecs;
+template <typename C>
+concept Is_Tag = std::same_as<Policy_Of<C>, Tag>;
 
-	public:
-		Entity()
-			: ecs{nullptr}
-		{}
+// Growable array of default constructed Ts allocated in fixed size pages from a memory resource.
+// Growing only adds pages so the address of an element never changes.
+template <std::default_initializable T>
+struct Pages {
+	static constexpr auto page_bytes = 16ul * 1024;
+	static constexpr auto page_size = std::max(1ul, page_bytes / sizeof(T));
 
-		Entity(entity::ID id, Basic_ECS* _parent)
-			: _id{std::move(id)}
-			, ecs{_parent}
-		{}
+private:
+	std::pmr::vector<T*> pages;
 
-		Entity(Entity&& e)
-			: _id{std::exchange(e._id, std::nullopt)}
-			, ecs{std::exchange(e.ecs, nullptr)}
-		{}
+public:
+	Pages(const size_t capacity = 0, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: pages{resource}
+	{
+		grow(capacity);
+	}
 
-		auto operator= (Entity&& e) -> Entity& {
-			SAGE_ASSERT(e.ecs != nullptr, "Attempting to assign from a null Entity");
-			SAGE_ASSERT(ecs == nullptr or ecs == e.ecs, "Entities do not come from the same ECS");
+	Pages(Pages&&) = default;
+	auto operator= (Pages&&) -> Pages& = delete;
 
-			_id = std::exchange(e._id, std::nullopt);
-			ecs = std::exchange(e.ecs, nullptr);
-			return *this;
+	~Pages() {
+		auto allocator = std::pmr::polymorphic_allocator<T>{pages.get_allocator()};
+		for (auto* page : pages) {
+			std::destroy_n(page, page_size);
+			allocator.deallocate(page, page_size);
 		}
+	}
 
-						// See Basic_ECS for details
-	public:
-		template <typename... Cs>
-		auto set(Cs&&... cs) -> decltype(auto) {
-			SAGE_ASSERT(ecs != nullptr);
-			return ecs->set_components<Cs...>(*this, std::forward<Cs>(cs)...);
-		}
+public:
+	auto operator[] (const size_t i) -> T& {
+		SAGE_ASSERT(i < capacity());
+		return pages[i / page_size][i % page_size];
+	}
 
-		template <typename... Cs>
-		auto set(std::invocable<std::tuple<std::optional<Cs>&...>> auto&& fn) -> decltype(auto) {
-			SAGE_ASSERT(ecs != nullptr);
-			return ecs->set_components<Cs...>(std::forward<decltype(fn)>(fn));
-		}
+	auto operator[] (const size_t i) const -> const T& {
+		SAGE_ASSERT(i < capacity());
+		return pages[i / page_size][i % page_size];
+	}
 
-		template <typename... Cs>
-		auto components() -> decltype(auto) {
-			SAGE_ASSERT(ecs != nullptr);
-			return ecs->components_of<Cs...>(*this);
+	// Assign value to the elements [first, first + count), a page at a time
+	auto fill(size_t first, size_t count, const T& value) -> void {
+		SAGE_ASSERT(first + count <= capacity());
+		while (count > 0) {
+			const auto offset = first % page_size;
+			const auto n = std::min(count, page_size - offset);
+			std::fill_n(pages[first / page_size] + offset, n, value);
+			first += n;
+			count -= n;
 		}
+	}
 
-		template <typename... Cs>
-		auto has() -> decltype(auto) {
-			SAGE_ASSERT(ecs != nullptr);
-			return ecs->has_components<Cs...>(*this);
+	// Assign ts to the elements from first on, a page at a time
+	auto copy(size_t first, std::span<const T> ts) -> void {
+		SAGE_ASSERT(first + ts.size() <= capacity());
+		while (not ts.empty()) {
+			const auto offset = first % page_size;
+			const auto n = std::min(ts.size(), page_size - offset);
+			rg::copy(ts.first(n), pages[first / page_size] + offset);
+			first += n;
+			ts = ts.subspan(n);
 		}
+	}
 
-		auto is_valid() const -> bool {
-			return ecs->is_valid(*this);
+	// Make room for at least `capacity` elements
+	auto grow(const size_t capacity) -> void {
+		auto allocator = std::pmr::polymorphic_allocator<T>{pages.get_allocator()};
+		while (this->capacity() < capacity) {
+			auto* page = allocator.allocate(page_size);
+			std::uninitialized_value_construct_n(page, page_size);
+			pages.push_back(page);
 		}
+	}
 
-		auto operator== (const Entity& e) const -> bool {
-			return ecs != nullptr and e.ecs != nullptr and _id == e._id and ecs == e.ecs;
-		}
+	auto capacity() const -> size_t {
+		return pages.size() * page_size;
+	}
+};
 
-		auto id() const -> const entity::ID& { return _id; }
+// Change tracking, see Basic_ECS::tick()
+using Tick = uint32_t;
 
-	public:
-		friend FMT_FORMATTER(Entity);
-	};
+// Next to every component: the ticks at which it was added and last accessed mutably
+struct Ticks {
+	Tick added = 0;
+	Tick changed = 0;
+};
 
-private:
-	IDs ids;
-	Component_Storage components;
+// All columns share the same interface, see Basic_ECS for how they are used.
+template <Concept C>
+struct Dense_Column {
+	using Component = C;
 
+private:
+	Pages<std::optional<C>> slots;
+	Pages<Ticks> _ticks;
+	size_t _capacity;
+	size_t _size;
 
 public:
-	Basic_ECS(const size_t max_entities)
-		: ids{max_entities}
-		, components{max_entities}
+	Dense_Column(const size_t capacity, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: slots{capacity, resource}
+		, _ticks{capacity, resource}
+		, _capacity{capacity}
+		, _size{0}
 	{}
 
 public:
-	[[nodiscard]]
-	auto create() -> std::optional<Entity> {
-		// OPTIMIZE: If necessary use a more sophisticated method
-		//
-		// A simple find(entities, std::nullopt) gives gcc a seizure...
-		if (const auto id = rg::find(ids, IDs::value_type{});
-			id != ids.end())
-		{
-			SAGE_ASSERT(not is_valid(*id));
-
-			const auto idx = static_cast<entity::ID::Rep>(std::distance(ids.begin(), id));	// Ok to cast, it will be between begin/end
-			components.apply_group([&] (const auto& comps) {
-					SAGE_ASSERT(idx < comps.size(), "Components must be allocated");
-					SAGE_ASSERT(not comps[idx].has_value(), "Cleanup has not been performed since last destroy/initialization");
-				});
-
-			*id = entity::ID{Raw_ID{idx}};
+	auto contains(const Index idx) const -> bool {
+		SAGE_ASSERT(idx < _capacity);
+		return slots[idx].has_value();
+	}
 
-			return std::make_optional<Entity>(*id, this);	// Wont bother dealing with "cannot be converted from brace enclosed initializer list to Entity"...
-		}
-		else
-			return std::nullopt;
+	auto find(const Index idx) -> C* {
+		return contains(idx) ? &*slots[idx] : nullptr;
 	}
 
-	auto null() -> Entity {
-		return { std::nullopt, this };
+	auto find(const Index idx) const -> const C* {
+		return contains(idx) ? &*slots[idx] : nullptr;
 	}
 
-	auto destroy(Entity& e) -> bool {
-		if (not is_valid(e))
-			return false;
-		else {
-			const auto idx = e._id.raw();
-			ids[idx] = std::nullopt;
-			components.apply_group([&] (auto& comps) {
-					SAGE_ASSERT(idx < comps.size(), "Memory for components has not been allocated");
-					comps[idx] = std::nullopt;
-				});
-			e._id.reset();
+	auto get(const Index idx) -> C& {
+		SAGE_ASSERT(contains(idx));
+		return *slots[idx];
+	}
 
-			return true;
-		}
+	auto get(const Index idx) const -> const C& {
+		SAGE_ASSERT(contains(idx));
+		return *slots[idx];
 	}
 
-	// The Cs arguments can be deduced so prefer to call it without explicit template parameters:
-	//
-	// ecs.push(entt, Component1{...}, Component2{...});
-	//
-	template <typename... Cs>
-		requires (sizeof...(Cs) > 0) and (type::Any<Cs, Components...> and ...) and type::Unique<Cs...>
-	auto set_components(const Entity& e, Cs&&... cs) -> decltype(auto /* optional<tuple<std::optional<Cs>&...>> */) {
-		using Optional = std::optional<std::tuple<std::optional<Cs>&...>>;
+	auto ticks(const Index idx) -> Ticks& {
+		SAGE_ASSERT(contains(idx));
+		return _ticks[idx];
+	}
 
-		if (not is_valid(e))
-			return Optional{std::nullopt};
-		else {
-			const auto idx = e._id.raw();
-			auto comps = std::forward_as_tuple(
-					std::get<typename Component_Storage::Vector<std::optional<Cs>>>(components)[idx] = std::forward<Cs>(cs)
-					...
-				);
-			return Optional{comps};
-		}
+	auto ticks(const Index idx) const -> const Ticks& {
+		SAGE_ASSERT(contains(idx));
+		return _ticks[idx];
 	}
 
-	template <typename... Cs>
-		requires (type::Any<Cs, Components...> and ...) and type::Unique<Cs...>
-	auto components_of(const Entity& e) -> decltype(auto /* optional<tuple<optional<Cs>&...>> */) {
-		// Even if entity is not valid we can reference the first element to make the type deduction work
-		const auto idx = std::to_underlying(e._id.value_or(Raw_ID{0}));
-		components.apply_group([&] (const auto& vec) {
-			SAGE_ASSERT(idx < vec.size(), "Expect memory for components to be allocated");
-		});
+	template <typename X>
+		requires std::same_as<std::remove_cvref_t<X>, C>
+	auto set(const Index idx, X&& c) -> C& {
+		if (not contains(idx))
+			++_size;
 
-		auto comps = std::invoke([&] {
-			if constexpr (sizeof...(Cs) == 0)
-				// Fetch all Components
-				return std::forward_as_tuple(
-					std::get<typename Component_Storage::Vector<std::optional<Components>>>(components)[idx]
-					...
-				);
-			else
-				// Fetch only requested Components
-				return std::forward_as_tuple(
-					std::get<typename Component_Storage::Vector<std::optional<Cs>>>(components)[idx]
-					...
-				);
-		});
+		return slots[idx].emplace(std::forward<X>(c));
+	}
 
-		using Optional = std::optional<decltype(comps)>;
+	// A copy of c to each of idxs, which must not have the component yet. Runs of consecutive
+	// indices are filled at once.
+	auto append(const std::span<const Index> idxs, const Ticks ticks, const C& c) -> void {
+		const auto value = std::optional<C>{c};
+		for (auto i = 0ul; i < idxs.size(); ) {
+			auto run = 1ul;
+			while (i + run < idxs.size() and idxs[i + run] == idxs[i] + run)
+				++run;
 
-		return is_valid(e)
-			? Optional{comps}
-			: Optional{std::nullopt}
-			;
+			slots.fill(idxs[i], run, value);
+			_ticks.fill(idxs[i], run, ticks);
+			i += run;
+		}
+		_size += idxs.size();
 	}
 
-	template <typename... Cs>
-		requires (sizeof...(Cs) > 0) and (type::Any<Cs, Components...> and ...) and type::Unique<Cs...>
-	auto has_components(const Entity& e) -> decltype(auto /* optional<tuple<bool...>> */) {
-		using Optional = std::optional<decltype(std::make_tuple(
-				std::get<typename Component_Storage::Vector<std::optional<Cs>>>(components).front().has_value()
-				...
-			))>;
-
-		if (not is_valid(e))
-			return Optional{std::nullopt};
-		else {
-			const auto idx = e._id.raw();
-			auto comps = std::make_tuple(
-				std::get<typename Component_Storage::Vector<std::optional<Cs>>>(components)[idx].has_value()
-				...
-			);
-			return Optional{comps};
+	// cs[i] to idxs[i], same as above
+	auto append(const std::span<const Index> idxs, const Ticks ticks, const std::span<const C> cs) -> void {
+		SAGE_ASSERT(idxs.size() == cs.size());
+		for (const auto [idx, c] : vw::zip(idxs, cs)) {
+			slots[idx].emplace(c);
+			_ticks[idx] = ticks;
 		}
+		_size += idxs.size();
 	}
 
-	// Return a view of tuples over all the valid ids and their components.
-	// The first value of the tuples is an entity::ID that will always have a value.
-	// The components are returned as optional<Component> and may/may not have value.
-	//
-	// CAUTION:
-	// Should not be used as const.
-	//
-	// Do not:
-	//
-	// const auto view = ecs.view();
-	// std::apply([] (const auto&... components) { ... });
-	//
-	// The compiler error says that the constraint for ranges::begin/end(__t)
-	// is not satisfied but the explanation is propably:
-	// https://stackoverflow.com/questions/66366084/why-cant-i-call-rangesbegin-on-a-const-filter-view
-	//
-	// TODO: if sizeof...(Cs) == 0 return all
-	template <typename... Cs>
-		requires (sizeof...(Cs) > 0) and (type::Any<Cs, Components...> and ...) and type::Unique<Cs...>
-	auto view() -> decltype(auto /* view<tuple<entity::ID, optional<Cs>...>> */) {
-		components.apply_group([&] (const auto& vec) {
-				SAGE_ASSERT(vec.size() == ids.size(), "IDs and components must all have the same size");
-			});
+	auto erase(const Index idx) -> bool {
+		if (not contains(idx))
+			return false;
 
-		return vw::zip(ids, std::get<typename Component_Storage::Vector<std::optional<Cs>>>(components)...)
-			| vw::filter([&] (auto&& entt_comps) {
-					return is_valid(std::get<0>(entt_comps));
-				})
-			;
+		slots[idx].reset();
+		--_size;
+		return true;
 	}
 
-	template <type::Any<Entity, entity::ID> Entt>
-	auto is_valid(const Entt& e) const -> bool {
-		if constexpr (std::same_as<Entt, Entity>)
-			return e.ecs == this and e._id.has_value() and ids[e._id.raw()] == e._id;
-		else if constexpr (std::same_as<Entt, entity::ID>)
-			return e.has_value();
-		else
-			static_assert(false);
+	auto clear() -> void {
+		for (const auto idx : vw::iota(0ul, _capacity))
+			slots[idx].reset();
+		_size = 0;
 	}
 
-	// ECS size is not the same as a vector size. ECS should preallocate its vectors.
-	//
-	auto size() /* const */ -> size_t {
-		// TODO: Fix constness of Polymorphic_* containers
-		//components.apply_group([&] (auto& vec) {
-		//		SAGE_ASSERT(ids.size() == vec.size(), "Entities and Components containers do not have the same preallocated size");
-		//	});
-
-		return rg::count_if(ids, [] (const auto& e) { return e.has_value(); });
+	// Existing components are not moved
+	auto grow(const size_t capacity) -> void {
+		SAGE_ASSERT(capacity >= _capacity);
+		slots.grow(capacity);
+		_ticks.grow(capacity);
+		_capacity = capacity;
 	}
 
-	// Be sure to note comment of size()
-	auto is_full() /* const */ -> bool {
-		const auto sz = size(),
-				   ids_size = ids.size();
-
-		SAGE_ASSERT(sz <= ids_size, "size() cannot be > ids.size(), make sure entity creation/deletion is correct");
-
-		return sz == ids_size;
+	// Number of entities that have the component
+	auto size() const -> size_t {
+		return _size;
 	}
 
-	auto clear() -> void {
-		rg::fill(ids, std::nullopt);
+	auto capacity() const -> size_t {
+		return _capacity;
 	}
 };
 
-using ECS = Basic_ECS<_ALL_COMPONENTS>;		// Excessive? maybe, I care? no.
+// Sparse set: `sparse` maps the index of an entity to its position in the packed arrays
+// `entities`, `packed` and `packed_ticks`, which hold the entities that have the component back to back.
+// Erasing swaps the last element into the hole so the packed arrays stay dense.
+template <Concept C>
+struct Sparse_Column {
+	using Component = C;
 
-} //sage
+	static constexpr auto null = std::numeric_limits<Index>::max();
 
-template <>
-FMT_FORMATTER(sage::entity::ID) {
-	FMT_FORMATTER_DEFAULT_PARSE
+private:
+	std::pmr::vector<Index> sparse;
+	std::pmr::vector<Index> _entities;
+	Pages<C> packed;
+	Pages<Ticks> packed_ticks;
 
-	FMT_FORMATTER_FORMAT(sage::entity::ID) {
-		return fmt::format_to(ctx.out(), "entity::ID: {}", obj);
+public:
+	Sparse_Column(const size_t capacity, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: sparse(capacity, null, resource)
+		, _entities{resource}
+		, packed{0, resource}
+		, packed_ticks{0, resource}
+	{}
+
+public:
+	auto contains(const Index idx) const -> bool {
+		SAGE_ASSERT(idx < sparse.size());
+		return sparse[idx] != null;
 	}
-};
 
-template <>
-FMT_FORMATTER(sage::component::Name) {
-	FMT_FORMATTER_DEFAULT_PARSE
+	auto find(const Index idx) -> C* {
+		return contains(idx) ? &packed[sparse[idx]] : nullptr;
+	}
 
-	FMT_FORMATTER_FORMAT(sage::component::Name) {
-		return fmt::format_to(ctx.out(), "{:?}", obj.name);
+	auto find(const Index idx) const -> const C* {
+		return contains(idx) ? &packed[sparse[idx]] : nullptr;
 	}
-};
-template <>
-FMT_FORMATTER(sage::component::Sprite) {
-	FMT_FORMATTER_DEFAULT_PARSE
 
-	FMT_FORMATTER_FORMAT(sage::component::Sprite) {
-		return fmt::format_to(ctx.out(), "{}", glm::to_string(obj.color));
+	auto get(const Index idx) -> C& {
+		SAGE_ASSERT(contains(idx));
+		return packed[sparse[idx]];
 	}
-};
-template <>
-FMT_FORMATTER(sage::component::Transform) {
-	FMT_FORMATTER_DEFAULT_PARSE
 
-	FMT_FORMATTER_FORMAT(sage::component::Transform) {
-		return fmt::format_to(ctx.out(), "{}", glm::to_string(obj.trans));
+	auto get(const Index idx) const -> const C& {
+		SAGE_ASSERT(contains(idx));
+		return packed[sparse[idx]];
 	}
-};
-template <>
-FMT_FORMATTER(sage::component::Camera) {
-	FMT_FORMATTER_DEFAULT_PARSE
 
-	FMT_FORMATTER_FORMAT(sage::component::Camera) {
-		return fmt::format_to(ctx.out(), "TODO");
+	auto ticks(const Index idx) -> Ticks& {
+		SAGE_ASSERT(contains(idx));
+		return packed_ticks[sparse[idx]];
 	}
-};
-template <>
-FMT_FORMATTER(sage::component::Position) {
-	FMT_FORMATTER_DEFAULT_PARSE
 
-	FMT_FORMATTER_FORMAT(sage::component::Position) {
-		return fmt::format_to(ctx.out(), "{}", glm::to_string(obj.position));
+	auto ticks(const Index idx) const -> const Ticks& {
+		SAGE_ASSERT(contains(idx));
+		return packed_ticks[sparse[idx]];
 	}
-};
 
-// TODO: FMT_FORMATTER for ECS::Entity, dont forget to print the addresses of the ECS to debug their origin
+	template <typename X>
+		requires std::same_as<std::remove_cvref_t<X>, C>
+	auto set(const Index idx, X&& c) -> C& {
+		if (contains(idx))
+			return packed[sparse[idx]] = std::forward<X>(c);
 
-#ifdef SAGE_TEST_ECS
-namespace {
+		const auto pos = _entities.size();
+		packed.grow(pos + 1);
+		packed_ticks.grow(pos + 1);
+		sparse[idx] = static_cast<Index>(pos);
+		_entities.push_back(idx);
+		return packed[pos] = std::forward<X>(c);
+	}
 
-using namespace sage;
+	// A copy of c to each of idxs, which must not have the component yet
+	auto append(const std::span<const Index> idxs, const Ticks ticks, const C& c) -> void {
+		packed.fill(append_entities(idxs, ticks), idxs.size(), c);
+	}
 
-TEST_CASE ("Must not compile") {
-	//const entity::ID ent = 666;
+	// cs[i] to idxs[i], same as above
+	auto append(const std::span<const Index> idxs, const Ticks ticks, const std::span<const C> cs) -> void {
+		SAGE_ASSERT(idxs.size() == cs.size());
+		packed.copy(append_entities(idxs, ticks), cs);
+	}
 
-	//const auto func = [] (const size_t e) {
+	auto erase(const Index idx) -> bool {
+		if (not contains(idx))
+			return false;
+
+		const auto pos = sparse[idx];
+		const auto last = _entities.size() - 1;
+		if (pos != last) {
+			packed[pos] = std::move(packed[last]);
+			packed_ticks[pos] = packed_ticks[last];
+			_entities[pos] = _entities[last];
+			sparse[_entities[pos]] = pos;
+		}
+
+		packed[last] = C{};	// Release what the component holds
+		_entities.pop_back();
+		sparse[idx] = null;
+		return true;
+	}
+
+	auto clear() -> void {
+		for (const auto [pos, idx] : _entities | vw::enumerate) {
+			sparse[idx] = null;
+			packed[pos] = C{};
+		}
+
+		_entities.clear();
+	}
+
+	auto grow(const size_t capacity) -> void {
+		SAGE_ASSERT(capacity >= sparse.size());
+		sparse.resize(capacity, null);
+	}
+
+	auto size() const -> size_t {
+		return _entities.size();
+	}
+
+	auto capacity() const -> size_t {
+		return sparse.size();
+	}
+
+public:
+	// Packed, same order as the components
+	auto entities() const -> std::span<const Index> {
+		return _entities;
+	}
+
+	// Position of the component of idx in the packed arrays
+	auto position(const Index idx) const -> Index {
+		SAGE_ASSERT(contains(idx));
+		return sparse[idx];
+	}
+
+	auto at(const size_t pos) -> C& {
+		SAGE_ASSERT(pos < _entities.size());
+		return packed[pos];
+	}
+
+	auto at(const size_t pos) const -> const C& {
+		SAGE_ASSERT(pos < _entities.size());
+		return packed[pos];
+	}
+
+	auto ticks_at(const size_t pos) -> Ticks& {
+		SAGE_ASSERT(pos < _entities.size());
+		return packed_ticks[pos];
+	}
+
+	// Swap two packed elements, owning groups keep their members at the front this way
+	auto swap(const Index a, const Index b) -> void {
+		SAGE_ASSERT(a < _entities.size() and b < _entities.size());
+		if (a == b)
+			return;
+
+		std::swap(packed[a], packed[b]);
+		std::swap(packed_ticks[a], packed_ticks[b]);
+		std::swap(_entities[a], _entities[b]);
+		sparse[_entities[a]] = a;
+		sparse[_entities[b]] = b;
+	}
+
+private:
+	// Room for idxs at the end of the packed arrays, returns where they start
+	auto append_entities(const std::span<const Index> idxs, const Ticks ticks) -> size_t {
+		const auto pos = _entities.size();
+		packed.grow(pos + idxs.size());
+		packed_ticks.grow(pos + idxs.size());
+		packed_ticks.fill(pos, idxs.size(), ticks);
+
+		for (const auto [i, idx] : idxs | vw::enumerate)
+			sparse[idx] = static_cast<Index>(pos + static_cast<size_t>(i));
+		_entities.insert(_entities.end(), idxs.begin(), idxs.end());
+		return pos;
+	}
+};
+
+// Sparse set of the components of a runtime registered type, the bytes of which are handled
+// through its Info. Same layout as Sparse_Column with the packed components in pages of raw
+// memory, so their addresses are stable until erased.
+struct Erased_Column {
+	static constexpr auto null = std::numeric_limits<Index>::max();
+	static constexpr auto page_bytes = 16ul * 1024;
+
+private:
+	struct Free_Page {
+		std::pmr::memory_resource* resource;
+		size_t bytes;
+		size_t alignment;
+
+		auto operator() (std::byte* page) const -> void {
+			resource->deallocate(page, bytes, alignment);
+		}
+	};
+
+	using Page = std::unique_ptr<std::byte[], Free_Page>;
+
+	Info _info;
+	std::unique_ptr<const std::string> _name;	// Owned, the name of the Info may come from a data file. Stays put when the column moves.
+	size_t stride;
+	size_t page_size;
+
+	std::pmr::vector<Index> sparse;
+	std::pmr::vector<Index> _entities;
+	std::pmr::vector<Page> pages;
+	Pages<Ticks> packed_ticks;
+
+public:
+	Erased_Column(const Info& info, const size_t capacity, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: _info{info}
+		, _name{std::make_unique<const std::string>(info.name)}
+		, stride{(std::max(info.size, 1ul) + info.alignment - 1) / info.alignment * info.alignment}
+		, page_size{std::max(1ul, page_bytes / stride)}
+		, sparse(capacity, null, resource)
+		, _entities{resource}
+		, pages{resource}
+		, packed_ticks{0, resource}
+	{
+		SAGE_ASSERT(std::has_single_bit(info.alignment), "Alignment of {} must be a power of 2", *_name);
+		SAGE_ASSERT(info.construct != nullptr and info.relocate != nullptr and info.destroy != nullptr, "Info of {} is incomplete", *_name);
+	}
+
+	Erased_Column(Erased_Column&&) = default;
+
+	~Erased_Column() {
+		clear();
+	}
+
+public:
+	auto contains(const Index idx) const -> bool {
+		SAGE_ASSERT(idx < sparse.size());
+		return sparse[idx] != null;
+	}
+
+	auto find(const Index idx) -> void* {
+		return contains(idx) ? at(sparse[idx]) : nullptr;
+	}
+
+	auto find(const Index idx) const -> const void* {
+		return contains(idx) ? at(sparse[idx]) : nullptr;
+	}
+
+	auto ticks(const Index idx) -> Ticks& {
+		SAGE_ASSERT(contains(idx));
+		return packed_ticks[sparse[idx]];
+	}
+
+	auto ticks(const Index idx) const -> const Ticks& {
+		SAGE_ASSERT(contains(idx));
+		return packed_ticks[sparse[idx]];
+	}
+
+	// The component of the entity, default constructed if it did not have it
+	auto emplace(const Index idx) -> void* {
+		if (contains(idx))
+			return at(sparse[idx]);
+
+		const auto pos = _entities.size();
+		if (pos == pages.size() * page_size) {
+			auto* resource = pages.get_allocator().resource();
+			pages.emplace_back(
+					static_cast<std::byte*>(resource->allocate(page_size * stride, _info.alignment)),
+					Free_Page{ .resource = resource, .bytes = page_size * stride, .alignment = _info.alignment }
+				);
+		}
+		packed_ticks.grow(pos + 1);
+
+		auto* c = at(pos);
+		_info.construct(c);
+		sparse[idx] = static_cast<Index>(pos);
+		_entities.push_back(idx);
+		return c;
+	}
+
+	auto erase(const Index idx) -> bool {
+		if (not contains(idx))
+			return false;
+
+		const auto pos = sparse[idx];
+		const auto last = _entities.size() - 1;
+
+		_info.destroy(at(pos));
+		if (pos != last) {
+			_info.relocate(at(pos), at(last));
+			packed_ticks[pos] = packed_ticks[last];
+			_entities[pos] = _entities[last];
+			sparse[_entities[pos]] = pos;
+		}
+
+		_entities.pop_back();
+		sparse[idx] = null;
+		return true;
+	}
+
+	auto clear() -> void {
+		for (const auto [pos, idx] : _entities | vw::enumerate) {
+			_info.destroy(at(pos));
+			sparse[idx] = null;
+		}
+
+		_entities.clear();
+	}
+
+	auto grow(const size_t capacity) -> void {
+		SAGE_ASSERT(capacity >= sparse.size());
+		sparse.resize(capacity, null);
+	}
+
+	auto size() const -> size_t {
+		return _entities.size();
+	}
+
+	auto capacity() const -> size_t {
+		return sparse.size();
+	}
+
+public:
+	// Packed, same order as the components
+	auto entities() const -> std::span<const Index> {
+		return _entities;
+	}
+
+	auto info() const -> Info {
+		auto info = _info;
+		info.name = *_name;	// Valid for as long as the ECS
+		return info;
+	}
+
+private:
+	auto at(const size_t pos) const -> std::byte* {
+		return pages[pos / page_size].get() + (pos % page_size) * stride;
+	}
+};
+
+// A dense bitset, bit `idx` is set if the entity has the Tag. All entities share the same C,
+// it is empty so there is nothing to tell them apart.
+template <Concept C>
+	requires std::is_empty_v<C>
+struct Tag_Column {
+	using Component = C;
+	using Word = uint64_t;
+
+	static constexpr auto word_bits = util::bits<Word>;
+
+private:
+	std::pmr::vector<Word> _words;
+	size_t _capacity;
+	size_t _size;
+	C tag;
+
+public:
+	Tag_Column(const size_t capacity, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: _words((capacity + word_bits - 1) / word_bits, 0, resource)
+		, _capacity{capacity}
+		, _size{0}
+	{}
+
+public:
+	auto contains(const Index idx) const -> bool {
+		SAGE_ASSERT(idx < _capacity);
+		return (_words[idx / word_bits] >> (idx % word_bits)) & 1;
+	}
+
+	auto find(const Index idx) -> C* {
+		return contains(idx) ? &tag : nullptr;
+	}
+
+	auto find(const Index idx) const -> const C* {
+		return contains(idx) ? &tag : nullptr;
+	}
+
+	auto get(const Index idx) -> C& {
+		SAGE_ASSERT(contains(idx));
+		return tag;
+	}
+
+	auto get(const Index idx) const -> const C& {
+		SAGE_ASSERT(contains(idx));
+		return tag;
+	}
+
+	template <typename X>
+		requires std::same_as<std::remove_cvref_t<X>, C>
+	auto set(const Index idx, X&&) -> C& {
+		if (not contains(idx)) {
+			_words[idx / word_bits] |= Word{1} << (idx % word_bits);
+			++_size;
+		}
+		return tag;
+	}
+
+	// Tags have no ticks, see Dense_Column::append()
+	auto append(const std::span<const Index> idxs, const Ticks, const C&) -> void {
+		for (const auto idx : idxs)
+			_words[idx / word_bits] |= Word{1} << (idx % word_bits);
+		_size += idxs.size();
+	}
+
+	auto append(const std::span<const Index> idxs, const Ticks ticks, const std::span<const C>) -> void {
+		append(idxs, ticks, tag);
+	}
+
+	auto erase(const Index idx) -> bool {
+		if (not contains(idx))
+			return false;
+
+		_words[idx / word_bits] &= ~(Word{1} << (idx % word_bits));
+		--_size;
+		return true;
+	}
+
+	auto clear() -> void {
+		rg::fill(_words, 0);
+		_size = 0;
+	}
+
+	auto grow(const size_t capacity) -> void {
+		SAGE_ASSERT(capacity >= _capacity);
+		_words.resize((capacity + word_bits - 1) / word_bits, 0);
+		_capacity = capacity;
+	}
+
+	auto size() const -> size_t {
+		return _size;
+	}
+
+	auto capacity() const -> size_t {
+		return _capacity;
+	}
+
+	auto words() const -> std::span<const Word> {
+		return _words;
+	}
+};
+
+// The indices of the bits that are set in all of N bitsets of the same length, found a word at a time.
+template <size_t N>
+	requires (N > 0)
+struct Set_Bits : std::ranges::view_interface<Set_Bits<N>> {
+	using Word = uint64_t;
+
+	static constexpr auto word_bits = util::bits<Word>;
+
+	std::array<const Word*, N> sets{};
+	size_t first = 0;	// Range of words
+	size_t last = 0;
+
+	Set_Bits() = default;
+
+	Set_Bits(const std::array<const Word*, N>& s, const size_t f, const size_t l)
+		: sets{s}
+		, first{f}
+		, last{l}
+	{}
+
+	auto word(const size_t w) const -> Word {
+		auto x = sets[0][w];
+		for (const auto* set : sets | vw::drop(1))
+			x &= set[w];
+		return x;
+	}
+
+	// Number of bits set
+	auto count() const -> size_t {
+		auto n = 0ul;
+		for (const auto w : vw::iota(first, last))
+			n += static_cast<size_t>(std::popcount(word(w)));
+		return n;
+	}
+
+	// The words [first + from, first + to)
+	auto subrange(const size_t from, const size_t to) const -> Set_Bits {
+		return { sets, first + from, std::min(last, first + to) };
+	}
+
+	struct Iterator {
+		using value_type = Index;
+		using difference_type = std::ptrdiff_t;
+
+		const Set_Bits* bits = nullptr;
+		size_t w = 0;
+		Word rest = 0;	// Bits of word w that are left
+
+		auto operator* () const -> Index {
+			return static_cast<Index>(w * word_bits + static_cast<size_t>(std::countr_zero(rest)));
+		}
+
+		auto operator++ () -> Iterator& {
+			rest &= rest - 1;
+			settle();
+			return *this;
+		}
+
+		auto operator++ (int) -> Iterator {
+			auto tmp = *this;
+			++(*this);
+			return tmp;
+		}
+
+		auto operator== (const Iterator& other) const -> bool {
+			return w == other.w and rest == other.rest;
+		}
+
+		// Skip the empty words
+		auto settle() -> void {
+			while (rest == 0 and w < bits->last)
+				if (++w < bits->last)
+					rest = bits->word(w);
+		}
+	};
+
+	auto begin() const -> Iterator {
+		auto it = Iterator{ .bits = this, .w = first, .rest = first < last ? word(first) : 0 };
+		it.settle();
+		return it;
+	}
+
+	auto end() const -> Iterator {
+		return { .bits = this, .w = last, .rest = 0 };
+	}
+};
+
+namespace detail {
+template <typename C> struct Column_Of { using Type = Dense_Column<C>; };
+template <Is_Sparse C> struct Column_Of<C> { using Type = Sparse_Column<C>; };
+template <Is_Tag C> struct Column_Of<C> { using Type = Tag_Column<C>; };
+}
+
+template <Concept C>
+	requires (not Is_Archetype<C>)
+using Column = detail::Column_Of<C>::Type;
+
+template <Concept... Cs>
+struct Columns : util::Polymorphic_Array<Column<Cs>...> {
+	using Base = util::Polymorphic_Array<Column<Cs>...>;
+
+	// Unused when every component is in the Archetypes
+	Columns([[maybe_unused]] const size_t capacity, [[maybe_unused]] std::pmr::memory_resource* resource)
+		: Base{Column<Cs>{capacity, resource}...}
+	{}
+};
+
+// Same interface as the other columns, for a single component of the Archetypes.
+template <typename A, typename Table>
+struct Archetype_Column {
+	using Component = A;
+
+	Table* table;
+
+	auto contains(const Index idx) const -> bool { return table->template contains<A>(idx); }
+	auto find(const Index idx) const -> decltype(auto) { return table->template find<A>(idx); }
+	auto get(const Index idx) const -> decltype(auto) { return table->template get<A>(idx); }
+	auto ticks(const Index idx) const -> decltype(auto) { return table->template ticks<A>(idx); }
+	auto erase(const Index idx) const -> bool { return table->template erase<A>(idx); }
+	auto size() const -> size_t { return table->template count<A>(); }
+	auto capacity() const -> size_t { return table->capacity(); }
+
+	template <typename X>
+		requires std::same_as<std::remove_cvref_t<X>, A>
+	auto set(const Index idx, X&& a) const -> A& {
+		return table->template set<A>(idx, std::forward<X>(a));
+	}
+};
+
+// All the Archetype components of an ECS.
+//
+// Every distinct set of As (the Signature) that is in use gets a Table, which is a list of chunks.
+// A Chunk holds up to chunk_rows entities with a column per component of the signature, so
+// iterating a Table is a linear walk over arrays. Columns of components outside the signature
+// stay empty.
+//
+// Removing a row moves the last row of the Table into the hole so chunks stay packed, which means
+// references into the Archetypes are invalidated by any add/remove of an Archetype component.
+template <Concept... As>
+	requires type::Unique<As...>
+struct Archetypes {
+	using Signature = std::bitset<sizeof...(As)>;
+
+	static constexpr auto null = std::numeric_limits<Index>::max();
+
+	// Aim for chunks of ~16KiB, the row of the widest archetype decides
+	static constexpr auto chunk_bytes = 16ul * 1024;
+	static constexpr auto chunk_rows = std::max(1ul, chunk_bytes / (sizeof(Index) + ((sizeof(As) + sizeof(Ticks)) + ... + 0)));
+
+	struct Chunk {
+		std::pmr::vector<Index> entities;
+		std::tuple<std::pmr::vector<As>...> columns;
+		std::array<std::pmr::vector<Ticks>, sizeof...(As)> ticks;	// Ticks of the columns, same order as As
+
+		explicit Chunk(std::pmr::memory_resource* resource)
+			: entities{resource}
+			, columns{std::pmr::vector<As>(resource)...}
+			, ticks{((void)sizeof(As), std::pmr::vector<Ticks>(resource))...}
+		{}
+
+		template <type::Any<As...> A>
+		auto column() -> std::pmr::vector<A>& {
+			return std::get<std::pmr::vector<A>>(columns);
+		}
+
+		template <type::Any<As...> A>
+		auto column() const -> const std::pmr::vector<A>& {
+			return std::get<std::pmr::vector<A>>(columns);
+		}
+
+		template <type::Any<As...> A>
+		auto ticks_of() -> std::pmr::vector<Ticks>& {
+			return ticks[bit<A>()];
+		}
+
+		template <type::Any<As...> A>
+		auto ticks_of() const -> const std::pmr::vector<Ticks>& {
+			return ticks[bit<A>()];
+		}
+
+		auto size() const -> size_t {
+			return entities.size();
+		}
+	};
+
+	struct Table {
+		Signature signature;
+		std::pmr::vector<Chunk> chunks;
+		size_t size = 0;
+	};
+
+	// Where the components of an entity live
+	struct Location {
+		Index table = null;
+		Index chunk = null;
+		Index row = null;
+	};
+
+	// What views iterate: an entity and where to find its components
+	struct Row {
+		Chunk* chunk;
+		size_t row;
+
+		auto entity() const -> Index {
+			return chunk->entities[row];
+		}
+
+		template <type::Any<As...> A>
+		auto get() const -> A& {
+			return chunk->template column<A>()[row];
+		}
+
+		template <type::Any<As...> A>
+		auto ticks() const -> Ticks& {
+			return chunk->template ticks_of<A>()[row];
+		}
+	};
+
+private:
+	std::pmr::memory_resource* resource;
+	std::pmr::vector<Table> tables;
+	std::pmr::unordered_map<Signature, Index> table_of;
+	std::pmr::vector<Location> locations;
+
+public:
+	Archetypes(const size_t capacity, std::pmr::memory_resource* _resource = std::pmr::get_default_resource())
+		: resource{_resource}
+		, tables{resource}
+		, table_of{resource}
+		, locations(capacity, resource)
+	{}
+
+public:
+	// Components outside of As are ignored
+	template <typename... Xs>
+	static constexpr auto signature_of() -> Signature {
+		auto sig = Signature{};
+		(
+			std::invoke([&] {
+				if constexpr (type::Any<Xs, As...>)
+					sig.set(bit<Xs>());
+			})
+			, ...
+		);
+		return sig;
+	}
+
+	auto signature(const Index idx) const -> Signature {
+		SAGE_ASSERT(idx < locations.size());
+		const auto& loc = locations[idx];
+		return loc.table == null ? Signature{} : tables[loc.table].signature;
+	}
+
+	template <type::Any<As...> A>
+	auto contains(const Index idx) const -> bool {
+		return signature(idx).test(bit<A>());
+	}
+
+	template <type::Any<As...> A>
+	auto find(const Index idx) -> A* {
+		return contains<A>(idx) ? &get<A>(idx) : nullptr;
+	}
+
+	template <type::Any<As...> A>
+	auto find(const Index idx) const -> const A* {
+		return contains<A>(idx) ? &get<A>(idx) : nullptr;
+	}
+
+	template <type::Any<As...> A>
+	auto get(const Index idx) -> A& {
+		SAGE_ASSERT(contains<A>(idx));
+		const auto& loc = locations[idx];
+		return tables[loc.table].chunks[loc.chunk].template column<A>()[loc.row];
+	}
+
+	template <type::Any<As...> A>
+	auto get(const Index idx) const -> const A& {
+		SAGE_ASSERT(contains<A>(idx));
+		const auto& loc = locations[idx];
+		return tables[loc.table].chunks[loc.chunk].template column<A>()[loc.row];
+	}
+
+	template <type::Any<As...> A>
+	auto ticks(const Index idx) -> Ticks& {
+		SAGE_ASSERT(contains<A>(idx));
+		const auto& loc = locations[idx];
+		return tables[loc.table].chunks[loc.chunk].template ticks_of<A>()[loc.row];
+	}
+
+	template <type::Any<As...> A>
+	auto ticks(const Index idx) const -> const Ticks& {
+		SAGE_ASSERT(contains<A>(idx));
+		const auto& loc = locations[idx];
+		return tables[loc.table].chunks[loc.chunk].template ticks_of<A>()[loc.row];
+	}
+
+	template <type::Any<As...> A, typename X>
+	auto set(const Index idx, X&& a) -> A& {
+		extend(idx, signature_of<A>());
+		return get<A>(idx) = std::forward<X>(a);
+	}
+
+	template <type::Any<As...> A>
+	auto erase(const Index idx) -> bool {
+		if (not contains<A>(idx))
+			return false;
+
+		shrink(idx, signature_of<A>());
+		return true;
+	}
+
+	// Remove the entity altogether
+	auto erase(const Index idx) -> void {
+		move(idx, Signature{});
+	}
+
+	// Add the components of `sig` that the entity does not have, default constructed,
+	// in a single move.
+	auto extend(const Index idx, const Signature sig) -> void {
+		move(idx, signature(idx) | sig);
+	}
+
+	auto shrink(const Index idx, const Signature sig) -> void {
+		move(idx, signature(idx) & ~sig);
+	}
+
+	// Add entities that have none of the As to the Table of the Xs with a copy of the xs each.
+	// The columns are filled a chunk at a time.
+	template <typename... Xs>
+		requires (sizeof...(Xs) > 0) and (type::Any<Xs, As...> and ...)
+	auto append(const std::span<const Index> idxs, const Ticks ticks, const Xs&... xs) -> void {
+		const auto t = table_index(signature_of<Xs...>());
+		auto& table = tables[t];
+
+		for (auto next = 0ul; next < idxs.size(); ) {
+			auto& chunk = chunk_with_room(table);
+			const auto c = static_cast<Index>(table.chunks.size() - 1);
+			const auto n = std::min(chunk_rows - chunk.size(), idxs.size() - next);
+			const auto batch = idxs.subspan(next, n);
+
+			for (auto row = static_cast<Index>(chunk.size()); const auto idx : batch) {
+				SAGE_ASSERT(locations[idx].table == null, "Entity {} already has archetype components", idx);
+				locations[idx] = Location{ .table = t, .chunk = c, .row = row++ };
+			}
+
+			chunk.entities.insert(chunk.entities.end(), batch.begin(), batch.end());
+			(chunk.template column<Xs>().insert(chunk.template column<Xs>().end(), n, xs), ...);
+			(chunk.template ticks_of<Xs>().insert(chunk.template ticks_of<Xs>().end(), n, ticks), ...);
+
+			table.size += n;
+			next += n;
+		}
+	}
+
+	auto clear() -> void {
+		for (auto& table : tables) {
+			for (const auto& chunk : table.chunks)
+				for (const auto idx : chunk.entities)
+					locations[idx] = Location{};
+
+			table.chunks.clear();
+			table.size = 0;
+		}
+	}
+
+	template <type::Any<As...> A>
+	auto count() const -> size_t {
+		return rg::fold_left(
+				tables
+					| vw::filter([] (const auto& table) { return table.signature.test(bit<A>()); })
+					| vw::transform(&Table::size),
+				0ul,
+				std::plus{}
+			);
+	}
+
+	auto capacity() const -> size_t {
+		return locations.size();
+	}
+
+	auto grow(const size_t capacity) -> void {
+		SAGE_ASSERT(capacity >= locations.size());
+		locations.resize(capacity);
+	}
+
+	auto number_of_tables() const -> size_t {
+		return tables.size();
+	}
+
+	template <type::Any<As...> A>
+	auto column() -> Archetype_Column<A, Archetypes> {
+		return {this};
+	}
+
+	template <type::Any<As...> A>
+	auto column() const -> Archetype_Column<A, const Archetypes> {
+		return {this};
+	}
+
+	// Forward view over the Rows of the entities that have at least the components of a Signature,
+	// table by table and chunk by chunk.
+	struct Rows : std::ranges::view_interface<Rows> {
+		struct Iterator {
+			using value_type = Row;
+			using difference_type = std::ptrdiff_t;
+
+			std::pmr::vector<Table>* tables = nullptr;
+			Signature signature;
+			size_t table = 0,
+				   chunk = 0,
+				   row = 0;
+
+			auto operator* () const -> Row {
+				return { &(*tables)[table].chunks[chunk], row };
+			}
+
+			auto operator++ () -> Iterator& {
+				if (++row == (*tables)[table].chunks[chunk].size()) {
+					row = 0;
+					++chunk;
+					skip();
+				}
+				return *this;
+			}
+
+			auto operator++ (int) -> Iterator {
+				auto it = *this;
+				++(*this);
+				return it;
+			}
+
+			auto operator== (const Iterator&) const -> bool = default;
+
+			auto operator== (std::default_sentinel_t) const -> bool {
+				return table == tables->size();
+			}
+
+			// Move to the first row at or after the current position, chunks are never empty
+			auto skip() -> void {
+				while (table < tables->size()) {
+					const auto& t = (*tables)[table];
+					if ((t.signature & signature) == signature and chunk < t.chunks.size())
+						return;
+
+					++table;
+					chunk = 0;
+				}
+			}
+		};
+
+		std::pmr::vector<Table>* tables;
+		Signature signature;
+
+		Rows() = default;
+
+		Rows(std::pmr::vector<Table>* _tables, const Signature _signature)
+			: tables{_tables}
+			, signature{_signature}
+		{}
+
+		auto begin() const -> Iterator {
+			auto it = Iterator{ .tables = tables, .signature = signature };
+			it.skip();
+			return it;
+		}
+
+		auto end() const -> std::default_sentinel_t {
+			return std::default_sentinel;
+		}
+	};
+
+	auto rows(const Signature sig) -> Rows {
+		return { &tables, sig };
+	}
+
+	// The Rows of a single chunk
+	struct To_Row {
+		Chunk* chunk;
+
+		auto operator() (const size_t row) const -> Row {
+			return { chunk, row };
+		}
+	};
+
+	using Chunk_Rows = std::ranges::transform_view<std::ranges::iota_view<size_t, size_t>, To_Row>;
+
+	static auto rows(Chunk& chunk) -> Chunk_Rows {
+		return Chunk_Rows{vw::iota(0ul, chunk.size()), To_Row{&chunk}};
+	}
+
+	// Call fn(Chunk&) for the chunks of the tables that have at least the components of `sig`
+	auto each_chunk(const Signature sig, std::invocable<Chunk&> auto&& fn) -> void {
+		for (auto& table : tables)
+			if ((table.signature & sig) == sig)
+				for (auto& chunk : table.chunks)
+					std::invoke(fn, chunk);
+	}
+
+	auto each_chunk(const Signature sig, std::invocable<const Chunk&> auto&& fn) const -> void {
+		for (const auto& table : tables)
+			if ((table.signature & sig) == sig)
+				for (const auto& chunk : table.chunks)
+					std::invoke(fn, chunk);
+	}
+
+private:
+	template <type::Any<As...> A>
+	static consteval auto bit() -> size_t {
+		return type::index_of<A, As...>();
+	}
+
+	// The last chunk of the table, a new one if it is full
+	auto chunk_with_room(Table& table) -> Chunk& {
+		if (table.chunks.empty() or table.chunks.back().size() == chunk_rows) {
+			auto& chunk = table.chunks.emplace_back(resource);
+			chunk.entities.reserve(chunk_rows);
+			(
+				std::invoke([&] {
+					if (table.signature.test(bit<As>())) {
+						chunk.template column<As>().reserve(chunk_rows);
+						chunk.template ticks_of<As>().reserve(chunk_rows);
+					}
+				})
+				, ...
+			);
+		}
+
+		return table.chunks.back();
+	}
+
+	auto table_index(const Signature sig) -> Index {
+		if (const auto it = table_of.find(sig); it != table_of.end())
+			return it->second;
+
+		const auto t = static_cast<Index>(tables.size());
+		tables.push_back(Table{ .signature = sig, .chunks = std::pmr::vector<Chunk>{resource} });
+		table_of.emplace(sig, t);
+		return t;
+	}
+
+	// Move the entity to the Table of `to` carrying over the components they have in common.
+	auto move(const Index idx, const Signature to) -> void {
+		const auto from = locations[idx];
+		const auto from_sig = signature(idx);
+
+		if (from_sig == to)
+			return;
+
+		if (to.any()) {
+			const auto t = table_index(to);	// May grow tables, take references after this
+			auto& table = tables[t];
+			auto& chunk = chunk_with_room(table);
+			(
+				std::invoke([&] {
+					if (not to.test(bit<As>()))
+						return;
+
+					auto& column = chunk.template column<As>();
+					auto& ticks = chunk.template ticks_of<As>();
+					if (from_sig.test(bit<As>())) {
+						auto& source = tables[from.table].chunks[from.chunk];
+						column.push_back(std::move(source.template column<As>()[from.row]));
+						ticks.push_back(source.template ticks_of<As>()[from.row]);
+					}
+					else {
+						column.emplace_back();
+						ticks.emplace_back();
+					}
+				})
+				, ...
+			);
+
+			locations[idx] = Location{
+				.table = t,
+				.chunk = static_cast<Index>(table.chunks.size() - 1),
+				.row = static_cast<Index>(chunk.size()),
+			};
+			chunk.entities.push_back(idx);
+			++table.size;
+		}
+		else
+			locations[idx] = Location{};
+
+		if (from.table != null)
+			remove_row(from);
+	}
+
+	// Swap the last row of the Table into the hole
+	auto remove_row(const Location loc) -> void {
+		auto& table = tables[loc.table];
+		auto& hole = table.chunks[loc.chunk];
+		auto& last = table.chunks.back();
+		const auto last_row = last.size() - 1;
+
+		if (&hole != &last or loc.row != last_row) {
+			(
+				std::invoke([&] {
+					if (table.signature.test(bit<As>())) {
+						hole.template column<As>()[loc.row] = std::move(last.template column<As>()[last_row]);
+						hole.template ticks_of<As>()[loc.row] = last.template ticks_of<As>()[last_row];
+					}
+				})
+				, ...
+			);
+
+			const auto moved = last.entities[last_row];
+			hole.entities[loc.row] = moved;
+			locations[moved] = loc;
+		}
+
+		(
+			std::invoke([&] {
+				if (table.signature.test(bit<As>())) {
+					last.template column<As>().pop_back();
+					last.template ticks_of<As>().pop_back();
+				}
+			})
+			, ...
+		);
+		last.entities.pop_back();
+
+		if (last.entities.empty())
+			table.chunks.pop_back();
+
+		--table.size;
+	}
+};
+
+namespace detail {
+
+template <template <typename...> typename To, typename Tuple>
+struct Rebind;
+
+template <template <typename...> typename To, typename... Ts>
+struct Rebind<To, std::tuple<Ts...>> {
+	using Type = To<Ts...>;
+};
+
+template <bool Keep, typename C>
+using Keep_If = std::conditional_t<Keep, std::tuple<C>, std::tuple<>>;
+
+}// detail
+
+// Split the components of an ECS by where they are stored
+template <typename... Cs>
+using Columns_Of = detail::Rebind<Columns, decltype(std::tuple_cat(std::declval<detail::Keep_If<not Is_Archetype<Cs>, Cs>>()...))>::Type;
+
+template <typename... Cs>
+using Archetypes_Of = detail::Rebind<Archetypes, decltype(std::tuple_cat(std::declval<detail::Keep_If<Is_Archetype<Cs>, Cs>>()...))>::Type;
+
+}// component::storage
+
+// TODO: The components need rework to be flexible. The problem is that if the templates
+//       are kept then the Components... cant really be passed to App...
+//       Components that are not in _ALL_COMPONENTS can be registered at runtime in the meantime,
+//       see Basic_ECS::register_component().
+
+// An interned string, see name::Table. Default Names are only numbered and formatted when shown,
+// so entities with no name set cost no allocation.
+struct Name {
+private:
+	inline static auto counter = std::atomic<uint32_t>{1};
+
+public:
+	name::Id id;
+	uint32_t number;	// Of the default Names
+
+public:
+	Name()
+		: id{name::Id::null()}
+		, number{counter.fetch_add(1, std::memory_order_relaxed)}
+	{}
+
+	Name(const std::string_view str)
+		: id{name::Table::global().intern(str)}
+		, number{0}
+	{}
+
+	auto is_default() const -> bool {
+		return id.is_null();
+	}
+
+	// Empty for the default Names
+	auto view() const -> std::string_view {
+		return is_default() ? std::string_view{} : name::Table::global().view(id);
+	}
+
+	auto str() const -> std::string {
+		return is_default() ? fmt::format("Unamed Entity {}", number) : std::string{view()};
+	}
+
+	auto operator== (const Name&) const -> bool = default;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Name)
+};
+
+// Transform, Sprite and Position are what the hot loops iterate together
+struct Transform {
+	using Storage = storage::Archetype;
+
+	glm::mat4 trans = math::identity<glm::mat4>;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Transform)
+};
+
+struct Sprite {
+	using Storage = storage::Archetype;
+
+	glm::vec4 color = math::identity<glm::vec4>;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Sprite)
+};
+
+struct Camera {
+	using Storage = storage::Sparse;	// Only a handful of entities are cameras
+
+	camera::Scene_Camera camera;
+	bool has_fixed_aspect_ratio = false;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Camera)
+};
+
+struct Position {
+	using Storage = storage::Archetype;
+
+	glm::vec3 position;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Position)
+};
+
+// Attaches the Transform of an entity to the one of its parent, see Transform_Hierarchy
+struct Parent {
+	using Storage = storage::Sparse;	// Most entities are roots
+
+	entity::Handle handle;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Parent)
+};
+
+#define _ALL_COMPONENTS \
+	component::Name,	\
+	component::Transform,	\
+	component::Sprite,	\
+	component::Camera,	\
+	component::Position,	\
+	component::Parent
+	/* Add new component here with no comma at the end and dont forget the '\' at the end of the item above */
+
+}// sage::ecs::components
+
+
+namespace snapshot {
+
+struct Access;	// See src/ecs_snapshot.hpp
+
+}// ecs::snapshot
+
+// Options of Basic_ECS::par_each/par_reduce, serial_threshold counts candidate entities. A chunk_size
+// of 0 picks ~16KiB worth of components, Archetype chunks are taken as they are.
+using Parallel = job::Parallel;
+
+// The components that Basic_ECS::create_n() copies into every entity it creates:
+//
+// const auto water = Prefab{component::Name{"Tile of Water"}, component::Sprite{blue}};
+// const auto tiles = ecs.create_n(water, 10'000);
+//
+template <typename... Cs>
+	requires (sizeof...(Cs) > 0) and type::Unique<Cs...>
+struct Prefab {
+	std::tuple<Cs...> components;
+
+	Prefab(Cs... cs)
+		: components{std::move(cs)...}
+	{}
+};
+
+// Components are handed out as references (set_components, view) or pointers (components_of)
+// that are null when the entity does not have the component.
+template <component::Concept... Components>
+struct Basic_ECS {
+	friend struct snapshot::Access;
+
+	using Handles = std::vector<entity::Handle>;
+	using Component_Storage = component::storage::Columns_Of<Components...>;
+	using Archetype_Storage = component::storage::Archetypes_Of<Components...>;
+	using Signature = std::bitset<sizeof...(Components)>;
+	using Signatures = std::pmr::vector<Signature>;
+	using Tick = component::storage::Tick;
+
+	// One of Components, const for read only access that does not count as a change
+	template <typename C>
+	static constexpr auto is_component = type::Any<std::remove_const_t<C>, Components...>;
+
+	static constexpr auto has_names = type::Any<component::Name, Components...>;
+
+	// Returned to the user but should only be constructed and assigned by ECS.
+	struct Entity {
+		friend struct Basic_ECS;	// Only ECS can tweak internals
+
+	private:
+		entity::Handle _handle;
+		Basic_ECS* ecs;
+
+	public:
+		Entity()
+			: ecs{nullptr}
+		{}
+
+		Entity(const entity::Handle handle, Basic_ECS* _parent)
+			: _handle{handle}
+			, ecs{_parent}
+		{}
+
+		Entity(Entity&& e)
+			: _handle{std::exchange(e._handle, entity::Handle::null())}
+			, ecs{std::exchange(e.ecs, nullptr)}
+		{}
+
+		auto operator= (Entity&& e) -> Entity& {
+			SAGE_ASSERT(e.ecs != nullptr, "Attempting to assign from a null Entity");
+			SAGE_ASSERT(ecs == nullptr or ecs == e.ecs, "Entities do not come from the same ECS");
+
+			_handle = std::exchange(e._handle, entity::Handle::null());
+			ecs = std::exchange(e.ecs, nullptr);
+			return *this;
+		}
+
+						// See Basic_ECS for details
+	public:
+		template <typename... Cs>
+		auto set(Cs&&... cs) -> decltype(auto) {
+			SAGE_ASSERT(ecs != nullptr);
+			return ecs->set_components<Cs...>(*this, std::forward<Cs>(cs)...);
+		}
+
+		template <typename... Cs>
+		auto remove() -> decltype(auto) {
+			SAGE_ASSERT(ecs != nullptr);
+			return ecs->remove_components<Cs...>(*this);
+		}
+
+		template <typename... Cs>
+		auto components() -> decltype(auto) {
+			SAGE_ASSERT(ecs != nullptr);
+			return ecs->components_of<Cs...>(*this);
+		}
+
+		template <typename... Cs>
+		auto has() -> decltype(auto) {
+			SAGE_ASSERT(ecs != nullptr);
+			return ecs->has_components<Cs...>(*this);
+		}
+
+		auto is_valid() const -> bool {
+			return ecs->is_valid(*this);
+		}
+
+		auto operator== (const Entity& e) const -> bool {
+			return ecs != nullptr and e.ecs != nullptr and _handle == e._handle and ecs == e.ecs;
+		}
+
+		auto handle() const -> entity::Handle { return _handle; }
+
+	public:
+		friend FMT_FORMATTER(Entity);
+	};
+
+	// Structural changes recorded while it is not safe to make them, e.g. while iterating a view
+	// or from a par_each worker, and applied later by Basic_ECS::play_commands().
+	//
+	// auto& cmds = ecs.commands();	// The buffer of the calling thread
+	// for (auto&& [handle, health] : ecs.view<Health>())
+	//     if (health.value <= 0) {
+	//         cmds.destroy(handle);
+	//         const auto corpse = cmds.create();
+	//         cmds.set(corpse, Sprite{...}, Position{...});
+	//     }
+	//
+	// Operations are appended to a linear log, and the components to set to one array per type
+	// which lets playback apply them type by type.
+	struct Commands {
+		friend struct Basic_ECS;
+
+		// An existing entity or one created by create() of the same buffer
+		struct Target {
+			entity::Handle handle;
+			uint32_t pending = null;
+			uint32_t buffer = null;		// Of a pending entity, its index only means something there
+
+			static constexpr auto null = std::numeric_limits<uint32_t>::max();
+
+			Target(const entity::Handle h)
+				: handle{h}
+			{}
+
+			Target(const Entity& e)
+				: handle{e.handle()}
+			{}
+
+		private:
+			friend struct Commands;
+
+			Target() = default;
+		};
+
+	private:
+		enum class Kind : uint8_t { Set, Remove, Destroy };
+
+		struct Op {
+			Kind kind;
+			uint8_t component;	// Index in Components, for Set/Remove
+			Target target;
+			uint32_t value;		// Index in the values of the component, for Set
+		};
+
+		static_assert(sizeof...(Components) <= std::numeric_limits<uint8_t>::max());
+
+		std::vector<Op> ops;
+		std::tuple<std::vector<Components>...> values;
+		uint32_t creates = 0;
+
+		static inline auto next_id = std::atomic<uint32_t>{0};
+		uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+
+	public:
+		// The entity is created on playback, until then it can only be the target of other commands
+		// of this buffer
+		[[nodiscard]]
+		auto create() -> Target {
+			auto t = Target{};
+			t.pending = creates++;
+			t.buffer = id;
+			return t;
+		}
+
+		auto destroy(const Target t) -> void {
+			check(t);
+			ops.push_back({ .kind = Kind::Destroy, .component = 0, .target = t, .value = 0 });
+		}
+
+		template <typename... Cs>
+			requires (sizeof...(Cs) > 0) and (type::Any<std::remove_cvref_t<Cs>, Components...> and ...) and type::Unique<std::remove_cvref_t<Cs>...>
+		auto set(const Target t, Cs&&... cs) -> void {
+			check(t);
+			(
+				std::invoke([&] {
+					using C = std::remove_cvref_t<Cs>;
+					auto& vs = std::get<std::vector<C>>(values);
+					ops.push_back({
+							.kind = Kind::Set,
+							.component = static_cast<uint8_t>(type::index_of<C, Components...>()),
+							.target = t,
+							.value = static_cast<uint32_t>(vs.size())
+						});
+					vs.push_back(std::forward<Cs>(cs));
+				})
+				, ...
+			);
+		}
+
+		template <typename... Cs>
+			requires (sizeof...(Cs) > 0) and (type::Any<Cs, Components...> and ...) and type::Unique<Cs...>
+		auto remove(const Target t) -> void {
+			check(t);
+			(
+				ops.push_back({
+						.kind = Kind::Remove,
+						.component = static_cast<uint8_t>(type::index_of<Cs, Components...>()),
+						.target = t,
+						.value = 0
+					})
+				, ...
+			);
+		}
+
+		auto empty() const -> bool {
+			return ops.empty() and creates == 0;
+		}
+
+		auto clear() -> void {
+			ops.clear();
+			std::apply([] (auto&... vs) { (vs.clear(), ...); }, values);
+			creates = 0;
+		}
+
+	private:
+		auto check([[maybe_unused]] const Target t) const -> void {
+			SAGE_ASSERT(t.pending == Target::null or t.buffer == id, "Pending entity of another command buffer");
+		}
+	};
+
+	// Filters of View on the Ticks of its first component, see added() and changed()
+	struct Unfiltered {};
+	struct Added_Since { Tick tick; };
+	struct Changed_Since { Tick tick; };
+
+	// See view(). Walks the Driver, a range of candidate indices or archetype Rows, and keeps the
+	// entities whose Signature contains the requested one and that pass the Filter.
+	template <std::ranges::forward_range Driver, typename Filter, typename... Cs>
+	struct View : std::ranges::view_interface<View<Driver, Filter, Cs...>> {
+		using Value = std::tuple<entity::Handle, Cs&...>;
+		using Row = Archetype_Storage::Row;
+		using First = std::remove_const_t<type::Front<Cs...>>;
+
+		// Every Row of the matching archetypes has all the Cs, no need to check nor look them up
+		static constexpr auto streamed =
+			std::same_as<std::ranges::range_value_t<Driver>, Row>
+			and (component::storage::Is_Archetype<std::remove_const_t<Cs>> and ...)
+			;
+
+		// Every set bit is an entity with all the Cs, the bits of dead slots are cleared
+		static constexpr auto tagged =
+			requires { typename Driver::Word; }
+			and (component::storage::Is_Tag<std::remove_const_t<Cs>> and ...)
+			;
+
+		struct Iterator {
+			using value_type = Value;
+			using difference_type = std::ptrdiff_t;
+
+			const View* view = nullptr;
+			std::ranges::iterator_t<const Driver> it{};
+			std::ranges::sentinel_t<const Driver> end{};
+
+			// Handing out a mutable component counts as a change
+			auto operator* () const -> Value {
+				const auto tick = view->ecs->current_tick;
+
+				if constexpr (streamed) {
+					const auto row = *it;
+					(
+						std::invoke([&] {
+							if constexpr (not std::is_const_v<Cs>)
+								row.template ticks<Cs>().changed = tick;
+						})
+						, ...
+					);
+					return { view->ecs->handles[row.entity()], row.template get<std::remove_const_t<Cs>>()... };
+				}
+				else {
+					const auto idx = index(*it);
+					(
+						std::invoke([&] {
+							if constexpr (not std::is_const_v<Cs> and not component::storage::Is_Tag<Cs>)
+								view->ecs->template column<Cs>().ticks(idx).changed = tick;
+						})
+						, ...
+					);
+					return { view->ecs->handles[idx], view->ecs->template column<Cs>().get(idx)... };
+				}
+			}
+
+			auto operator++ () -> Iterator& {
+				++it;
+				skip();
+				return *this;
+			}
+
+			auto operator++ (int) -> Iterator {
+				auto tmp = *this;
+				++(*this);
+				return tmp;
+			}
+
+			auto operator== (const Iterator& other) const -> bool {
+				return it == other.it;
+			}
+
+			auto operator== (std::default_sentinel_t) const -> bool {
+				return it == end;
+			}
+
+			auto skip() -> void {
+				if constexpr (not (streamed or tagged) or not std::same_as<Filter, Unfiltered>)
+					while (it != end and not view->matches(*it))
+						++it;
+			}
+		};
+
+		Basic_ECS* ecs = nullptr;
+		Driver driver;
+		Signature signature;
+		Filter filter;
+
+		View() = default;
+
+		View(Basic_ECS* _ecs, Driver _driver, const Signature _signature, const Filter _filter = {})
+			: ecs{_ecs}
+			, driver{std::move(_driver)}
+			, signature{_signature}
+			, filter{_filter}
+		{}
+
+		auto begin() const -> Iterator {
+			auto it = Iterator{ .view = this, .it = rg::begin(driver), .end = rg::end(driver) };
+			it.skip();
+			return it;
+		}
+
+		auto end() const -> std::default_sentinel_t {
+			return std::default_sentinel;
+		}
+
+	private:
+		static auto index(const entity::Handle::Index idx) -> entity::Handle::Index { return idx; }
+		static auto index(const Row& row) -> entity::Handle::Index { return row.entity(); }
+
+		// Dead slots have an empty Signature so they never match
+		template <typename Candidate>
+		auto matches(const Candidate& candidate) const -> bool {
+			if constexpr (not (streamed or tagged))
+				if ((ecs->signatures[index(candidate)] & signature) != signature)
+					return false;
+
+			if constexpr (std::same_as<Filter, Unfiltered>)
+				return true;
+			else {
+				const auto& ticks = std::invoke([&] -> const component::storage::Ticks& {
+						if constexpr (streamed)
+							return candidate.template ticks<First>();
+						else
+							return ecs->template column<First>().ticks(index(candidate));
+					});
+
+				if constexpr (std::same_as<Filter, Added_Since>)
+					return ticks.added >= filter.tick;
+				else
+					return ticks.changed >= filter.tick;
+			}
+		}
+	};
+
+	// See group(). The members are the first size() elements of the packed arrays of every Cs,
+	// in the same order, so iterating is an indexed loop with no lookups nor checks.
+	template <typename... Cs>
+	struct Group {
+		Basic_ECS* ecs = nullptr;
+		size_t index = 0;
+
+		auto size() const -> size_t {
+			return ecs->groups[index].size;
+		}
+
+		auto entities() const -> std::span<const entity::Handle::Index> {
+			return ecs->template column<type::Front<Cs...>>().entities().first(size());
+		}
+
+		// Every member visited counts as a change of its mutable Cs, same as View
+		auto each(std::invocable<entity::Handle, Cs&...> auto&& fn) const -> void {
+			const auto tick = ecs->current_tick;
+			const auto members = entities();
+			auto columns = std::tie(ecs->template column<Cs>()...);
+
+			for (const auto pos : vw::iota(0ul, members.size())) {
+				(
+					std::invoke([&] {
+						if constexpr (not std::is_const_v<Cs>)
+							std::get<component::storage::Column<std::remove_const_t<Cs>>&>(columns).ticks_at(pos).changed = tick;
+					})
+					, ...
+				);
+				std::invoke(fn, ecs->handles[members[pos]], std::get<component::storage::Column<std::remove_const_t<Cs>>&>(columns).at(pos)...);
+			}
+		}
+	};
+
+	// See on_construct()
+	enum class Event : uint8_t { Construct, Update, Destroy };
+
+	using Listener = std::function<void(std::span<const entity::Handle>)>;
+
+	// See disconnect()
+	struct Connection {
+		size_t component;
+		Event event;
+		size_t index;
+	};
+
+private:
+	// The components owned by a group and the number of its members, see group()
+	struct Owned_Group {
+		Signature signature;
+		size_t size;
+	};
+
+	static constexpr auto number_of_events = 3ul;
+
+	// The events of a component in the order they happened and the listeners they go to, see notify_observers()
+	struct Observers {
+		std::array<std::vector<Listener>, number_of_events> listeners;
+		std::vector<Event> events;
+		std::vector<entity::Handle> handles;
+	};
+
+	// What the slot is indexed under and where in the bucket, see index_name()
+	struct Indexed_Name {
+		name::Id id;
+		uint32_t position = 0;
+	};
+
+private:
+	// Every container of the world below allocates through it, see memory()
+	memory::Tracking_Resource tracking;
+
+	// A slot in use holds the Handle of its entity. A free slot is a link of an intrusive free list:
+	// its index points to the next free slot (or null_index at the tail) and its generation is
+	// the one the next entity of the slot will get.
+	std::pmr::vector<entity::Handle> handles;
+	entity::Handle::Index free_head;
+	size_t _size;
+	size_t _max_capacity;
+	Signatures signatures;
+	Component_Storage components;
+	Archetype_Storage archetypes;
+	std::pmr::vector<component::storage::Erased_Column> runtime_components;	// Indexed by component::Id
+	std::unordered_map<std::string, component::Id> runtime_ids;
+	std::vector<Owned_Group> groups;
+	std::array<Observers, sizeof...(Components)> observers;
+	std::array<Signature, number_of_events> observed;	// Components with listeners, per Event
+	std::unordered_map<name::Id, std::vector<entity::Handle::Index>> named;	// See find_named()
+	std::pmr::vector<Indexed_Name> indexed_names;	// Per slot, empty without Names
+	Tick current_tick;
+	Profiler& profiler;
+
+	// One per thread that asked for one, see commands()
+	std::mutex commands_mutex;
+	std::unordered_map<std::thread::id, std::unique_ptr<Commands>> command_buffers;
+
+
+public:
+	// The capacity doubles whenever create() runs out of slots, up to max_capacity if given,
+	// otherwise up to what Handles can address.
+	// Growth is reported to the profiler, if it shows up often increase the initial_capacity.
+	//
+	// The storage of entities and components comes from `resource`, e.g. a memory::Arena of the world.
+	// The resource must outlive the ECS.
+	Basic_ECS(
+		const size_t initial_capacity,
+		const std::optional<size_t> max_capacity = std::nullopt,
+		Profiler& prof = Profiler::global,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+	)
+		: tracking{resource}
+		, handles(initial_capacity, &tracking)
+		, free_head{entity::Handle::null_index}
+		, _size{0}
+		, _max_capacity{max_capacity.value_or(entity::Handle::null_index)}
+		, signatures(initial_capacity, &tracking)
+		, components{initial_capacity, &tracking}
+		, archetypes{initial_capacity, &tracking}
+		, runtime_components{&tracking}
+		, indexed_names(has_names ? initial_capacity : 0, &tracking)
+		, current_tick{1}	// Ticks of components start at 0, so everything is recent since tick 0
+		, profiler{prof}
+	{
+		SAGE_ASSERT(_max_capacity <= entity::Handle::null_index, "Handles can address at most {} entities", entity::Handle::null_index);
+		SAGE_ASSERT(initial_capacity <= _max_capacity);
+
+		release_all_slots();
+	}
+
+public:
+	[[nodiscard]]
+	auto create() -> std::optional<Entity> {
+		if (free_head == entity::Handle::null_index and not grow())
+			return std::nullopt;
+
+		const auto idx = free_head;
+		auto& slot = handles[idx];
+		SAGE_ASSERT(not is_alive(idx), "Free list handed out a slot that is in use");
+
+		components.apply([&] (const auto& column) {
+				SAGE_ASSERT(idx < column.capacity(), "Components must be allocated");
+				SAGE_ASSERT(not column.contains(idx), "Cleanup has not been performed since last destroy/initialization");
+			});
+		SAGE_ASSERT(archetypes.signature(idx).none(), "Cleanup has not been performed since last destroy/initialization");
+		SAGE_ASSERT(signatures[idx].none(), "Cleanup has not been performed since last destroy/initialization");
+		SAGE_ASSERT(rg::none_of(runtime_components, [&] (const auto& column) { return column.contains(idx); }), "Cleanup has not been performed since last destroy/initialization");
+
+		free_head = slot.index();
+		slot = entity::Handle{idx, slot.generation()};
+		++_size;
+
+		return std::make_optional<Entity>(slot, this);	// Wont bother dealing with "cannot be converted from brace enclosed initializer list to Entity"...
+	}
+
+	auto null() -> Entity {
+		return { entity::Handle::null(), this };
+	}
+
+	// Create up to `count` entities at once, each with a copy of the components of the prefab, and
+	// call init(i, handle, Cs&...) for the ith of them to tweak its components.
+	// Returns the handles, fewer than `count` if max_capacity() is reached.
+	//
+	// The slots of destroyed entities are reused first, then the capacity grows once for the rest,
+	// so the slots are a contiguous range unless there were holes. Every column is filled at once,
+	// a page of a contiguous range or an Archetype chunk at a time, and stamped with the same ticks.
+	template <typename... Cs>
+		requires (type::Any<Cs, Components...> and ...)
+	auto create_n(const Prefab<Cs...>& prefab, const size_t count, std::invocable<size_t, entity::Handle, Cs&...> auto&& init) -> Handles {
+		using Index = entity::Handle::Index;
+
+		auto idxs = std::vector<Index>{};
+		idxs.reserve(count);
+
+		const auto take = [&] (const size_t k) {
+				for ([[maybe_unused]] const auto _ : vw::iota(0ul, k)) {
+					const auto idx = free_head;
+					SAGE_ASSERT(not is_alive(idx) and signatures[idx].none(), "Cleanup has not been performed since last destroy/initialization");
+
+					free_head = handles[idx].index();
+					handles[idx] = entity::Handle{idx, handles[idx].generation()};
+					idxs.push_back(idx);
+				}
+				_size += k;
+			};
+
+		// The free slots first, then the new ones of a single growth
+		take(std::min(count, handles.size() - _size));
+		if (idxs.size() < count) {
+			reserve(_size + count - idxs.size());
+			take(std::min(count - idxs.size(), handles.size() - _size));
+		}
+		const auto n = idxs.size();
+
+		const auto sig = signature_of<Cs...>();
+		for (const auto idx : idxs)
+			signatures[idx] = sig;
+
+		// Archetype components in one go, the other columns one after the other
+		const auto ticks = component::storage::Ticks{ .added = current_tick, .changed = current_tick };
+		const auto archetype_components = std::tuple_cat(std::invoke([&] {
+				if constexpr (component::storage::Is_Archetype<Cs>)
+					return std::tie(std::get<Cs>(prefab.components));
+				else
+					return std::tuple{};
+			})...);
+		std::apply([&] (const auto&... as) {
+				if constexpr (sizeof...(as) > 0)
+					archetypes.append(idxs, ticks, as...);
+			}, archetype_components);
+
+		(
+			std::invoke([&] {
+				if constexpr (not component::storage::Is_Archetype<Cs>)
+					column<Cs>().append(idxs, ticks, std::get<Cs>(prefab.components));
+			})
+			, ...
+		);
+
+		for (const auto idx : idxs) {
+			record(Event::Construct, idx, sig);
+			join_groups(idx, Signature{});
+			if constexpr (type::Any<component::Name, Cs...>)
+				index_name(idx);
+		}
+
+		auto created = Handles(n);
+		for (const auto [i, idx] : idxs | vw::enumerate) {
+			created[static_cast<size_t>(i)] = handles[idx];
+			std::invoke(init, static_cast<size_t>(i), handles[idx], column<Cs>().get(idx)...);
+		}
+
+		return created;
+	}
+
+	template <typename... Cs>
+		requires (type::Any<Cs, Components...> and ...)
+	auto create_n(const Prefab<Cs...>& prefab, const size_t count) -> Handles {
+		return create_n(prefab, count, [] (size_t, entity::Handle, Cs&...) {});
+	}
+
+	auto destroy(Entity& e) -> bool {
+		if (not is_valid(e))
+			return false;
+		else {
+			destroy_slot(e._handle.index());
+			e._handle = entity::Handle::null();
+			return true;
+		}
+	}
+
+	// The command buffer of the calling thread, safe to call from any thread.
+	// Keep the reference around instead of asking again for every command.
+	auto commands() -> Commands& {
+		LOCK_GUARD(commands_mutex);
+		auto& buffer = command_buffers[std::this_thread::get_id()];
+		if (buffer == nullptr)
+			buffer = std::make_unique<Commands>();
+		return *buffer;
+	}
+
+	// The sync point: apply the commands of all the buffers and clear them.
+	// Must not run while commands are being recorded or views iterated.
+	//
+	// The commands on one entity are coalesced first: the last set of a component wins, a remove
+	// cancels a previous set (and vice versa), and a destroy cancels everything before it.
+	// Commands of the same buffer keep their order, the order between buffers is unspecified.
+	// Then the survivors are applied in batches: creates, removes, each entity is moved to
+	// its final archetype once, sets one component type at a time and finally destroys.
+	// Commands on entities that are no longer valid are dropped.
+	auto play_commands() -> void {
+		using Index = entity::Handle::Index;
+		using Op = Commands::Op;
+		using Kind = Commands::Kind;
+
+		LOCK_GUARD(commands_mutex);
+
+		auto buffers = std::vector<Commands*>{};
+		for (auto& [_, buffer] : command_buffers)
+			if (not buffer->empty())
+				buffers.push_back(buffer.get());
+
+		if (buffers.empty())
+			return;
+
+		struct Resolved {
+			Index entity;
+			uint32_t buffer, seq;
+			const Op* op;
+		};
+
+		// Create the pending entities that are not destroyed in the same buffer and resolve all targets
+		auto resolved = std::vector<Resolved>{};
+		for (const auto [b, buffer] : buffers | vw::enumerate) {
+			auto created = std::vector<entity::Handle>(buffer->creates, entity::Handle::null());
+			auto cancelled = std::vector<bool>(buffer->creates, false);
+			for (const auto& op : buffer->ops)
+				if (op.kind == Kind::Destroy and op.target.pending != Commands::Target::null)
+					cancelled[op.target.pending] = true;
+
+			for (const auto i : vw::iota(0u, buffer->creates))
+				if (not cancelled[i]) {
+					if (auto entt = create(); entt.has_value())
+						created[i] = entt->handle();
+					else
+						SAGE_LOG_WARN("ECS is full, dropping commands of a pending entity");
+				}
+
+			for (const auto [seq, op] : buffer->ops | vw::enumerate) {
+				SAGE_ASSERT(op.target.pending == Commands::Target::null or op.target.buffer == buffer->id, "Pending entity of another command buffer");
+				const auto handle = op.target.pending == Commands::Target::null ? op.target.handle : created[op.target.pending];
+				if (is_valid(handle))
+					resolved.push_back({ handle.index(), static_cast<uint32_t>(b), static_cast<uint32_t>(seq), &op });
+			}
+		}
+
+		// Group per entity, in order within each buffer
+		rg::sort(resolved, {}, [] (const Resolved& r) { return std::tuple{r.entity, r.buffer, r.seq}; });
+
+		struct Set {
+			Index entity;
+			uint32_t buffer, value;
+			bool is_added;
+		};
+
+		auto sets = std::array<std::vector<Set>, sizeof...(Components)>{};
+		auto removes = std::vector<std::pair<Index, Signature>>{};
+		auto destroys = std::vector<Index>{};
+
+		for (auto first = resolved.begin(); first != resolved.end(); ) {
+			const auto entity = first->entity;
+			const auto last = std::find_if(first, resolved.end(), [&] (const Resolved& r) { return r.entity != entity; });
+
+			// Index of the Resolved of the last set per component
+			auto last_set = std::array<const Resolved*, sizeof...(Components)>{};
+			auto to_remove = Signature{};
+			auto is_destroyed = false;
+
+			for (const auto& r : std::ranges::subrange(first, last)) {
+				switch (r.op->kind) {
+				case Kind::Set:
+					last_set[r.op->component] = &r;
+					to_remove.reset(r.op->component);
+					break;
+				case Kind::Remove:
+					last_set[r.op->component] = nullptr;
+					to_remove.set(r.op->component);
+					break;
+				case Kind::Destroy:
+					is_destroyed = true;
+					break;
+				}
+			}
+
+			if (is_destroyed)
+				destroys.push_back(entity);
+			else {
+				if ((to_remove & signatures[entity]).any())
+					removes.emplace_back(entity, to_remove & signatures[entity]);
+
+				for (const auto [c, r] : last_set | vw::enumerate)
+					if (r != nullptr)
+						sets[c].push_back({ entity, r->buffer, r->op->value, not signatures[entity].test(c) });
+			}
+
+			first = last;
+		}
+
+		for (const auto& [entity, to_remove] : removes)
+			remove_slot_components(entity, to_remove);
+
+		// Move each entity to its final archetype once, then the sets are assignments
+		auto had = std::vector<std::pair<Index, Signature>>{};
+		{
+			auto to_add = std::unordered_map<Index, Signature>{};
+			for (const auto& per_component : sets)
+				for (const auto& set : per_component)
+					to_add[set.entity].set(&per_component - sets.data());
+
+			had.reserve(to_add.size());
+			for (const auto& [entity, sig] : to_add) {
+				had.emplace_back(entity, signatures[entity]);
+				archetypes.extend(entity, to_archetype_signature(sig));
+				signatures[entity] |= sig;
+			}
+		}
+
+		[&] <size_t... I> (std::index_sequence<I...>) {
+			(
+				std::invoke([&] {
+					using C = type::At<I, Components...>;
+					auto&& col = column<C>();
+					for (const auto& set : sets[I]) {
+						col.set(set.entity, std::move(std::get<std::vector<C>>(buffers[set.buffer]->values)[set.value]));
+						if constexpr (std::same_as<C, component::Name>)
+							index_name(set.entity);
+						touch<C>(set.entity, set.is_added);
+						record<C>(set.is_added ? Event::Construct : Event::Update, set.entity);
+					}
+				})
+				, ...
+			);
+		}(std::index_sequence_for<Components...>{});
+
+		for (const auto& [entity, sig] : had)
+			join_groups(entity, sig);
+
+		for (const auto entity : destroys)
+			destroy_slot(entity);
+
+		for (auto* buffer : buffers)
+			buffer->clear();
+	}
+
+	// The Cs arguments can be deduced so prefer to call it without explicit template parameters:
+	//
+	// ecs.set_components(entt, Component1{...}, Component2{...});
+	//
+	template <typename... Cs>
+		requires (sizeof...(Cs) > 0) and (type::Any<Cs, Components...> and ...) and type::Unique<Cs...>
+	auto set_components(const Entity& e, Cs&&... cs) -> decltype(auto /* optional<tuple<Cs&...>> */) {
+		using Optional = std::optional<std::tuple<Cs&...>>;
+
+		if (not is_valid(e))
+			return Optional{std::nullopt};
+		else {
+			const auto idx = e._handle.index();
+			const auto had = signatures[idx];
+
+			// Move to the final archetype once, otherwise the references of the
+			// first components would dangle when setting the rest.
+			archetypes.extend(idx, Archetype_Storage::template signature_of<Cs...>());
+			signatures[idx] |= signature_of<Cs...>();
+
+			auto set = Optional{std::forward_as_tuple(
+					column<Cs>().set(idx, std::forward<Cs>(cs))
+					...
+				)};
+			(touch<Cs>(idx, not had.test(type::index_of<Cs, Components...>())), ...);
+			(record<Cs>(had.test(type::index_of<Cs, Components...>()) ? Event::Update : Event::Construct, idx), ...);
+			join_groups(idx, had);
+			if constexpr (type::Any<component::Name, Cs...>)
+				index_name(idx);
+			return set;
+		}
+	}
+
+	template <typename... Cs>
+		requires (sizeof...(Cs) > 0) and (type::Any<Cs, Components...> and ...) and type::Unique<Cs...>
+	auto remove_components(const Entity& e) -> bool {
+		if (not is_valid(e))
+			return false;
+		else {
+			const auto idx = e._handle.index();
+			record(Event::Destroy, idx, signature_of<Cs...>() & signatures[idx]);
+			leave_groups(idx, signature_of<Cs...>());
+			if constexpr (type::Any<component::Name, Cs...>)
+				unindex_name(idx);
+			archetypes.shrink(idx, Archetype_Storage::template signature_of<Cs...>());
+			signatures[idx] &= ~signature_of<Cs...>();
+			(column<Cs>().erase(idx), ...);
+			return true;
+		}
+	}
+
+	// Remove the Tag C from every entity that has it, e.g. to reset a marker every frame.
+	// Returns how many had it.
+	template <typename C>
+		requires type::Any<C, Components...> and component::storage::Is_Tag<C>
+	auto remove_all() -> size_t {
+		auto& col = column<C>();
+		const auto removed = col.size();
+
+		const auto bit = signature_of<C>();
+		for (const auto idx : component::storage::Set_Bits<1>{ { col.words().data() }, 0, col.words().size() }) {
+			record<C>(Event::Destroy, idx);
+			signatures[idx] &= ~bit;
+		}
+
+		col.clear();
+		return removed;
+	}
+
+	// With no Cs, fetch all the Components.
+	// Mutable pointers count as a change of the components found, ask for const Cs to only read.
+	template <typename... Cs>
+		requires (is_component<Cs> and ...) and type::Unique<std::remove_const_t<Cs>...>
+	auto components_of(const Entity& e) -> decltype(auto /* optional<tuple<Cs*...>> */) {
+		if constexpr (sizeof...(Cs) == 0)
+			return components_of<Components...>(e);
+		else {
+			using Optional = std::optional<std::tuple<Cs*...>>;
+
+			if (not is_valid(e))
+				return Optional{std::nullopt};
+			else {
+				const auto idx = e._handle.index();
+				auto found = Optional{std::tuple<Cs*...>{column<Cs>().find(idx)...}};
+				(
+					std::invoke([&] {
+						if constexpr (not std::is_const_v<Cs>)
+							if (std::get<Cs*>(*found) != nullptr)
+								touch<Cs>(idx, false);
+					})
+					, ...
+				);
+				return found;
+			}
+		}
+	}
+
+	template <typename... Cs>
+		requires (sizeof...(Cs) > 0) and (type::Any<Cs, Components...> and ...) and type::Unique<Cs...>
+	auto has_components(const Entity& e) const -> decltype(auto /* optional<tuple<bool...>> */) {
+		using Optional = std::optional<decltype(std::make_tuple(
+				(sizeof(Cs), true)
+				...
+			))>;
+
+		if (not is_valid(e))
+			return Optional{std::nullopt};
+		else {
+			const auto& sig = signatures[e._handle.index()];
+			return Optional{std::make_tuple(sig.test(type::index_of<Cs, Components...>())...)};
+		}
+	}
+
+	// Number of entities that have the component C
+	template <type::Any<Components...> C>
+	auto count() const -> size_t {
+		return column<C>().size();
+	}
+
+	// Return a view of tuples over the entities that have all the Cs:
+	//
+	// for (auto&& [handle, position, sprite] : ecs.view<Position, Sprite>())
+	//     ...
+	//
+	// What drives the iteration:
+	// - If any of the Cs is Sparse, the smallest Sparse column. A view of a rare component only
+	//   touches the entities that have it.
+	// - If any of the Cs is an Archetype component, the chunks of the matching archetypes.
+	//   When all the Cs are Archetype components the chunks are streamed with no checks at all.
+	// - If any of the Cs is a Tag, the bits set in all the Tags, skipping 64 slots per empty word.
+	//   When all the Cs are Tags the bits are the entities with no checks at all.
+	// - Otherwise every slot.
+	// Candidates are then kept if their Signature contains the Cs, a single mask test per entity.
+	//
+	// The view can be used as const, it is a handle to the ECS like a span is to its data.
+	//
+	// Every entity visited counts as a change of its mutable Cs, so ask for const Cs to only read them:
+	//
+	// for (auto&& [handle, trans, sprite] : ecs.view<const Transform, const Sprite>())
+	//     ...
+	//
+	// CAUTION:
+	// Do not add/remove the Cs of entities while iterating, Sparse columns and Archetypes move
+	// their elements around.
+	//
+	// TODO: if sizeof...(Cs) == 0 return all
+	template <typename... Cs>
+		requires (sizeof...(Cs) > 0) and (is_component<Cs> and ...) and type::Unique<std::remove_const_t<Cs>...>
+	auto view() -> decltype(auto /* View<Driver, Unfiltered, Cs...> */) {
+		return make_view<Cs...>(Unfiltered{});
+	}
+
+	// Owning group of the Sparse Cs, created the first time it is asked for:
+	//
+	// ecs.group<Position, Velocity>().each([] (entity::Handle, Position& pos, const Velocity& vel) {
+	//     pos.position += vel.velocity;
+	// });
+	//
+	// The entities that have all the Cs are kept at the front of the packed arrays of the Cs,
+	// in the same order, as components are set/removed and entities are destroyed. Iterating the
+	// group is then a loop over parallel arrays, use it for the combinations visited every frame.
+	//
+	// A component can be owned by a single group, which costs a few swaps whenever an entity
+	// joins or leaves the group.
+	//
+	// CAUTION:
+	// Same as view(), do not add/remove the Cs of entities while iterating.
+	template <typename... Cs>
+		requires (sizeof...(Cs) > 0) and (is_component<Cs> and ...) and type::Unique<std::remove_const_t<Cs>...>
+			and (component::storage::Is_Sparse<std::remove_const_t<Cs>> and ...)
+	auto group() -> Group<Cs...> {
+		const auto sig = signature_of<std::remove_const_t<Cs>...>();
+
+		if (const auto found = rg::find(groups, sig, &Owned_Group::signature); found != groups.end())
+			return { .ecs = this, .index = static_cast<size_t>(found - groups.begin()) };
+
+		SAGE_ASSERT(rg::none_of(groups, [&] (const Owned_Group& g) { return (g.signature & sig).any(); }),
+				"A component can be owned by a single group");
+
+		groups.push_back({ .signature = sig, .size = 0 });
+		fill_group(groups.back());
+		return { .ecs = this, .index = groups.size() - 1 };
+	}
+
+	// Listen to the lifetime of the component C, e.g. to keep a lookup table or a spatial grid in sync:
+	// - Construct: C was set on an entity that did not have it.
+	// - Update:    C was set on an entity that already had it. Writes through views and references
+	//              are not events, see changed() for those.
+	// - Destroy:   C was removed, its entity destroyed or the ECS cleared.
+	//
+	// Events are recorded by set_components(), remove_components(), destroy(), create_n(),
+	// play_commands() and clear() and delivered in batches by notify_observers(). Loading a
+	// snapshot replaces the world and records nothing.
+	//
+	// Components with no listener record nothing, a single bit test per component set/removed.
+	template <type::Any<Components...> C>
+	auto on_construct(Listener listener) -> Connection {
+		return connect(type::index_of<C, Components...>(), Event::Construct, std::move(listener));
+	}
+
+	template <type::Any<Components...> C>
+	auto on_update(Listener listener) -> Connection {
+		return connect(type::index_of<C, Components...>(), Event::Update, std::move(listener));
+	}
+
+	template <type::Any<Components...> C>
+	auto on_destroy(Listener listener) -> Connection {
+		return connect(type::index_of<C, Components...>(), Event::Destroy, std::move(listener));
+	}
+
+	auto disconnect(const Connection connection) -> void {
+		const auto e = std::to_underlying(connection.event);
+		auto& listeners = observers[connection.component].listeners[e];
+		SAGE_ASSERT(connection.index < listeners.size());
+
+		listeners[connection.index] = nullptr;
+		if (rg::none_of(listeners, [] (const Listener& l) { return static_cast<bool>(l); }))
+			observed[e].reset(connection.component);
+	}
+
+	// Sync point of the observers, call it once a frame e.g. after play_commands().
+	// The events of each component are delivered in the order they happened, consecutive events
+	// of the same kind in a single call. Handles of Destroy events are stale by then.
+	// Listeners may change the ECS, the events they cause are delivered by the next call.
+	auto notify_observers() -> void {
+		auto events = std::vector<Event>{};
+		auto entities = std::vector<entity::Handle>{};
+
+		for (auto& o : observers) {
+			if (o.events.empty())
+				continue;
+
+			std::swap(events, o.events);
+			std::swap(entities, o.handles);
+
+			for (auto first = 0ul; first < events.size(); ) {
+				const auto event = events[first];
+				const auto last = static_cast<size_t>(std::find_if(events.begin() + static_cast<std::ptrdiff_t>(first), events.end(), [&] (const Event e) { return e != event; }) - events.begin());
+
+				const auto batch = std::span<const entity::Handle>{entities}.subspan(first, last - first);
+				for (const auto& listener : o.listeners[std::to_underlying(event)])
+					if (listener)
+						std::invoke(listener, batch);
+
+				first = last;
+			}
+
+			events.clear();
+			entities.clear();
+		}
+	}
+
+	// An entity named `name`, through a hash index of the Names set with set_components(), create_n()
+	// and commands. Names written through references, e.g. from a view, are not indexed.
+	auto find_named(const std::string_view name) const -> std::optional<entity::Handle>
+		requires has_names
+	{
+		auto found = std::optional<entity::Handle>{};
+		each_named(name, [&] (const entity::Handle h) {
+				found = h;
+				return false;
+			});
+		return found;
+	}
+
+	// All the entities named `name`, see find_named()
+	auto find_all_named(const std::string_view name) const -> Handles
+		requires has_names
+	{
+		auto found = Handles{};
+		each_named(name, [&] (const entity::Handle h) {
+				found.push_back(h);
+				return true;
+			});
+		return found;
+	}
+
+	// Change tracking.
+	//
+	// The ECS keeps a tick that only moves forward with advance_tick(). Adding a component and handing
+	// it out mutably (set_components, components_of and views of non const Cs) stamps it with the
+	// current tick, so a system that remembers when it last ran only has to visit what changed since:
+	//
+	// for (auto&& [handle, trans] : ecs.changed<const Transform>(last_run))
+	//     upload(trans);
+	// last_run = ecs.advance_tick();	// What the next systems change is stamped with the new tick
+	//
+	// Mutable access is a change even if nothing is written, there is no way to tell.
+	// Ticks are 32 bits, at one tick per system per frame they wrap after months of running.
+	auto tick() const -> Tick {
+		return current_tick;
+	}
+
+	// Returns the new tick
+	auto advance_tick() -> Tick {
+		return ++current_tick;
+	}
+
+	// view<C, Cs...>() of the entities whose C was added at or after `since`, C cannot be a Tag
+	template <typename C, typename... Cs>
+		requires (is_component<C> and ... and is_component<Cs>) and type::Unique<std::remove_const_t<C>, std::remove_const_t<Cs>...>
+			and (not component::storage::Is_Tag<std::remove_const_t<C>>)
+	auto added(const Tick since) -> decltype(auto /* View<Driver, Added_Since, C, Cs...> */) {
+		return make_view<C, Cs...>(Added_Since{since});
+	}
+
+	// view<C, Cs...>() of the entities whose C was added or changed at or after `since`, C cannot be a Tag
+	template <typename C, typename... Cs>
+		requires (is_component<C> and ... and is_component<Cs>) and type::Unique<std::remove_const_t<C>, std::remove_const_t<Cs>...>
+			and (not component::storage::Is_Tag<std::remove_const_t<C>>)
+	auto changed(const Tick since) -> decltype(auto /* View<Driver, Changed_Since, C, Cs...> */) {
+		return make_view<C, Cs...>(Changed_Since{since});
+	}
+
+	// Call fn(handle, Cs&...) for the entities of view<Cs...>() on a job::Pool.
+	//
+	// The candidates of the view are split into chunks (the archetype chunks or ranges of slots worth
+	// ~16KiB of components) that the workers, and the calling thread, pick up until none are left.
+	// With less than Parallel::serial_threshold candidates the view is walked on the calling thread.
+	//
+	// Aliasing guarantees:
+	// - Every entity of the view is visited exactly once by a single thread, so fn has exclusive
+	//   access to the Cs& it is handed for the duration of the call.
+	// - fn may read anything that is not written during par_each, e.g. components outside of Cs.
+	// - fn must not touch the Cs of other entities, create/destroy entities or add/remove components,
+	//   same as when iterating a view. Record such changes and apply them after par_each returns.
+	// - Entities are visited in no particular order and fn must be safe to call concurrently.
+	template <typename... Cs>
+		requires (sizeof...(Cs) > 0) and (is_component<Cs> and ...) and type::Unique<std::remove_const_t<Cs>...>
+	auto par_each(std::invocable<entity::Handle, Cs&...> auto&& fn, const Parallel& parallel = {}) -> void {
+		par_split<Cs...>(
+				parallel,
+				[] (const size_t) {},
+				[&] (const size_t, const auto& view) {
+					for (auto&& entt : view)
+						std::apply(fn, entt);
+				}
+			);
+	}
+
+	// Same guarantees as par_each. Every chunk folds map(handle, Cs&...) with reduce on its own, then
+	// the chunk results are folded into init in chunk order, so reduce must be associative
+	// but need not be commutative.
+	//
+	// auto total_mass = ecs.par_reduce<Physics>(0.f, std::plus{}, [] (auto, const auto& ph) { return ph.mass; });
+	//
+	template <typename... Cs, typename T, typename Reduce, typename Map>
+		requires (sizeof...(Cs) > 0) and (is_component<Cs> and ...) and type::Unique<std::remove_const_t<Cs>...>
+			and std::invocable<Map, entity::Handle, Cs&...>
+			and std::convertible_to<std::invoke_result_t<Reduce, T, T>, T>
+	auto par_reduce(T init, Reduce&& reduce, Map&& map, const Parallel& parallel = {}) -> T {
+		auto partials = std::vector<std::optional<T>>{};
+
+		par_split<Cs...>(
+				parallel,
+				[&] (const size_t chunks) { partials.resize(chunks); },
+				[&] (const size_t chunk, const auto& view) {
+					auto& acc = partials[chunk];
+					for (auto&& entt : view) {
+						auto x = T{std::apply(map, entt)};
+						if (acc.has_value())
+							acc = std::invoke(reduce, std::move(*acc), std::move(x));
+						else
+							acc = std::move(x);
+					}
+				}
+			);
+
+		for (auto& partial : partials)
+			if (partial.has_value())
+				init = std::invoke(reduce, std::move(init), std::move(*partial));
+
+		return init;
+	}
+
+	// Runtime components.
+	//
+	// Types outside of Components, e.g. described by data files or defined by plugins, can be
+	// registered at runtime and are then handled through their component::Info and their Id:
+	//
+	// const auto health = ecs.register_component<Health>();	// Or any component::Info
+	// static_cast<Health*>(ecs.emplace_component(entt, health))->value = 100;
+	//
+	// They are stored in type erased sparse sets, so they do not show up in Signatures or views
+	// and cost a lookup per access. Components known at compile time should stay in Components.
+	// Registering is not thread safe.
+	//
+	// Registering a name again returns the Id it already has.
+	auto register_component(const component::Info& info) -> component::Id {
+		SAGE_ASSERT(
+				((info.name != Components::type_name()) and ...),
+				"{} is one of the Components of the ECS", info.name
+			);
+
+		const auto [it, is_new] = runtime_ids.try_emplace(std::string{info.name}, static_cast<component::Id>(runtime_components.size()));
+		if (is_new)
+			runtime_components.emplace_back(info, handles.size(), &tracking);
+
+		SAGE_ASSERT(
+				runtime_components[it->second].info().size == info.size and runtime_components[it->second].info().alignment == info.alignment,
+				"{} was registered with another layout", info.name
+			);
+
+		return it->second;
+	}
+
+	template <component::Concept C>
+		requires (not type::Any<C, Components...>)
+	auto register_component() -> component::Id {
+		return register_component(component::info_of<C>());
+	}
+
+	auto component_id(const std::string_view name) const -> std::optional<component::Id> {
+		const auto it = runtime_ids.find(std::string{name});
+		return it == runtime_ids.end() ? std::nullopt : std::make_optional(it->second);
+	}
+
+	auto component_info(const component::Id id) const -> component::Info {
+		return runtime(id).info();
+	}
+
+	auto number_of_runtime_components() const -> size_t {
+		return runtime_components.size();
+	}
+
+	// The component of the entity, default constructed if it did not have it. Null if the entity is not valid.
+	// Like set_components, counts as a change.
+	auto emplace_component(const Entity& e, const component::Id id) -> void* {
+		if (not is_valid(e))
+			return nullptr;
+
+		const auto idx = e._handle.index();
+		auto& column = runtime(id);
+		const auto is_added = not column.contains(idx);
+		auto* c = column.emplace(idx);
+
+		auto& ticks = column.ticks(idx);
+		if (is_added)
+			ticks.added = current_tick;
+		ticks.changed = current_tick;
+		return c;
+	}
+
+	// Null if the entity is not valid or does not have the component. Like components_of, counts as a change.
+	auto find_component(const Entity& e, const component::Id id) -> void* {
+		if (not is_valid(e))
+			return nullptr;
+
+		const auto idx = e._handle.index();
+		auto& column = runtime(id);
+		auto* c = column.find(idx);
+		if (c != nullptr)
+			column.ticks(idx).changed = current_tick;
+		return c;
+	}
+
+	auto find_component(const Entity& e, const component::Id id) const -> const void* {
+		return is_valid(e) ? runtime(id).find(e._handle.index()) : nullptr;
+	}
+
+	auto remove_component(const Entity& e, const component::Id id) -> bool {
+		return is_valid(e) and runtime(id).erase(e._handle.index());
+	}
+
+	// Call fn(handle, void*) for the entities that have the component, counts as a change of all of them.
+	// Same rules as iterating a view.
+	auto each_component(const component::Id id, std::invocable<entity::Handle, void*> auto&& fn) -> void {
+		auto& column = runtime(id);
+		for (const auto idx : column.entities()) {
+			column.ticks(idx).changed = current_tick;
+			std::invoke(fn, handles[idx], column.find(idx));
+		}
+	}
+
+	// Bit I is set if the entity has the Ith of Components
+	auto signature(const entity::Handle h) const -> std::optional<Signature> {
+		return is_valid(h) ? std::make_optional(signatures[h.index()]) : std::nullopt;
+	}
+
+	template <typename... Cs>
+		requires (type::Any<Cs, Components...> and ...)
+	static constexpr auto signature_of() -> Signature {
+		auto sig = Signature{};
+		(sig.set(type::index_of<Cs, Components...>()), ...);
+		return sig;
+	}
+
+	// A Handle is valid if it matches its slot: one load and one compare.
+	// Stale Handles of destroyed entities fail because the generation of the slot has moved on.
+	template <type::Any<Entity, entity::Handle> Entt>
+	auto is_valid(const Entt& e) const -> bool {
+		if constexpr (std::same_as<Entt, Entity>)
+			return e.ecs == this and is_valid(e._handle);
+		else if constexpr (std::same_as<Entt, entity::Handle>)
+			return e.index() < handles.size() and handles[e.index()] == e;
+		else
+			static_assert(false);
+	}
+
+	// Number of live entities, see capacity() for the allocated slots.
+	auto size() const -> size_t {
+		return _size;
+	}
+
+	auto capacity() const -> size_t {
+		return handles.size();
+	}
+
+	auto max_capacity() const -> size_t {
+		return _max_capacity;
+	}
+
+	// Bytes held by the entities and component storage of this world, reserved are those of its
+	// memory::Arena if it has one.
+	auto memory() const -> memory::Usage {
+		return tracking.usage();
+	}
+
+	// Full means that create() will fail: all slots are used and the capacity cannot grow anymore.
+	auto is_full() const -> bool {
+		SAGE_ASSERT(_size <= handles.size(), "size() cannot be > handles.size(), make sure entity creation/deletion is correct");
+		SAGE_ASSERT((free_head == entity::Handle::null_index) == (_size == handles.size()), "Free list and size disagree");
+
+		return free_head == entity::Handle::null_index and handles.size() == _max_capacity;
+	}
+
+	// Grow the capacity to at least `capacity` slots in one go, capped to max_capacity().
+	// Like growing on create(), references to components stay valid.
+	auto reserve(const size_t capacity) -> void {
+		if (capacity > handles.size() and handles.size() < _max_capacity)
+			grow_to(std::min(capacity, _max_capacity));
+	}
+
+	// Handles of the cleared entities become stale, same as with destroy().
+	auto clear() -> void {
+		if (observed[std::to_underlying(Event::Destroy)].any())
+			for (const auto idx : vw::iota(0ul, handles.size()))
+				if (const auto i = static_cast<entity::Handle::Index>(idx); is_alive(i))
+					record(Event::Destroy, i, signatures[i]);
+
+		components.apply([] (auto& column) {
+				column.clear();
+			});
+		archetypes.clear();
+		for (auto& column : runtime_components)
+			column.clear();
+		rg::fill(signatures, Signature{});
+		for (auto& g : groups)
+			g.size = 0;
+		named.clear();
+		rg::fill(indexed_names, Indexed_Name{});
+		release_all_slots();
+
+		// Pending commands would refer to stale entities
+		LOCK_GUARD(commands_mutex);
+		for (auto& [_, buffer] : command_buffers)
+			buffer->clear();
+	}
+
+private:
+	// Split view<Cs...>() in chunks, call on_count(number of chunks) and then visit(chunk, view of the chunk)
+	// for every chunk on the pool. Small views are a single chunk visited on the calling thread.
+	template <typename... Cs>
+	auto par_split(const Parallel& parallel, auto&& on_count, auto&& visit) -> void {
+		using Archetype_Chunk = Archetype_Storage::Chunk;
+
+		auto& pool = parallel.pool != nullptr ? *parallel.pool : job::Pool::shared();
+		const auto whole = view<Cs...>();
+		using Driver = decltype(whole.driver);
+
+		const auto serial = [&] {
+				on_count(1);
+				visit(0, whole);
+			};
+
+		if constexpr (std::same_as<Driver, typename Archetype_Storage::Rows>) {
+			auto chunks = std::vector<Archetype_Chunk*>{};
+			auto candidates = 0ul;
+			archetypes.each_chunk(Archetype_Storage::template signature_of<std::remove_const_t<Cs>...>(), [&] (Archetype_Chunk& chunk) {
+					chunks.push_back(&chunk);
+					candidates += chunk.size();
+				});
+
+			if (candidates < parallel.serial_threshold or pool.concurrency() == 1)
+				return serial();
+
+			on_count(chunks.size());
+			pool.for_each_chunk(chunks.size(), [&] (const size_t i) {
+					using Rows = Archetype_Storage::Chunk_Rows;
+					visit(i, View<Rows, Unfiltered, Cs...>{this, Archetype_Storage::rows(*chunks[i]), whole.signature});
+				});
+		}
+		else if constexpr (requires { typename Driver::Word; }) {
+			if (pool.concurrency() == 1 or whole.driver.count() < parallel.serial_threshold)
+				return serial();
+
+			// Ranges of words
+			const auto chunk_size = parallel.chunk_size > 0 ? parallel.chunk_size : 16ul * 1024;
+			const auto words_per_chunk = std::max(1ul, chunk_size / Driver::word_bits);
+			const auto words = whole.driver.last - whole.driver.first;
+			const auto chunks = (words + words_per_chunk - 1) / words_per_chunk;
+
+			on_count(chunks);
+			pool.for_each_chunk(chunks, [&] (const size_t i) {
+					visit(i, View<Driver, Unfiltered, Cs...>{this, whole.driver.subrange(i * words_per_chunk, (i + 1) * words_per_chunk), whole.signature});
+				});
+		}
+		else {
+			const auto candidates = static_cast<size_t>(rg::size(whole.driver));
+			if (candidates < parallel.serial_threshold or pool.concurrency() == 1)
+				return serial();
+
+			const auto chunk_size = parallel.chunk_size > 0
+				? parallel.chunk_size
+				: std::max(64ul, 16ul * 1024 / (sizeof(Cs) + ...));
+			const auto chunks = (candidates + chunk_size - 1) / chunk_size;
+
+			on_count(chunks);
+			pool.for_each_chunk(chunks, [&] (const size_t i) {
+					const auto first = i * chunk_size,
+							   last = std::min(candidates, first + chunk_size);
+					const auto& d = whole.driver;
+
+					if constexpr (std::same_as<Driver, std::span<const entity::Handle::Index>>)
+						visit(i, View<Driver, Unfiltered, Cs...>{this, d.subspan(first, last - first), whole.signature});
+					else
+						visit(i, View<Driver, Unfiltered, Cs...>{this, Driver{d[first], d[first] + static_cast<entity::Handle::Index>(last - first)}, whole.signature});
+				});
+		}
+	}
+
+	// See view()
+	template <typename... Cs, typename Filter>
+	auto make_view(const Filter filter) -> decltype(auto /* View<Driver, Filter, Cs...> */) {
+		using Index = entity::Handle::Index;
+
+		const auto signature = signature_of<std::remove_const_t<Cs>...>();
+
+		if constexpr ((component::storage::Is_Sparse<std::remove_const_t<Cs>> or ...)) {
+			auto driver = std::span<const Index>{};
+			auto smallest = std::numeric_limits<size_t>::max();
+			(
+				std::invoke([&] {
+					if constexpr (component::storage::Is_Sparse<std::remove_const_t<Cs>>)
+						if (const auto& col = column<Cs>(); col.size() < smallest) {
+							smallest = col.size();
+							driver = col.entities();
+						}
+				})
+				, ...
+			);
+
+			return View<std::span<const Index>, Filter, Cs...>{this, driver, signature, filter};
+		}
+		else if constexpr ((component::storage::Is_Archetype<std::remove_const_t<Cs>> or ...))
+			return View<typename Archetype_Storage::Rows, Filter, Cs...>{
+					this,
+					archetypes.rows(Archetype_Storage::template signature_of<std::remove_const_t<Cs>...>()),
+					signature,
+					filter
+				};
+		else if constexpr ((component::storage::Is_Tag<std::remove_const_t<Cs>> or ...)) {
+			using Bits = component::storage::Set_Bits<(component::storage::Is_Tag<std::remove_const_t<Cs>> + ...)>;
+
+			auto driver = Bits{ {}, 0, (handles.size() + Bits::word_bits - 1) / Bits::word_bits };
+			auto i = 0ul;
+			(
+				std::invoke([&] {
+					if constexpr (component::storage::Is_Tag<std::remove_const_t<Cs>>)
+						driver.sets[i++] = column<Cs>().words().data();
+				})
+				, ...
+			);
+
+			return View<Bits, Filter, Cs...>{this, driver, signature, filter};
+		}
+		else
+			return View<std::ranges::iota_view<Index, Index>, Filter, Cs...>{
+					this,
+					vw::iota(Index{0}, static_cast<Index>(handles.size())),
+					signature,
+					filter
+				};
+	}
+
+	auto runtime(const component::Id id) -> component::storage::Erased_Column& {
+		SAGE_ASSERT(id < runtime_components.size(), "Component {} is not registered", id);
+		return runtime_components[id];
+	}
+
+	auto runtime(const component::Id id) const -> const component::storage::Erased_Column& {
+		SAGE_ASSERT(id < runtime_components.size(), "Component {} is not registered", id);
+		return runtime_components[id];
+	}
+
+	// Stamp C of the entity with the current tick, Tags have no ticks
+	template <typename C>
+	auto touch(const entity::Handle::Index idx, const bool is_added) -> void {
+		if constexpr (not component::storage::Is_Tag<C>) {
+			auto& ticks = column<C>().ticks(idx);
+			if (is_added)
+				ticks.added = current_tick;
+			ticks.changed = current_tick;
+		}
+	}
+
+	// A reference to the Column of C or, for Archetype components, a Column like handle to the Archetypes.
+	// A const C gets the same column, constness is up to the caller.
+	template <typename C>
+	auto column() -> decltype(auto) {
+		using Bare = std::remove_const_t<C>;
+
+		if constexpr (component::storage::Is_Archetype<Bare>)
+			return archetypes.template column<Bare>();
+		else
+			return components.template get<component::storage::Column<Bare>>();
+	}
+
+	template <typename C>
+	auto column() const -> decltype(auto) {
+		using Bare = std::remove_const_t<C>;
+
+		if constexpr (component::storage::Is_Archetype<Bare>)
+			return archetypes.template column<Bare>();
+		else
+			return components.template get<component::storage::Column<Bare>>();
+	}
+
+	auto destroy_slot(const entity::Handle::Index idx) -> void {
+		record(Event::Destroy, idx, signatures[idx]);
+		leave_groups(idx, signatures[idx]);
+		unindex_name(idx);
+		release_slot(idx);
+		components.apply([&] (auto& column) {
+				column.erase(idx);
+			});
+		archetypes.erase(idx);
+		for (auto& column : runtime_components)
+			column.erase(idx);
+		signatures[idx].reset();
+
+		--_size;
+	}
+
+	// Remove the components of `sig`, moving archetypes once
+	auto remove_slot_components(const entity::Handle::Index idx, const Signature sig) -> void {
+		record(Event::Destroy, idx, sig & signatures[idx]);
+		leave_groups(idx, sig);
+		if constexpr (has_names)
+			if (sig.test(type::index_of<component::Name, Components...>()))
+				unindex_name(idx);
+		archetypes.shrink(idx, to_archetype_signature(sig));
+
+		[&] <size_t... I> (std::index_sequence<I...>) {
+			(
+				std::invoke([&] {
+					using C = type::At<I, Components...>;
+					if constexpr (not component::storage::Is_Archetype<C>)
+						if (sig.test(I))
+							column<C>().erase(idx);
+				})
+				, ...
+			);
+		}(std::index_sequence_for<Components...>{});
+
+		signatures[idx] &= ~sig;
+	}
+
+	// Call fn(handle) for the entities named `name` while it returns true. Entries of Names
+	// overwritten through references are skipped.
+	auto each_named(const std::string_view name, std::invocable<entity::Handle> auto&& fn) const -> void {
+		const auto id = name::Table::global().find(name);
+		if (not id.has_value())
+			return;
+
+		const auto found = named.find(*id);
+		if (found == named.end())
+			return;
+
+		for (const auto idx : found->second)
+			if (const auto* c = column<component::Name>().find(idx); c != nullptr and c->id == *id)
+				if (not std::invoke(fn, handles[idx]))
+					return;
+	}
+
+	// After the Name of the entity is set, replaces what the slot had in the index
+	auto index_name(const entity::Handle::Index idx) -> void {
+		if constexpr (has_names) {
+			unindex_name(idx);
+			if (const auto id = column<component::Name>().get(idx).id; not id.is_null()) {
+				auto& idxs = named[id];
+				indexed_names[idx] = { id, static_cast<uint32_t>(idxs.size()) };
+				idxs.push_back(idx);
+			}
+		}
+	}
+
+	// Before the Name of the entity is removed. Goes by the indexed name, the Name may have been
+	// overwritten through a reference since.
+	auto unindex_name(const entity::Handle::Index idx) -> void {
+		if constexpr (has_names) {
+			const auto [id, position] = std::exchange(indexed_names[idx], Indexed_Name{});
+			if (id.is_null())
+				return;
+
+			// Swap remove
+			const auto found = named.find(id);
+			auto& idxs = found->second;
+			if (position != idxs.size() - 1) {
+				idxs[position] = idxs.back();
+				indexed_names[idxs[position]].position = position;
+			}
+			idxs.pop_back();
+			if (idxs.empty())
+				named.erase(found);
+		}
+	}
+
+	auto connect(const size_t component, const Event event, Listener&& listener) -> Connection {
+		const auto e = std::to_underlying(event);
+		auto& listeners = observers[component].listeners[e];
+
+		listeners.push_back(std::move(listener));
+		observed[e].set(component);
+		return { .component = component, .event = event, .index = listeners.size() - 1 };
+	}
+
+	template <typename C>
+	auto record(const Event event, const entity::Handle::Index idx) -> void {
+		constexpr auto c = type::index_of<C, Components...>();
+		if (observed[std::to_underlying(event)].test(c)) {
+			observers[c].events.push_back(event);
+			observers[c].handles.push_back(handles[idx]);
+		}
+	}
+
+	// For every component of `sig`, the entity must still be alive
+	auto record(const Event event, const entity::Handle::Index idx, const Signature sig) -> void {
+		const auto hits = sig & observed[std::to_underlying(event)];
+		if (hits.none())
+			return;
+
+		for (const auto c : vw::iota(0ul, hits.size()))
+			if (hits.test(c)) {
+				observers[c].events.push_back(event);
+				observers[c].handles.push_back(handles[idx]);
+			}
+	}
+
+	// Call fn(column) for every column owned by the group
+	auto for_each_owned(const Owned_Group& g, auto&& fn) -> void {
+		[&] <size_t... I> (std::index_sequence<I...>) {
+			(
+				std::invoke([&] {
+					using C = type::At<I, Components...>;
+					if constexpr (component::storage::Is_Sparse<C>)
+						if (g.signature.test(I))
+							std::invoke(fn, column<C>());
+				})
+				, ...
+			);
+		}(std::index_sequence_for<Components...>{});
+	}
+
+	// The members of a group are exactly the entities whose Signature contains the one of the group
+	static auto is_member(const Owned_Group& g, const Signature sig) -> bool {
+		return (sig & g.signature) == g.signature;
+	}
+
+	auto enter_group(Owned_Group& g, const entity::Handle::Index idx) -> void {
+		const auto last = static_cast<entity::Handle::Index>(g.size++);
+		for_each_owned(g, [&] (auto& col) { col.swap(col.position(idx), last); });
+	}
+
+	auto exit_group(Owned_Group& g, const entity::Handle::Index idx) -> void {
+		const auto last = static_cast<entity::Handle::Index>(--g.size);
+		for_each_owned(g, [&] (auto& col) { col.swap(col.position(idx), last); });
+	}
+
+	// After components were added to the entity, `had` is its Signature before
+	auto join_groups(const entity::Handle::Index idx, const Signature had) -> void {
+		for (auto& g : groups)
+			if (is_member(g, signatures[idx]) and not is_member(g, had))
+				enter_group(g, idx);
+	}
+
+	// Before the components of `sig` are removed from the entity
+	auto leave_groups(const entity::Handle::Index idx, const Signature sig) -> void {
+		for (auto& g : groups)
+			if ((g.signature & sig).any() and is_member(g, signatures[idx]))
+				exit_group(g, idx);
+	}
+
+	// Walk the smallest owned column and pull the members to the front. Entering only swaps
+	// the element at the position being visited with one already visited.
+	auto fill_group(Owned_Group& g) -> void {
+		auto driver = std::span<const entity::Handle::Index>{};
+		auto smallest = std::numeric_limits<size_t>::max();
+		for_each_owned(g, [&] (const auto& col) {
+				if (col.size() < smallest) {
+					smallest = col.size();
+					driver = col.entities();
+				}
+			});
+
+		for (const auto pos : vw::iota(0ul, driver.size()))
+			if (const auto idx = driver[pos]; is_member(g, signatures[idx]))
+				enter_group(g, idx);
+	}
+
+	// After the columns were written directly, e.g. loading a snapshot
+	auto refill_groups() -> void {
+		for (auto& g : groups) {
+			g.size = 0;
+			fill_group(g);
+		}
+	}
+
+	static constexpr auto to_archetype_signature(const Signature sig) -> Archetype_Storage::Signature {
+		auto arch = typename Archetype_Storage::Signature{};
+		[&] <size_t... I> (std::index_sequence<I...>) {
+			(
+				std::invoke([&] {
+					using C = type::At<I, Components...>;
+					if constexpr (component::storage::Is_Archetype<C>)
+						if (sig.test(I))
+							arch |= Archetype_Storage::template signature_of<C>();
+				})
+				, ...
+			);
+		}(std::index_sequence_for<Components...>{});
+		return arch;
+	}
+
+	// Double the capacity, false if already at max_capacity
+	auto grow() -> bool {
+		if (handles.size() == _max_capacity)
+			return false;
+
+		grow_to(std::clamp(handles.size() * 2, 1ul, _max_capacity));
+		return true;
+	}
+
+	// Dense columns and archetype chunks allocate in pages/chunks and sparse columns only
+	// grow their index, so no component is moved.
+	auto grow_to(const size_t capacity) -> void {
+		const auto old_capacity = handles.size();
+		SAGE_ASSERT(capacity > old_capacity and capacity <= _max_capacity);
+
+		PROFILER_GROWTH(profiler, "ECS capacity", old_capacity, capacity);
+
+		handles.resize(capacity);
+		signatures.resize(capacity);
+		if constexpr (has_names)
+			indexed_names.resize(capacity);
+		components.apply([&] (auto& column) {
+				column.grow(capacity);
+			});
+		archetypes.grow(capacity);
+		for (auto& column : runtime_components)
+			column.grow(capacity);
+
+		// Push the new slots on the free list, in reverse so that they are handed out in ascending order
+		for (const auto idx : vw::iota(old_capacity, capacity) | vw::reverse) {
+			const auto i = static_cast<entity::Handle::Index>(idx);
+			handles[i] = entity::Handle{free_head, 0};
+			free_head = i;
+		}
+	}
+
+	auto is_alive(const entity::Handle::Index idx) const -> bool {
+		return handles[idx].index() == idx;
+	}
+
+	auto release_slot(const entity::Handle::Index idx) -> void {
+		SAGE_ASSERT(is_alive(idx));
+
+		handles[idx] = entity::Handle{free_head, handles[idx].generation() + 1};
+		free_head = idx;
+	}
+
+	// Link the slots in reverse so that create() hands them out in ascending order
+	auto release_all_slots() -> void {
+		free_head = entity::Handle::null_index;
+		for (const auto idx : vw::iota(0ul, handles.size()) | vw::reverse) {
+			const auto i = static_cast<entity::Handle::Index>(idx);	// Ok to cast, max_entities fits in Index
+			const auto generation = handles[i].generation() + (is_alive(i) ? 1 : 0);
+
+			handles[i] = entity::Handle{free_head, generation};
+			free_head = i;
+		}
+
+		_size = 0;
+	}
+};
+
+using ECS = Basic_ECS<_ALL_COMPONENTS>;		// Excessive? maybe, I care? no.
+
+} //sage
+
+template <>
+FMT_FORMATTER(sage::entity::Handle) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::entity::Handle) {
+		if (obj.is_null())
+			return fmt::format_to(ctx.out(), "entity::Handle: null;");
+		else
+			return fmt::format_to(ctx.out(), "entity::Handle: index={} generation={};", obj.index(), obj.generation());
+	}
+};
+
+template <>
+FMT_FORMATTER(sage::component::Name) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::component::Name) {
+		if (obj.is_default())
+			return fmt::format_to(ctx.out(), "\"Unamed Entity {}\"", obj.number);
+		else
+			return fmt::format_to(ctx.out(), "{:?}", obj.view());
+	}
+};
+template <>
+FMT_FORMATTER(sage::component::Sprite) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::component::Sprite) {
+		return fmt::format_to(ctx.out(), "{}", glm::to_string(obj.color));
+	}
+};
+template <>
+FMT_FORMATTER(sage::component::Transform) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::component::Transform) {
+		return fmt::format_to(ctx.out(), "{}", glm::to_string(obj.trans));
+	}
+};
+template <>
+FMT_FORMATTER(sage::component::Camera) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::component::Camera) {
+		return fmt::format_to(ctx.out(), "TODO");
+	}
+};
+template <>
+FMT_FORMATTER(sage::component::Position) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::component::Position) {
+		return fmt::format_to(ctx.out(), "{}", glm::to_string(obj.position));
+	}
+};
+template <>
+FMT_FORMATTER(sage::component::Parent) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::component::Parent) {
+		return fmt::format_to(ctx.out(), "{}", obj.handle);
+	}
+};
+
+// TODO: FMT_FORMATTER for ECS::Entity, dont forget to print the addresses of the ECS to debug their origin
+
+#ifdef SAGE_TEST_ECS
+namespace {
+
+using namespace sage;
+
+TEST_CASE ("Must not compile") {
+	//const entity::Handle ent = 666;
+
+	//const auto func = [] (const size_t e) {
 	//	return e + 1;
 	//};
 	//func(ent);
 }
 
-constexpr auto infinity = std::numeric_limits<float>::infinity();
+constexpr auto infinity = std::numeric_limits<float>::infinity();
+
+TEST_CASE ("ECS") {
+	struct Physics {
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	struct Collision {
+		glm::vec2 a, b;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Collision);
+	};
+
+	constexpr auto max_entities = 100ul;
+
+	using ECS = sage::Basic_ECS<Physics, Collision>;
+	auto ecs = ECS{max_entities};
+
+	auto entities = std::vector<ECS::Entity>{};
+	entities.reserve(max_entities);
+
+	// Create
+	{
+		constexpr auto half_max_entities = size_t{max_entities / 2};
+
+		for ([[maybe_unused]] const auto _ : vw::iota(0ul, half_max_entities)) {
+			auto entt = ecs.create();
+			REQUIRE(entt.has_value());
+
+			// This is an interesting line of cpp.
+			// `entt` is auto& so *entt is also auto& so we need to move it otherwise we copy.
+			// However the optional is still considered to `has_value()`, its just that the value
+			// has been moved from.
+			// https://en.cppreference.com/w/cpp/utility/optional/operator*
+			// Note the &,&& on the right side of the functions (operator*() & or operator*() const&)
+			// https://godbolt.org/z/rYaGhf9nP
+			entities.push_back(std::move(*entt));
+		}
+
+		// Set test data
+		for (const auto& [i, entt] : entities | vw::enumerate) {
+			REQUIRE(entt.is_valid());
+			auto comps = entt.set(Physics{{i, i}}, Collision{{i, i}, {i, i}});
+			CHECK(comps.has_value());
+			auto& ph = std::get<Physics&>(*comps);
+			CHECK_EQ(ph.velocity, glm::vec2{i, i});
+		}
+
+		CHECK_EQ(ecs.size(), half_max_entities);
+	}
+
+	const auto first_entity = entities.begin();
+	const auto first_entity_handle = first_entity->handle();
+
+	// View
+	auto view = ecs.view<Physics, Collision>();
+	REQUIRE(not view.empty());
+	rg::for_each(view, [&] (const auto& entt_comps) {
+			const auto& [_e, ph, col] = entt_comps;
+			REQUIRE(not _e.is_null());
+
+			const auto e = _e.index();
+			CHECK_EQ(e, ph.velocity.x);
+			CHECK_EQ(e, ph.velocity.y);
+			CHECK_EQ(e, col.a.x);
+			CHECK_EQ(e, col.a.y);
+			CHECK_EQ(e, col.b.x);
+			CHECK_EQ(e, col.b.y);
+
+			// Tweak values of one to confirm they are retained
+			if (_e == first_entity->handle()) {
+				ph.velocity.x =
+				ph.velocity.y =
+				col.a.x =
+				col.a.y =
+				col.b.x =
+				col.b.y = infinity
+				;
+			}
+		});
+
+	{
+		const auto bools = first_entity->has<Physics>();
+		REQUIRE(bools.has_value());
+		CHECK_EQ(std::tuple_size_v<std::decay_t<decltype(*bools)>>, 1);
+		CHECK(std::get<0>(*bools));
+	}
+
+	{
+		const auto bools = first_entity->has<Physics, Collision>();
+		REQUIRE(bools.has_value());
+		CHECK_EQ(std::tuple_size_v<std::decay_t<decltype(*bools)>>, 2);
+		std::apply([] (const auto&... b) { (CHECK(b), ...); }, *bools);
+	}
+
+	// Check if changes remain
+	const auto components = first_entity->components<Physics, Collision>();
+	REQUIRE(components.has_value());
+	std::apply(
+			[&] <typename... Cs> (const Cs&... comps) {
+				CHECK_GT(sizeof...(comps), 0);
+				(
+					std::invoke([&] {
+						REQUIRE(comps != nullptr);
+						if constexpr (std::same_as<Physics*, Cs>) {
+							CHECK_EQ(comps->velocity, glm::vec2{infinity, infinity});
+						}
+						else if constexpr (std::same_as<Collision*, Cs>) {
+							CHECK_EQ(comps->a, comps->b);
+							CHECK_EQ(comps->a, glm::vec2{infinity, infinity});
+						}
+						else
+							static_assert(false);
+					})
+					, ...
+				);
+			},
+			*components
+		);
+
+	// Destroy
+	const auto size_before_destroy = ecs.size();
+	CHECK(ecs.destroy(*first_entity));
+	CHECK(first_entity->handle() != first_entity_handle);
+	CHECK_FALSE(ecs.is_valid(first_entity_handle));
+	CHECK_EQ(ecs.size(), size_before_destroy - 1);
+
+	// Clear
+	ecs.clear();
+	CHECK_EQ(ecs.size(), 0);
+	CHECK_FALSE(entities.back().is_valid());
+	CHECK(ecs.view<Physics, Collision>().empty());
+}
+
+TEST_CASE ("ECS signatures and const views") {
+	struct Physics {
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	struct Collision {
+		glm::vec2 a, b;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Collision);
+	};
+
+	constexpr auto max_entities = 100ul;
+
+	using ECS = sage::Basic_ECS<Physics, Collision>;
+	auto ecs = ECS{max_entities};
+
+	auto entities = std::vector<ECS::Entity>{};
+	for (const auto i : vw::iota(0ul, max_entities)) {
+		auto entt = ecs.create();
+		entt->set(Physics{{i, i}});
+		if (i % 2 == 0)
+			entt->set(Collision{});
+		entities.push_back(std::move(*entt));
+	}
+
+	// Signatures follow set/remove/destroy
+	{
+		auto& entt = entities.front();
+		CHECK_EQ(ecs.signature(entt.handle()), ECS::signature_of<Physics, Collision>());
+
+		entt.remove<Collision>();
+		CHECK_EQ(ecs.signature(entt.handle()), ECS::signature_of<Physics>());
+
+		const auto handle = entt.handle();
+		ecs.destroy(entt);
+		CHECK_FALSE(ecs.signature(handle).has_value());
+	}
+
+	// Const views, only the entities with all the components and plain references
+	{
+		const auto both = ecs.view<Physics, Collision>();
+		static_assert(std::ranges::forward_range<decltype(both)>);
+		static_assert(std::same_as<std::ranges::range_reference_t<decltype(both)>, std::tuple<entity::Handle, Physics&, Collision&>>);
+
+		CHECK_EQ(rg::distance(both), max_entities / 2 - 1);
+		CHECK_EQ(rg::distance(ecs.view<Physics>()), max_entities - 1);
+
+		for (auto&& [handle, ph, col] : both) {
+			CHECK_EQ(handle.index() % 2, 0);
+			ph.velocity = {-1, -1};
+		}
+
+		CHECK(rg::all_of(both, [] (const auto& entt) { return std::get<1>(entt).velocity.x == -1; }));
+	}
+}
+
+TEST_CASE ("ECS sparse components") {
+	struct Physics {
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	struct Rare {
+		using Storage = component::storage::Sparse;
+
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Rare);
+	};
+
+	static_assert(component::storage::Is_Dense<Physics>);
+	static_assert(component::storage::Is_Sparse<Rare>);
+
+	constexpr auto max_entities = 1000ul,
+				   every = 100ul;
+
+	using ECS = sage::Basic_ECS<Physics, Rare>;
+	auto ecs = ECS{max_entities};
+
+	auto entities = std::vector<ECS::Entity>{};
+	entities.reserve(max_entities);
+
+	for (const auto i : vw::iota(0ul, max_entities)) {
+		auto entt = ecs.create();
+		REQUIRE(entt.has_value());
+		entt->set(Physics{{i, i}});
+		if (i % every == 0)
+			entt->set(Rare{static_cast<int>(i)});
+		entities.push_back(std::move(*entt));
+	}
+
+	CHECK_EQ(ecs.count<Physics>(), max_entities);
+	CHECK_EQ(ecs.count<Rare>(), max_entities / every);
+	CHECK_EQ(rg::distance(ecs.view<Physics>()), max_entities);
+	CHECK_EQ(rg::distance(ecs.view<Rare>()), max_entities / every);
+
+	// Driven by Rare, Physics is probed
+	for (auto&& [handle, rare, ph] : ecs.view<Rare, Physics>()) {
+		CHECK_EQ(handle.index() % every, 0);
+		CHECK_EQ(rare.value, handle.index());
+		CHECK_EQ(ph.velocity.x, rare.value);
+	}
+
+	// Remove/destroy in the middle of the packed array, the rest must keep their components
+	{
+		auto& second = entities[every];
+		CHECK(second.remove<Rare>());
+		CHECK_FALSE(std::get<0>(*second.has<Rare>()));
+		CHECK(std::get<0>(*second.has<Physics>()));
+
+		CHECK(ecs.destroy(entities[2 * every]));
+		CHECK_EQ(ecs.count<Rare>(), max_entities / every - 2);
+		CHECK_EQ(ecs.count<Physics>(), max_entities - 1);
+
+		for (auto&& [handle, rare] : ecs.view<Rare>())
+			CHECK_EQ(rare.value, handle.index());
+
+		const auto last = std::get<Rare*>(*entities.back().components<Rare>());
+		CHECK_EQ(last, nullptr);
+
+		const auto survivor = std::get<Rare*>(*entities[3 * every].components<Rare>());
+		REQUIRE(survivor != nullptr);
+		CHECK_EQ(survivor->value, 3 * every);
+	}
+
+	ecs.clear();
+	CHECK_EQ(ecs.count<Rare>(), 0);
+	CHECK_EQ(ecs.count<Physics>(), 0);
+	CHECK(ecs.view<Rare>().empty());
+	CHECK(ecs.view<Physics>().empty());
+}
+
+TEST_CASE ("ECS tag components") {
+	struct Physics {
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	struct Selected {
+		using Storage = component::storage::Tag;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Selected);
+	};
+
+	struct Static {
+		using Storage = component::storage::Tag;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Static);
+	};
+
+	static_assert(component::storage::Is_Tag<Selected>);
+	static_assert(std::same_as<component::storage::Column<Selected>, component::storage::Tag_Column<Selected>>);
+
+	constexpr auto max_entities = 1000ul;
+
+	using ECS = sage::Basic_ECS<Physics, Selected, Static>;
+	auto ecs = ECS{max_entities};
+
+	auto entities = std::vector<ECS::Entity>{};
+	for (const auto i : vw::iota(0ul, max_entities)) {
+		auto entt = *ecs.create();
+		entt.set(Physics{{i, i}});
+		if (i % 3 == 0)
+			entt.set(Selected{});
+		if (i % 5 == 0)
+			entt.set(Static{});
+		entities.push_back(std::move(entt));
+	}
+
+	const auto indices = [] (auto&& view) {
+			auto is = std::vector<size_t>{};
+			for (auto&& entt : view)
+				is.push_back(std::get<0>(entt).index());
+			return is;
+		};
+
+	CHECK_EQ(ecs.count<Selected>(), 334);
+	CHECK_EQ(ecs.count<Static>(), 200);
+	CHECK_EQ(rg::distance(ecs.view<Selected>()), 334);
+	CHECK_EQ(rg::distance(ecs.view<const Selected, const Static>()), 67);
+	CHECK(rg::all_of(indices(ecs.view<Selected, Static>()), [] (const auto i) { return i % 15 == 0; }));
+
+	// Mixed with a Dense component, a Sparse or Archetype one would drive the view instead
+	auto visited = 0ul;
+	for (auto&& [handle, ph, _] : ecs.view<const Physics, const Selected>()) {
+		CHECK_EQ(ph.velocity.x, handle.index());
+		++visited;
+	}
+	CHECK_EQ(visited, 334);
+
+	// Removed and destroyed
+	CHECK(entities[3].remove<Selected>());
+	CHECK(ecs.destroy(entities[6]));
+	CHECK_FALSE(std::get<0>(*entities[3].has<Selected>()));
+	CHECK(std::get<0>(*entities[9].has<Selected>()));
+	CHECK_EQ(ecs.count<Selected>(), 332);
+	CHECK_EQ(rg::distance(ecs.view<Selected>()), 332);
+
+	// The slot of a destroyed entity starts without tags
+	auto recycled = *ecs.create();
+	CHECK_EQ(recycled.handle().index(), 6);
+	CHECK_FALSE(std::get<0>(*recycled.has<Selected>()));
+	CHECK(rg::none_of(indices(ecs.view<Selected>()), [] (const auto i) { return i == 6; }));
+
+	// Sweep
+	CHECK_EQ(ecs.remove_all<Selected>(), 332);
+	CHECK_EQ(ecs.count<Selected>(), 0);
+	CHECK(ecs.view<Selected>().empty());
+	CHECK_FALSE(std::get<0>(*entities[9].has<Selected>()));
+	CHECK_EQ(ecs.count<Static>(), 200);
+
+	// In parallel, over ranges of words
+	for (auto&& [_, ph, __] : ecs.view<Physics, const Static>())
+		ph.velocity = {0, 0};
+
+	auto pool = job::Pool{3};
+	ecs.par_each<Physics, const Static>([] (entity::Handle, Physics& ph, const Static&) {
+			ph.velocity.x += 1;
+		}, { .serial_threshold = 0, .chunk_size = 64, .pool = &pool });
+
+	const auto moved = ecs.par_reduce<const Physics, const Static>(0.f, std::plus{}, [] (entity::Handle, const Physics& ph, const Static&) {
+			return ph.velocity.x;
+		}, { .serial_threshold = 0, .chunk_size = 64, .pool = &pool });
+	CHECK_EQ(moved, 200.f);
+
+	// Grows with the ECS
+	auto grown = ECS{1, 2 * max_entities};
+	for ([[maybe_unused]] const auto _ : vw::iota(0ul, 2 * max_entities))
+		grown.create()->set(Selected{});
+	CHECK_EQ(grown.count<Selected>(), 2 * max_entities);
+	CHECK_EQ(rg::distance(grown.view<Selected>()), 2 * max_entities);
+}
+
+TEST_CASE ("ECS archetype components") {
+	struct Position {
+		using Storage = component::storage::Archetype;
+
+		glm::vec3 position;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Position);
+	};
+
+	struct Physics {
+		using Storage = component::storage::Archetype;
+
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	struct Label {
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Label);
+	};
+
+	constexpr auto max_entities = 1000ul;
+
+	using ECS = sage::Basic_ECS<Position, Physics, Label>;
+	static_assert(ECS::Archetype_Storage::chunk_rows < max_entities, "Test must span several chunks");
+
+	auto ecs = ECS{max_entities};
+
+	auto entities = std::vector<ECS::Entity>{};
+	entities.reserve(max_entities);
+
+	for (const auto i : vw::iota(0ul, max_entities)) {
+		auto entt = ecs.create();
+		REQUIRE(entt.has_value());
+
+		const auto f = static_cast<float>(i);
+		if (i % 2 == 0) {
+			// Both in one move and the references must be usable
+			auto comps = entt->set(Position{{f, f, f}}, Physics{{f, f}});
+			REQUIRE(comps.has_value());
+			auto& [pos, ph] = *comps;
+			CHECK_EQ(pos.position.x, f);
+			CHECK_EQ(ph.velocity.x, f);
+		}
+		else
+			entt->set(Position{{f, f, f}});
+
+		if (i % 3 == 0)
+			entt->set(Label{static_cast<int>(i)});
+
+		entities.push_back(std::move(*entt));
+	}
+
+	const auto all_match = [&] {
+		return rg::all_of(ecs.view<Position>(), [] (auto&& handle_pos) {
+				auto&& [handle, pos] = handle_pos;
+				return pos.position.x == handle.index();
+			});
+	};
+
+	CHECK_EQ(ecs.count<Position>(), max_entities);
+	CHECK_EQ(ecs.count<Physics>(), max_entities / 2);
+	CHECK_EQ(rg::distance(ecs.view<Position>()), max_entities);
+	CHECK_EQ(rg::distance(ecs.view<Position, Physics>()), max_entities / 2);
+	CHECK(all_match());
+
+	for (auto&& [handle, pos, ph] : ecs.view<Position, Physics>()) {
+		CHECK_EQ(handle.index() % 2, 0);
+		CHECK_EQ(pos.position.x, ph.velocity.x);
+	}
+
+	// Mixed with a Dense component
+	for (auto&& [handle, ph, label] : ecs.view<Physics, Label>()) {
+		CHECK_EQ(handle.index() % 6, 0);
+		CHECK_EQ(label.value, handle.index());
+		CHECK_EQ(ph.velocity.x, label.value);
+	}
+	CHECK_EQ(rg::distance(ecs.view<Physics, Label>()), (max_entities + 5) / 6);
+
+	// Moving entities between archetypes keeps the components of everyone
+	{
+		for (const auto i : vw::iota(0ul, max_entities / 4))
+			CHECK(entities[4 * i].remove<Physics>());
+
+		CHECK_EQ(ecs.count<Physics>(), max_entities / 4);
+		CHECK_EQ(ecs.count<Position>(), max_entities);
+		CHECK(all_match());
+
+		for (auto&& [handle, pos, ph] : ecs.view<Position, Physics>())
+			CHECK_EQ(handle.index() % 4, 2);
+
+		auto& first = entities.front();
+		CHECK_FALSE(std::get<0>(*first.has<Physics>()));
+		CHECK_EQ(std::get<Physics*>(*first.components<Physics>()), nullptr);
+
+		auto& ph = std::get<Physics&>(*first.set(Physics{{-1, -1}}));
+		CHECK_EQ(ph.velocity.x, -1);
+		CHECK_EQ(std::get<Physics*>(*first.components<Physics>())->velocity.x, -1);
+		CHECK(all_match());
+	}
+
+	// Destroy in the middle of the chunks
+	{
+		for (const auto i : vw::iota(0ul, max_entities / 10))
+			CHECK(ecs.destroy(entities[10 * i + 1]));
+
+		CHECK_EQ(ecs.count<Position>(), max_entities - max_entities / 10);
+		CHECK(all_match());
+	}
+
+	ecs.clear();
+	CHECK_EQ(ecs.count<Position>(), 0);
+	CHECK_EQ(ecs.count<Physics>(), 0);
+	CHECK(ecs.view<Position>().empty());
+	CHECK(ecs.view<Physics, Label>().empty());
+}
+
+// Same components, only the storage policy differs
+template <typename Policy>
+struct Bench_Position {
+	using Storage = Policy;
+
+	glm::vec3 position;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Bench_Position);
+};
+
+template <typename Policy>
+struct Bench_Physics {
+	using Storage = Policy;
+
+	glm::vec2 velocity;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Bench_Physics);
+};
+
+template <typename Policy>
+struct Bench_Sprite {
+	using Storage = Policy;
+
+	glm::vec4 color;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Bench_Sprite);
+};
+
+TEST_CASE ("ECS archetype vs dense storage benchmark") {
+#ifdef SAGE_BENCH
+	constexpr auto max_entities = 100'000ul,
+				   iterations = 20ul;
+#else
+	constexpr auto max_entities = 1'000ul,
+				   iterations = 2ul;
+#endif
+
+	// Everyone has a Position and a Sprite, a third of them also move.
+	// Returns the time to integrate the movers `iterations` times and the sum of the positions.
+	const auto bench = [&] <typename Policy> () {
+		using Position = Bench_Position<Policy>;
+		using Physics = Bench_Physics<Policy>;
+		using Sprite = Bench_Sprite<Policy>;
+
+		auto ecs = Basic_ECS<Position, Physics, Sprite>{max_entities};
+
+		for (const auto i : vw::iota(0ul, max_entities)) {
+			auto entt = ecs.create();
+			if (i % 3 == 0)
+				entt->set(Position{}, Physics{{1, 2}}, Sprite{});
+			else
+				entt->set(Position{}, Sprite{});
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		for ([[maybe_unused]] const auto _ : vw::iota(0ul, iterations))
+			for (auto&& [handle, pos, ph] : ecs.template view<Position, Physics>()) {
+				pos.position.x += ph.velocity.x;
+				pos.position.y += ph.velocity.y;
+			}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		auto sum = 0.f;
+		for (auto&& [handle, pos] : ecs.template view<Position>())
+			sum += pos.position.x + pos.position.y;
+
+		return std::make_pair(elapsed, sum);
+	};
+
+	const auto [dense, dense_sum] = bench.template operator()<component::storage::Dense>();
+	const auto [archetype, archetype_sum] = bench.template operator()<component::storage::Archetype>();
+
+	CHECK_EQ(dense_sum, archetype_sum);
+
+	MESSAGE(fmt::format("view<Position, Physics> x{} over {} entities, Dense: {}", iterations, max_entities, std::chrono::duration_cast<std::chrono::microseconds>(dense)));
+	MESSAGE(fmt::format("view<Position, Physics> x{} over {} entities, Archetype: {}", iterations, max_entities, std::chrono::duration_cast<std::chrono::microseconds>(archetype)));
+}
+
+template <typename Policy>
+struct Bench_Marker {
+	using Storage = Policy;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Bench_Marker);
+};
+
+TEST_CASE ("ECS tag vs dense marker benchmark") {
+#ifdef SAGE_BENCH
+	constexpr auto max_entities = 500'000ul,
+				   iterations = 20ul;
+#else
+	constexpr auto max_entities = 5'000ul,
+				   iterations = 2ul;
+#endif
+
+	// Mark every 50th entity, count the marked ones and sweep the marks, `iterations` times
+	const auto bench = [&] <typename Policy> () {
+		using Marker = Bench_Marker<Policy>;
+
+		auto ecs = Basic_ECS<Bench_Position<component::storage::Dense>, Marker>{max_entities};
+		auto entities = std::vector<typename decltype(ecs)::Entity>{};
+		for ([[maybe_unused]] const auto _ : vw::iota(0ul, max_entities))
+			entities.push_back(*ecs.create());
+
+		auto marked = 0ul;
+		const auto start = std::chrono::steady_clock::now();
+		for ([[maybe_unused]] const auto _ : vw::iota(0ul, iterations)) {
+			for (auto i = 0ul; i < entities.size(); i += 50)
+				entities[i].set(Marker{});
+
+			marked += static_cast<size_t>(rg::distance(ecs.template view<const Marker>()));
+
+			if constexpr (component::storage::Is_Tag<Marker>)
+				ecs.template remove_all<Marker>();
+			else
+				for (auto& entt : entities)
+					entt.template remove<Marker>();
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		return std::make_pair(elapsed, marked);
+	};
+
+	const auto [dense, dense_marked] = bench.template operator()<component::storage::Dense>();
+	const auto [tag, tag_marked] = bench.template operator()<component::storage::Tag>();
+
+	CHECK_EQ(dense_marked, iterations * max_entities / 50);
+	CHECK_EQ(tag_marked, dense_marked);
+
+	MESSAGE(fmt::format("Mark, count and sweep x{} over {} entities, Dense: {}", iterations, max_entities, std::chrono::duration_cast<std::chrono::microseconds>(dense)));
+	MESSAGE(fmt::format("Mark, count and sweep x{} over {} entities, Tag: {}", iterations, max_entities, std::chrono::duration_cast<std::chrono::microseconds>(tag)));
+}
+
+TEST_CASE ("ECS owning groups") {
+	using Position = Bench_Position<component::storage::Sparse>;
+	using Physics = Bench_Physics<component::storage::Sparse>;
+	using Sprite = Bench_Sprite<component::storage::Dense>;
+
+	using ECS = Basic_ECS<Position, Physics, Sprite>;
+	auto ecs = ECS{64};
+
+	// Members are exactly the entities with both components, with no duplicates
+	const auto check_members = [&] (const auto& group) {
+		auto members = std::vector<entity::Handle::Index>{group.entities().begin(), group.entities().end()};
+		auto expected = std::vector<entity::Handle::Index>{};
+		for (auto&& [handle, _, __] : ecs.view<const Position, const Physics>())
+			expected.push_back(handle.index());
+
+		rg::sort(members);
+		rg::sort(expected);
+		CHECK_EQ(members, expected);
+		CHECK_EQ(group.size(), expected.size());
+	};
+
+	auto entities = std::vector<ECS::Entity>{};
+	for (const auto i : vw::iota(0ul, 20ul)) {
+		auto entt = *ecs.create();
+		if (i % 2 == 0)
+			entt.set(Position{{static_cast<float>(i), 0, 0}});
+		if (i % 3 == 0)
+			entt.set(Physics{{1, 2}});
+		entities.push_back(std::move(entt));
+	}
+
+	// Filled with the entities that already have the components
+	const auto group = ecs.group<Position, const Physics>();
+	CHECK_EQ(group.size(), 4);	// 0, 6, 12, 18
+	check_members(group);
+	CHECK_EQ(ecs.group<Position, const Physics>().index, group.index);
+
+	// Joining and leaving
+	entities[3].set(Position{{3, 0, 0}});
+	entities[4].set(Physics{{1, 2}});
+	CHECK_EQ(group.size(), 6);
+	check_members(group);
+
+	CHECK(entities[0].remove<Physics>());
+	CHECK(ecs.destroy(entities[6]));
+	CHECK(entities[12].remove<Position>());
+	CHECK(entities[1].remove<Position>());	// Not a member to begin with
+	CHECK_EQ(group.size(), 3);	// 3, 4, 18
+	check_members(group);
+
+	// Setting an owned component again does not join twice
+	entities[18].set(Position{{18, 0, 0}}, Physics{{1, 2}});
+	CHECK_EQ(group.size(), 3);
+
+	const auto since = ecs.advance_tick();
+	group.each([] (entity::Handle, Position& pos, const Physics& ph) {
+			pos.position.x += ph.velocity.x;
+		});
+	CHECK_EQ(std::get<0>(*entities[3].components<const Position>())->position.x, 4.f);
+	CHECK_EQ(std::get<0>(*entities[18].components<const Position>())->position.x, 19.f);
+	CHECK_EQ(std::get<0>(*entities[2].components<const Position>())->position.x, 2.f);
+	CHECK_EQ(rg::distance(ecs.changed<const Position>(since)), 3);
+	CHECK_EQ(rg::distance(ecs.changed<const Physics>(since)), 0);
+
+	// Commands and prefabs
+	{
+		auto& commands = ecs.commands();
+		commands.set(entities[8].handle(), Physics{{1, 2}});
+		commands.remove<Position>(entities[4].handle());
+		ecs.play_commands();
+		CHECK_EQ(group.size(), 3);	// 3, 8, 18
+		check_members(group);
+
+		CHECK_EQ(ecs.create_n(Prefab{Position{}, Physics{}, Sprite{}}, 10).size(), 10);
+		CHECK_EQ(ecs.create_n(Prefab{Position{}}, 10).size(), 10);
+		CHECK_EQ(group.size(), 13);
+		check_members(group);
+	}
+
+	ecs.clear();
+	CHECK_EQ(group.size(), 0);
+}
+
+TEST_CASE ("ECS observers") {
+	struct Rare {
+		using Storage = component::storage::Sparse;
+
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Rare);
+	};
+
+	struct Marker {
+		using Storage = component::storage::Tag;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Marker);
+	};
+
+	using Position = Bench_Position<component::storage::Archetype>;
+	using Sprite = Bench_Sprite<component::storage::Dense>;
+
+	using ECS = Basic_ECS<Position, Sprite, Rare, Marker>;
+	using Event = ECS::Event;
+	using Handles = ECS::Handles;
+	auto ecs = ECS{16};
+
+	// Every delivery of Rare in order, a batch at a time
+	using Log = std::vector<std::pair<Event, Handles>>;
+	auto log = Log{};
+	const auto listen = [&] (const Event event) {
+			return [&log, event] (const std::span<const entity::Handle> batch) {
+				log.emplace_back(event, Handles{batch.begin(), batch.end()});
+			};
+		};
+	const auto take_log = [&] {
+			ecs.notify_observers();
+			return std::exchange(log, {});
+		};
+
+	auto a = *ecs.create();
+	auto b = *ecs.create();
+	const auto ha = a.handle(),
+			   hb = b.handle();
+
+	// Nothing is recorded without listeners
+	a.set(Rare{1});
+	CHECK(take_log().empty());
+
+	ecs.on_construct<Rare>(listen(Event::Construct));
+	const auto on_update = ecs.on_update<Rare>(listen(Event::Update));
+	ecs.on_destroy<Rare>(listen(Event::Destroy));
+
+	// Delivered at the sync point only, consecutive events of a kind together
+	b.set(Rare{2}, Position{});
+	a.set(Rare{3});
+	b.set(Rare{4});
+	CHECK(a.remove<Rare>());
+	CHECK(a.remove<Rare>());	// Did not have it, no event
+	CHECK(log.empty());
+	CHECK_EQ(take_log(), Log{
+			{ Event::Construct, { hb } },
+			{ Event::Update, { ha, hb } },
+			{ Event::Destroy, { ha } },
+		});
+
+	// Other components do not show up
+	a.set(Position{}, Sprite{}, Marker{});
+	CHECK(take_log().empty());
+
+	// Remove and set again within a frame keeps the order
+	CHECK(b.remove<Rare>());
+	b.set(Rare{5});
+	CHECK(ecs.destroy(b));
+	CHECK_EQ(take_log(), Log{
+			{ Event::Destroy, { hb } },
+			{ Event::Construct, { hb } },
+			{ Event::Destroy, { hb } },
+		});
+
+	// Commands and prefabs
+	{
+		auto& commands = ecs.commands();
+		const auto c = commands.create();
+		commands.set(c, Rare{6});
+		commands.set(a.handle(), Rare{7});
+		ecs.play_commands();
+
+		auto after = take_log();
+		REQUIRE_EQ(after.size(), 1);
+		CHECK_EQ(after[0].first, Event::Construct);
+		CHECK_EQ(after[0].second.size(), 2);
+
+		commands.set(a.handle(), Rare{8});
+		commands.destroy(a.handle());
+		ecs.play_commands();
+		CHECK_EQ(take_log(), Log{ { Event::Destroy, { ha } } });
+
+		const auto created = ecs.create_n(Prefab{Rare{9}, Position{}}, 3);
+		CHECK_EQ(take_log(), Log{ { Event::Construct, created } });
+	}
+
+	// Disconnected listeners are not called, the others still are
+	ecs.disconnect(on_update);
+	{
+		auto entt = ECS::Entity{ecs.create_n(Prefab{Rare{10}}, 1).front(), &ecs};
+		entt.set(Rare{11});
+		CHECK_EQ(take_log(), Log{ { Event::Construct, { entt.handle() } } });
+	}
+
+	// Clear destroys all, listeners changing the ECS are notified next time
+	{
+		const auto alive = ecs.count<Rare>();
+		auto replaced = false;
+		ecs.on_destroy<Rare>([&] (const std::span<const entity::Handle>) {
+				if (not std::exchange(replaced, true))
+					ecs.create()->set(Rare{12});
+			});
+
+		ecs.clear();
+		const auto cleared = take_log();
+		REQUIRE_EQ(cleared.size(), 1);
+		CHECK_EQ(cleared[0].second.size(), alive);
+		CHECK(replaced);
+		CHECK_EQ(ecs.count<Rare>(), 1);
+		CHECK_EQ(take_log().size(), 1);
+	}
+}
+
+TEST_CASE ("ECS named entities") {
+	using Position = Bench_Position<component::storage::Archetype>;
+	using Name = component::Name;
+
+	using ECS = Basic_ECS<Name, Position>;
+
+	// Default names are numbered, not formatted nor interned
+	const auto interned = name::Table::global().size();
+	auto ecs = ECS{1000};
+	for ([[maybe_unused]] const auto _ : vw::iota(0, 100))
+		CHECK(ecs.create().has_value());
+	ecs.clear();
+	CHECK_EQ(name::Table::global().size(), interned);
+
+	static_assert(sizeof(Name) == 8 and std::is_trivially_copyable_v<Name>);
+	const auto a = Name{}, b = Name{};
+	CHECK(a.is_default());
+	CHECK_NE(a, b);
+	CHECK_EQ(a.str(), fmt::format("Unamed Entity {}", a.number));
+	CHECK_EQ(fmt::format("{}", a), fmt::format("\"Unamed Entity {}\"", a.number));
+	CHECK(a.view().empty());
+	CHECK_EQ(Name{"Player"}, Name{std::string{"Player"}});
+	CHECK_EQ(Name{"Player"}.str(), "Player");
+	CHECK_EQ(fmt::format("{}", Name{"Player"}), "\"Player\"");
+
+	auto player = *ecs.create();
+	auto tiles = std::vector<ECS::Entity>{};
+	for ([[maybe_unused]] const auto _ : vw::iota(0, 3))
+		tiles.push_back(*ecs.create());
+
+	CHECK_FALSE(ecs.find_named("Player").has_value());
+
+	player.set(Name{"Player"}, Position{});
+	for (auto& tile : tiles)
+		tile.set(Name{"Tile"});
+	CHECK_EQ(ecs.find_named("Player"), player.handle());
+	CHECK_EQ(ecs.find_all_named("Tile").size(), 3);
+	CHECK_FALSE(ecs.find_named("Nobody").has_value());
+
+	// Renaming, removing and destroying
+	player.set(Name{"Hero"});
+	CHECK_FALSE(ecs.find_named("Player").has_value());
+	CHECK_EQ(ecs.find_named("Hero"), player.handle());
+
+	CHECK(tiles[0].remove<Name>());
+	CHECK(ecs.destroy(tiles[1]));
+	CHECK_EQ(ecs.find_all_named("Tile"), ECS::Handles{ tiles[2].handle() });
+
+	// Writes through references are not indexed but do not show up as stale entries either
+	*std::get<0>(*tiles[2].components<Name>()) = Name{"Rock"};
+	CHECK(ecs.find_all_named("Tile").empty());
+	CHECK_FALSE(ecs.find_named("Rock").has_value());
+
+	// The slot leaves the bucket it was indexed in, not the one of its current Name
+	const auto slot = tiles[2].handle().index();
+	CHECK(ecs.destroy(tiles[2]));
+	auto reused = *ecs.create();
+	CHECK_EQ(reused.handle().index(), slot);
+	reused.set(Name{"Tile"});
+	CHECK_EQ(ecs.find_all_named("Tile"), ECS::Handles{ reused.handle() });
+	CHECK(ecs.destroy(reused));
+
+	// Commands and prefabs
+	{
+		auto& commands = ecs.commands();
+		const auto c = commands.create();
+		commands.set(c, Name{"Spawned"});
+		commands.set(player.handle(), Name{"Player"});
+		ecs.play_commands();
+
+		CHECK(ecs.find_named("Spawned").has_value());
+		CHECK_EQ(ecs.find_named("Player"), player.handle());
+		CHECK_FALSE(ecs.find_named("Hero").has_value());
+
+		auto created = ecs.create_n(Prefab{Name{"Tile"}, Position{}}, 10);
+		auto found = ecs.find_all_named("Tile");
+		rg::sort(created);
+		rg::sort(found);
+		CHECK_EQ(found, created);
+	}
+
+	ecs.clear();
+	CHECK_FALSE(ecs.find_named("Player").has_value());
+	CHECK(ecs.find_all_named("Tile").empty());
+}
+
+TEST_CASE ("ECS owning group benchmark") {
+	using Position = Bench_Position<component::storage::Sparse>;
+	using Physics = Bench_Physics<component::storage::Sparse>;
+
+#ifdef SAGE_BENCH
+	constexpr auto max_entities = 500'000ul,
+				   iterations = 20ul;
+#else
+	constexpr auto max_entities = 5'000ul,
+				   iterations = 2ul;
+#endif
+
+	const auto bench = [&] (const bool grouped) {
+		auto ecs = Basic_ECS<Position, Physics>{max_entities};
+		if (grouped)
+			ecs.group<Position, const Physics>();
+
+		for (const auto i : vw::iota(0ul, max_entities)) {
+			auto entt = ecs.create();
+			entt->set(Position{});
+			if (i % 3 == 0)
+				entt->set(Physics{{1, 2}});
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		for ([[maybe_unused]] const auto _ : vw::iota(0ul, iterations)) {
+			if (grouped)
+				ecs.group<Position, const Physics>().each([] (entity::Handle, Position& pos, const Physics& ph) {
+						pos.position.x += ph.velocity.x;
+						pos.position.y += ph.velocity.y;
+					});
+			else
+				for (auto&& [handle, pos, ph] : ecs.view<Position, const Physics>()) {
+					pos.position.x += ph.velocity.x;
+					pos.position.y += ph.velocity.y;
+				}
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		auto sum = 0.f;
+		for (auto&& [handle, pos] : ecs.view<const Position>())
+			sum += pos.position.x + pos.position.y;
+
+		return std::make_pair(elapsed, sum);
+	};
+
+	const auto [view, view_sum] = bench(false);
+	const auto [group, group_sum] = bench(true);
+
+	CHECK_EQ(view_sum, group_sum);
+
+	MESSAGE(fmt::format("Position += Physics x{} over {} entities, view: {}", iterations, max_entities, std::chrono::duration_cast<std::chrono::microseconds>(view)));
+	MESSAGE(fmt::format("Position += Physics x{} over {} entities, owning group: {}", iterations, max_entities, std::chrono::duration_cast<std::chrono::microseconds>(group)));
+}
+
+TEST_CASE ("ECS parallel iteration") {
+	using Position = Bench_Position<component::storage::Archetype>;
+	using Physics = Bench_Physics<component::storage::Archetype>;
+	using Sprite = Bench_Sprite<component::storage::Dense>;
+
+#ifdef SAGE_BENCH
+	constexpr auto max_entities = 1'000'000ul;
+#else
+	constexpr auto max_entities = 10'000ul;
+#endif
+
+	using ECS = Basic_ECS<Position, Physics, Sprite>;
+	auto ecs = ECS{max_entities};
+
+	for (const auto i : vw::iota(0ul, max_entities)) {
+		auto entt = ecs.create();
+		if (i % 4 != 0)
+			entt->set(Position{}, Physics{{1, 1}});
+		if (i % 2 == 0)
+			entt->set(Sprite{{1, 1, 1, 1}});
+	}
+
+	auto pool = job::Pool{3};
+	const auto serial = Parallel{ .serial_threshold = std::numeric_limits<size_t>::max() };
+	const auto parallel = Parallel{ .serial_threshold = 0, .pool = &pool };
+
+	const auto integrate = [] (entity::Handle, Position& pos, const Physics& ph) {
+			pos.position.x += ph.velocity.x;
+			pos.position.y += ph.velocity.y * 2;
+		};
+	const auto sum_x = [] (entity::Handle, const Position& pos) { return static_cast<double>(pos.position.x); };
+
+	// Every entity is visited exactly once
+	{
+		const auto start = std::chrono::steady_clock::now();
+		ecs.par_each<Position, Physics>(integrate, serial);
+		const auto serial_time = std::chrono::steady_clock::now() - start;
+
+		const auto par_start = std::chrono::steady_clock::now();
+		ecs.par_each<Position, Physics>(integrate, parallel);
+		const auto parallel_time = std::chrono::steady_clock::now() - par_start;
+
+		MESSAGE(fmt::format("par_each over {} entities, serial: {} parallel with {} threads: {}",
+					ecs.count<Physics>(),
+					std::chrono::duration_cast<std::chrono::microseconds>(serial_time),
+					pool.concurrency(),
+					std::chrono::duration_cast<std::chrono::microseconds>(parallel_time)
+				));
+
+		CHECK(rg::all_of(ecs.view<Position>(), [] (const auto& entt) {
+				const auto& pos = std::get<Position&>(entt);
+				return pos.position.x == 2 and pos.position.y == 4;
+			}));
+	}
+
+	// Reduce, same result either way
+	{
+		const auto expected = 2. * ecs.count<Position>();
+		CHECK_EQ(ecs.par_reduce<Position>(0., std::plus{}, sum_x, serial), expected);
+		CHECK_EQ(ecs.par_reduce<Position>(0., std::plus{}, sum_x, parallel), expected);
+		CHECK_EQ(ecs.par_reduce<Position>(1., std::plus{}, sum_x, parallel), expected + 1);
+	}
+
+	// Not driven by archetypes, slots are split in chunks of chunk_size
+	{
+		auto visited = std::atomic<size_t>{0};
+		ecs.par_each<Sprite>(
+				[&] (entity::Handle h, Sprite& sprite) {
+					sprite.color.r = static_cast<float>(h.index());
+					++visited;
+				},
+				Parallel{ .serial_threshold = 0, .chunk_size = 1000, .pool = &pool }
+			);
+		CHECK_EQ(visited.load(), ecs.count<Sprite>());
+		CHECK(rg::all_of(ecs.view<Sprite>(), [] (const auto& entt) {
+				return std::get<Sprite&>(entt).color.r == std::get<entity::Handle>(entt).index();
+			}));
+
+		const auto mixed = ecs.par_reduce<Sprite, Position>(
+				size_t{0},
+				std::plus{},
+				[] (entity::Handle, const Sprite&, const Position&) { return size_t{1}; },
+				parallel
+			);
+		CHECK_EQ(mixed, max_entities / 4);
+	}
+
+	// Below the threshold
+	ecs.clear();
+	auto visited = 0ul;
+	ecs.par_each<Position>([&] (entity::Handle, Position&) { ++visited; }, Parallel{ .pool = &pool });
+	CHECK_EQ(visited, 0);
+}
+
+TEST_CASE ("ECS prefabs") {
+	struct Physics {
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	struct Rare {
+		using Storage = component::storage::Sparse;
+
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Rare);
+	};
+
+	struct Position {
+		using Storage = component::storage::Archetype;
+
+		glm::vec3 position;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Position);
+	};
+
+	struct Sprite {
+		using Storage = component::storage::Archetype;
+
+		glm::vec4 color;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Sprite);
+	};
+
+	struct Static {
+		using Storage = component::storage::Tag;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Static);
+	};
+
+	constexpr auto max_capacity = 2000ul;
+
+	using ECS = sage::Basic_ECS<Physics, Rare, Position, Sprite, Static>;
+	auto ecs = ECS{16, max_capacity};
+
+	// Already in the archetype the prefab goes to
+	auto before = *ecs.create();
+	before.set(Position{{-1, -1, -1}}, Sprite{{1, 1, 1, 1}});
+
+	const auto since = ecs.advance_tick();
+	const auto tile = Prefab{Physics{{1, 2}}, Position{{0, 0, 0}}, Sprite{{0, 0, 1, 1}}, Static{}};
+	const auto tiles = ecs.create_n(tile, 1000, [] (const size_t i, entity::Handle, Physics&, Position& pos, Sprite&, Static&) {
+			pos.position.x = static_cast<float>(i);
+		});
+
+	REQUIRE_EQ(tiles.size(), 1000);
+	CHECK_EQ(ecs.size(), 1001);
+	CHECK(rg::all_of(tiles, [&] (const auto h) { return ecs.is_valid(h); }));
+
+	// A fresh ECS hands out a contiguous range
+	for (const auto [i, h] : tiles | vw::enumerate)
+		CHECK_EQ(h.index(), i + 1);
+
+	CHECK_EQ(ecs.count<Physics>(), 1000);
+	CHECK_EQ(ecs.count<Position>(), 1001);
+	CHECK_EQ(ecs.count<Static>(), 1000);
+	CHECK_EQ(ecs.count<Rare>(), 0);
+	CHECK_EQ(rg::distance(ecs.added<const Position>(since)), 1000);
+	CHECK_EQ(rg::distance(ecs.added<const Physics>(since)), 1000);
+
+	auto sum = 0.f;
+	for (auto&& [handle, ph, pos, sprite, _] : ecs.view<const Physics, const Position, const Sprite, const Static>()) {
+		CHECK_EQ(ph.velocity, glm::vec2{1, 2});
+		CHECK_EQ(sprite.color, glm::vec4{0, 0, 1, 1});
+		sum += pos.position.x;
+	}
+	CHECK_EQ(sum, 999.f * 1000.f / 2.f);
+	CHECK_EQ(std::get<Position*>(*before.components<Position>())->position, glm::vec3{-1, -1, -1});
+
+	// Entities of a prefab are like any other
+	{
+		auto entt = ECS::Entity{tiles[10], &ecs};
+		CHECK(entt.remove<Position>());
+		CHECK(entt.set(Rare{10}).has_value());
+		CHECK(ecs.destroy(entt));
+		CHECK_EQ(ecs.count<Position>(), 1000);
+		CHECK_EQ(std::get<Position*>(*ECS::Entity{tiles[11], &ecs}.components<Position>())->position.x, 11.f);
+	}
+
+	// Reuses the free slots, then grows until max_capacity
+	const auto more = ecs.create_n(Prefab{Rare{7}}, 1500);
+	CHECK_EQ(more.size(), max_capacity - 1000);
+	CHECK_EQ(more.front().index(), tiles[10].index());
+	CHECK_NE(more.front(), tiles[10]);
+	CHECK(ecs.is_full());
+	CHECK_EQ(ecs.count<Rare>(), max_capacity - 1000);
+	CHECK(rg::all_of(ecs.view<const Rare>(), [] (const auto& entt) { return std::get<const Rare&>(entt).value == 7; }));
+	CHECK(ecs.create_n(Prefab{Rare{7}}, 1).empty());
+
+	// Holes and a contiguous range after them
+	auto holes = ECS{8};
+	const auto first = holes.create_n(Prefab{Physics{{1, 1}}}, 8);
+	for (const auto i : { 2, 5 }) {
+		auto entt = ECS::Entity{first[i], &holes};
+		CHECK(holes.destroy(entt));
+	}
+
+	const auto since_holes = holes.advance_tick();
+	const auto filled = holes.create_n(Prefab{Physics{{3, 4}}, Static{}}, 10);
+	CHECK_EQ(filled.size(), 10);
+	CHECK_EQ(holes.count<Physics>(), 16);
+	CHECK_EQ(holes.count<Static>(), 10);
+	CHECK_EQ(rg::distance(holes.added<const Physics>(since_holes)), 10);
+	CHECK(rg::all_of(holes.view<const Physics, const Static>(), [] (const auto& entt) {
+			return std::get<const Physics&>(entt).velocity == glm::vec2{3, 4};
+		}));
+}
+
+TEST_CASE ("ECS prefab benchmark") {
+	using Position = Bench_Position<component::storage::Archetype>;
+	using Sprite = Bench_Sprite<component::storage::Archetype>;
+	using Physics = Bench_Physics<component::storage::Dense>;
+
+#ifdef SAGE_BENCH
+	constexpr auto max_entities = 100'000ul;
+#else
+	constexpr auto max_entities = 1'000ul;
+#endif
+
+	using ECS = Basic_ECS<Position, Sprite, Physics>;
+
+	auto one_by_one = ECS{max_entities};
+	auto start = std::chrono::steady_clock::now();
+	for ([[maybe_unused]] const auto _ : vw::iota(0ul, max_entities))
+		one_by_one.create()->set(Position{}, Sprite{{0, 0, 1, 1}}, Physics{});
+	const auto sequential = std::chrono::steady_clock::now() - start;
+
+	auto bulk = ECS{max_entities};
+	start = std::chrono::steady_clock::now();
+	const auto handles = bulk.create_n(Prefab{Position{}, Sprite{{0, 0, 1, 1}}, Physics{}}, max_entities);
+	const auto prefab = std::chrono::steady_clock::now() - start;
+
+	CHECK_EQ(handles.size(), max_entities);
+	CHECK_EQ(bulk.count<Sprite>(), one_by_one.count<Sprite>());
+
+	MESSAGE(fmt::format("Create {} entities, one by one: {} create_n: {}",
+			max_entities,
+			std::chrono::duration_cast<std::chrono::microseconds>(sequential),
+			std::chrono::duration_cast<std::chrono::microseconds>(prefab)
+		));
+}
+
+TEST_CASE ("ECS growth") {
+	struct Physics {
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	struct Rare {
+		using Storage = component::storage::Sparse;
 
-TEST_CASE ("ECS") {
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Rare);
+	};
+
+	struct Position {
+		using Storage = component::storage::Archetype;
+
+		glm::vec3 position;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Position);
+	};
+
+	constexpr auto max_capacity = 10'000ul;
+
+	using ECS = sage::Basic_ECS<Physics, Rare, Position>;
+	auto profiler = Profiler{};
+	auto ecs = ECS{1, max_capacity, profiler};
+	CHECK_EQ(ecs.capacity(), 1);
+
+	auto entities = std::vector<ECS::Entity>{};
+	auto first = ecs.create();
+	REQUIRE(first.has_value());
+
+	// References taken before growing must survive it
+	auto [ph, rare, pos] = *first->set(Physics{{-1, -1}}, Rare{-1}, Position{{-1, -1, -1}});
+	const auto before = std::make_tuple(&ph, &rare, &pos);
+
+	for (const auto i : vw::iota(1ul, max_capacity)) {
+		auto entt = ecs.create();
+		REQUIRE(entt.has_value());
+		CHECK_EQ(entt->handle().index(), i);
+
+		const auto f = static_cast<float>(i);
+		entt->set(Physics{{f, f}}, Position{{f, f, f}});
+		if (i % 10 == 0)
+			entt->set(Rare{static_cast<int>(i)});
+
+		entities.push_back(std::move(*entt));
+	}
+
+	CHECK_EQ(ecs.capacity(), max_capacity);
+	CHECK(ecs.is_full());
+	CHECK_FALSE(ecs.create().has_value());
+
+	// Nothing moved
+	CHECK_EQ(std::get<0>(before), std::get<Physics*>(*first->components<Physics>()));
+	CHECK_EQ(std::get<1>(before), std::get<Rare*>(*first->components<Rare>()));
+	CHECK_EQ(std::get<2>(before), std::get<Position*>(*first->components<Position>()));
+	CHECK_EQ(ph.velocity.x, -1);
+	CHECK_EQ(rare.value, -1);
+	CHECK_EQ(pos.position.x, -1);
+
+	CHECK_EQ(ecs.count<Rare>(), max_capacity / 10);
+	for (auto&& [handle, ph, pos] : ecs.view<Physics, Position>())
+		CHECK_EQ(ph.velocity.x, pos.position.x);
+
+	// 1 -> 2 -> 4 ... -> 8192 -> 10000
+	if constexpr (build::debug) {
+		const auto results = profiler.consume_results();
+		const auto& growth = results.get<Profiler::Growth_Results>();
+		REQUIRE_EQ(growth.size(), 14);
+		CHECK_EQ(growth.front().from, 1);
+		CHECK_EQ(growth.front().to, 2);
+		CHECK_EQ(growth.back().to, max_capacity);
+	}
+
+	// Reserve grows in one go, within the cap
+	auto reserved = ECS{0, max_capacity, profiler};
+	reserved.reserve(5000);
+	CHECK_EQ(reserved.capacity(), 5000);
+	reserved.reserve(max_capacity * 2);
+	CHECK_EQ(reserved.capacity(), max_capacity);
+}
+
+TEST_CASE ("ECS commands") {
 	struct Physics {
 		glm::vec2 velocity;
 
 		SAGE_ECS_TYPE_NAME_GETTER(Physics);
 	};
 
-	struct Collision {
-		glm::vec2 a, b;
+	struct Rare {
+		using Storage = component::storage::Sparse;
 
-		SAGE_ECS_TYPE_NAME_GETTER(Collision);
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Rare);
 	};
 
-	constexpr auto max_entities = 100ul;
+	struct Position {
+		using Storage = component::storage::Archetype;
 
-	using ECS = sage::Basic_ECS<Physics, Collision>;
+		glm::vec3 position;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Position);
+	};
+
+	using ECS = sage::Basic_ECS<Physics, Rare, Position>;
+	auto ecs = ECS{16};
+
+	auto entities = std::vector<ECS::Entity>{};
+	for ([[maybe_unused]] const auto _ : vw::iota(0, 4)) {
+		auto entt = ecs.create();
+		entt->set(Physics{{1, 1}}, Position{});
+		entities.push_back(std::move(*entt));
+	}
+
+	auto& cmds = ecs.commands();
+	CHECK_EQ(&cmds, &ecs.commands());
+	CHECK(cmds.empty());
+
+	// Recording while iterating does not change anything yet
+	for (auto&& [handle, ph] : ecs.view<Physics>()) {
+		if (handle.index() == 0)
+			cmds.destroy(handle);
+		else
+			cmds.set(handle, Physics{{2, 2}});
+	}
+
+	const auto spawned = cmds.create();
+	cmds.set(spawned, Rare{1}, Position{{1, 1, 1}});
+	cmds.set(spawned, Rare{2});	// Last one wins
+
+	const auto stillborn = cmds.create();
+	cmds.set(stillborn, Physics{});
+	cmds.destroy(stillborn);
+
+	cmds.set(entities[1], Rare{3});
+	cmds.remove<Rare>(entities[1]);		// Cancels the set
+	cmds.remove<Position>(entities[2]);
+	cmds.set(entities[3], Rare{4});
+
+	CHECK_FALSE(cmds.empty());
+	CHECK_EQ(ecs.size(), 4);
+	CHECK_EQ(ecs.count<Rare>(), 0);
+
+	ecs.play_commands();
+	CHECK(cmds.empty());
+
+	CHECK_FALSE(entities[0].is_valid());
+	CHECK_EQ(ecs.size(), 4);	// -1 destroyed +1 spawned, the stillborn never made it
+	CHECK_EQ(ecs.count<Physics>(), 3);
+	CHECK(rg::all_of(ecs.view<Physics>(), [] (const auto& entt) { return std::get<Physics&>(entt).velocity.x == 2; }));
+
+	CHECK_FALSE(std::get<0>(*entities[1].has<Rare>()));
+	CHECK_FALSE(std::get<0>(*entities[2].has<Position>()));
+	CHECK_EQ(std::get<Rare*>(*entities[3].components<Rare>())->value, 4);
+
+	CHECK_EQ(ecs.count<Rare>(), 2);
+	const auto rares = ecs.view<Rare, Position>();
+	CHECK_EQ(rg::distance(rares), 2);
+	const auto it = rg::find_if(rares, [] (const auto& entt) { return std::get<Rare&>(entt).value == 2; });
+	REQUIRE(it != rares.end());
+	const auto& [handle, rare, pos] = *it;
+	CHECK_EQ(rare.value, 2);
+	CHECK_EQ(pos.position.x, 1);
+	CHECK_FALSE(ecs.signature(handle)->test(type::index_of<Physics, Physics, Rare, Position>()));
+
+	// Commands on entities that died in the meantime are dropped
+	cmds.set(entities[1], Rare{5});
+	ecs.destroy(entities[1]);
+	ecs.play_commands();
+	CHECK_EQ(ecs.count<Rare>(), 2);
+}
+
+TEST_CASE ("ECS commands from workers") {
+	using Position = Bench_Position<component::storage::Archetype>;
+	using Physics = Bench_Physics<component::storage::Dense>;
+
+	constexpr auto max_entities = 10'000ul;
+
+	using ECS = Basic_ECS<Position, Physics>;
 	auto ecs = ECS{max_entities};
 
+	for (const auto i : vw::iota(0ul, max_entities))
+		ecs.create()->set(Position{{i, 0, 0}});
+
+	auto pool = job::Pool{3};
+
+	// Each worker records in its own buffer
+	ecs.par_each<Position>(
+			[&] (const entity::Handle handle, const Position& pos) {
+				auto& cmds = ecs.commands();
+				if (static_cast<size_t>(pos.position.x) % 2 == 0)
+					cmds.destroy(handle);
+				else {
+					cmds.set(handle, Physics{{1, 1}});
+					cmds.set(cmds.create(), Position{{-1, 0, 0}});
+				}
+			},
+			Parallel{ .serial_threshold = 0, .pool = &pool }
+		);
+
+	CHECK_EQ(ecs.size(), max_entities);
+	ecs.play_commands();
+
+	CHECK_EQ(ecs.size(), max_entities);
+	CHECK_EQ(ecs.count<Physics>(), max_entities / 2);
+	CHECK_EQ(rg::count_if(ecs.view<Position>(), [] (const auto& entt) { return std::get<Position&>(entt).position.x == -1; }), max_entities / 2);
+
+	// Pending entities only mean something to their buffer, playback asserts they are not mixed
+	auto& mine = ecs.commands();
+	auto other = ECS::Commands{};
+	CHECK_NE(mine.create().buffer, other.create().buffer);
+	mine.clear();
+}
+
+TEST_CASE ("ECS change tracking") {
+	struct Physics {
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	struct Rare {
+		using Storage = component::storage::Sparse;
+
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Rare);
+	};
+
+	struct Position {
+		using Storage = component::storage::Archetype;
+
+		glm::vec3 position;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Position);
+	};
+
+	struct Sprite {
+		using Storage = component::storage::Archetype;
+
+		glm::vec4 color;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Sprite);
+	};
+
+	using ECS = sage::Basic_ECS<Physics, Rare, Position, Sprite>;
+	auto ecs = ECS{16};
+
+	const auto handles_of = [] (auto&& view) {
+		auto hs = std::vector<entity::Handle>{};
+		for (auto&& entt : view)
+			hs.push_back(std::get<0>(entt));
+		rg::sort(hs);
+		return hs;
+	};
+
 	auto entities = std::vector<ECS::Entity>{};
-	entities.reserve(max_entities);
+	for ([[maybe_unused]] const auto _ : vw::iota(0, 3)) {
+		auto entt = ecs.create();
+		entt->set(Physics{}, Rare{}, Position{});
+		entities.push_back(std::move(*entt));
+	}
+	auto& a = entities[0];
+	auto& b = entities[1];
+	auto& c = entities[2];
 
-	// Create
+	CHECK_EQ(handles_of(ecs.added<Physics>(ecs.tick())).size(), 3);
+	CHECK_EQ(handles_of(ecs.changed<Rare>(0)).size(), 3);
+	CHECK_EQ(handles_of(ecs.added<const Position>(0)).size(), 3);
+
+	auto since = ecs.advance_tick();
+	CHECK(handles_of(ecs.changed<Physics>(since)).empty());
+	CHECK(handles_of(ecs.changed<Rare>(since)).empty());
+	CHECK(handles_of(ecs.changed<Position>(since)).empty());
+
+	// Mutable access is a change, const is not
 	{
-		constexpr auto half_max_entities = size_t{max_entities / 2};
+		CHECK(ecs.components_of<const Physics, const Rare, const Position>(a).has_value());
+		for ([[maybe_unused]] auto&& _ : ecs.view<const Physics, const Rare, const Position>())
+			;
+		CHECK(handles_of(ecs.changed<Physics>(since)).empty());
+		CHECK(handles_of(ecs.changed<Rare>(since)).empty());
+		CHECK(handles_of(ecs.changed<Position>(since)).empty());
 
-		for ([[maybe_unused]] const auto _ : vw::iota(0ul, half_max_entities)) {
-			auto entt = ecs.create();
-			REQUIRE(entt.has_value());
+		CHECK(ecs.components_of<Physics, Rare, Position>(a).has_value());
+		CHECK_EQ(handles_of(ecs.changed<Physics>(since)), std::vector{a.handle()});
+		CHECK_EQ(handles_of(ecs.changed<Rare>(since)), std::vector{a.handle()});
+		CHECK_EQ(handles_of(ecs.changed<Position>(since)), std::vector{a.handle()});
 
-			// This is an interesting line of cpp.
-			// `entt` is auto& so *entt is also auto& so we need to move it otherwise we copy.
-			// However the optional is still considered to `has_value()`, its just that the value
-			// has been moved from.
-			// https://en.cppreference.com/w/cpp/utility/optional/operator*
-			// Note the &,&& on the right side of the functions (operator*() & or operator*() const&)
-			// https://godbolt.org/z/rYaGhf9nP
+		// Only the mutable ones
+		for ([[maybe_unused]] auto&& _ : ecs.view<Position, const Rare>())
+			;
+		CHECK_EQ(handles_of(ecs.changed<Position>(since)).size(), 3);
+		CHECK_EQ(handles_of(ecs.changed<Rare>(since)).size(), 1);
+
+		// Visiting the changes read only does not change anything more
+		for ([[maybe_unused]] auto&& _ : ecs.changed<const Rare, const Physics>(since))
+			;
+		CHECK_EQ(handles_of(ecs.changed<Physics>(since)).size(), 1);
+
+		ecs.par_each<Physics>([] (auto, Physics&) {}, { .serial_threshold = 0 });
+		CHECK_EQ(handles_of(ecs.changed<Physics>(since)).size(), 3);
+
+		CHECK(handles_of(ecs.added<Physics>(since)).empty());
+	}
+
+	// Setting again is a change, not an addition
+	{
+		since = ecs.advance_tick();
+
+		b.set(Physics{}, Rare{}, Position{});
+		CHECK_EQ(handles_of(ecs.changed<Physics>(since)), std::vector{b.handle()});
+		CHECK_EQ(handles_of(ecs.changed<Rare>(since)), std::vector{b.handle()});
+		CHECK_EQ(handles_of(ecs.changed<Position>(since)), std::vector{b.handle()});
+		CHECK(handles_of(ecs.added<Physics>(since)).empty());
+		CHECK(handles_of(ecs.added<Position>(since)).empty());
+
+		c.set(Sprite{});
+		CHECK_EQ(handles_of(ecs.added<Sprite>(since)), std::vector{c.handle()});
+		CHECK_EQ(handles_of(ecs.added<Sprite, const Position>(since)), std::vector{c.handle()});
+
+		// Adding again after a removal is an addition
+		b.remove<Rare, Position>();
+		b.set(Rare{}, Position{});
+		CHECK_EQ(handles_of(ecs.added<Rare>(since)), std::vector{b.handle()});
+		CHECK_EQ(handles_of(ecs.added<Position>(since)), std::vector{b.handle()});
+	}
+
+	// Commands
+	{
+		since = ecs.advance_tick();
+
+		auto& cmds = ecs.commands();
+		cmds.set(a.handle(), Physics{});
+		cmds.set(cmds.create(), Physics{}, Sprite{});
+		ecs.play_commands();
+
+		CHECK_EQ(handles_of(ecs.changed<Physics>(since)).size(), 2);
+		CHECK_EQ(handles_of(ecs.added<Physics>(since)).size(), 1);
+		CHECK_EQ(handles_of(ecs.added<Sprite>(since)).size(), 1);
+	}
+
+	// Ticks follow the components when they move
+	{
+		since = ecs.advance_tick();
+
+		CHECK(ecs.components_of<Rare, Position>(a).has_value());
+
+		// a moves to the archetype of c, then b and c are swapped into the rows of the destroyed
+		a.set(Sprite{});
+		CHECK(ecs.destroy(b));
+		CHECK(ecs.destroy(c));
+		CHECK_EQ(handles_of(ecs.changed<Position>(since)), std::vector{a.handle()});
+		CHECK_EQ(handles_of(ecs.changed<Rare>(since)), std::vector{a.handle()});
+		CHECK_EQ(handles_of(ecs.changed<const Position, const Sprite>(since)), std::vector{a.handle()});
+		CHECK_EQ(handles_of(ecs.changed<Sprite>(since)), std::vector{a.handle()});	// Not the entity of the commands
+
+		since = ecs.advance_tick();
+		CHECK(handles_of(ecs.changed<Position>(since)).empty());
+		CHECK(handles_of(ecs.changed<Rare>(since)).empty());
+	}
+}
+
+// Counts its instances to check that the ECS constructs and destroys them in pairs
+struct Label {
+	inline static auto alive = 0;
+
+	std::string text = "label";
+
+	Label() { ++alive; }
+	Label(const Label& l) : text{l.text} { ++alive; }
+	Label(Label&& l) : text{std::move(l.text)} { ++alive; }
+	~Label() { --alive; }
+	auto operator= (const Label&) -> Label& = default;
+	auto operator= (Label&&) -> Label& = default;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Label);
+};
+
+TEST_CASE ("ECS runtime components") {
+	struct Physics {
+		glm::vec2 velocity;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	using ECS = sage::Basic_ECS<Physics>;
+
+	{
+		auto ecs = ECS{4};
+
+		const auto label = ecs.register_component<Label>();
+		CHECK_EQ(ecs.register_component<Label>(), label);
+		CHECK_EQ(ecs.component_id("Label"), label);
+		CHECK_EQ(ecs.component_info(label).size, sizeof(Label));
+		CHECK_FALSE(ecs.component_id("Physics").has_value());
+
+		// Described at runtime only, e.g. by a data file
+		const auto name = std::string{"Velocity"};
+		const auto velocity = ecs.register_component({
+				.name = name,
+				.size = 3 * sizeof(float),
+				.alignment = alignof(float),
+				.construct = [] (void* at) { std::memset(at, 0, 3 * sizeof(float)); },
+				.relocate = [] (void* to, void* from) { std::memcpy(to, from, 3 * sizeof(float)); },
+				.destroy = [] (void*) {},
+			});
+		CHECK_NE(velocity, label);
+		CHECK_EQ(ecs.component_info(velocity).name, "Velocity");
+		CHECK_EQ(ecs.number_of_runtime_components(), 2);
+
+		auto entities = std::vector<ECS::Entity>{};
+		for (const auto i : vw::iota(0, 10)) {	// Grows past the initial capacity
+			auto entt = ecs.create();
+			entt->set(Physics{});
+			static_cast<Label*>(ecs.emplace_component(*entt, label))->text = fmt::format("{}", i);
+			if (i % 2 == 0)
+				static_cast<float*>(ecs.emplace_component(*entt, velocity))[2] = static_cast<float>(i);
 			entities.push_back(std::move(*entt));
 		}
+		CHECK_EQ(Label::alive, 10);
 
-		// Set test data
-		for (const auto& [i, entt] : entities | vw::enumerate) {
-			REQUIRE(entt.is_valid());
-			auto comps = entt.set(Physics{{i, i}}, Collision{{i, i}, {i, i}});
-			CHECK(comps.has_value());
-			auto& ph = std::get<std::optional<Physics>&>(*comps);
-			REQUIRE(ph.has_value());
-			CHECK_EQ(ph->velocity, glm::vec2{i, i});
-		}
+		// Emplacing again keeps the component
+		CHECK_EQ(static_cast<Label*>(ecs.emplace_component(entities[3], label))->text, "3");
+		CHECK_EQ(Label::alive, 10);
+
+		const auto& const_ecs = ecs;
+		CHECK_EQ(static_cast<const float*>(const_ecs.find_component(entities[4], velocity))[2], 4.f);
+		CHECK_EQ(ecs.find_component(entities[5], velocity), nullptr);
+
+		// The last label is moved into the hole
+		CHECK(ecs.remove_component(entities[0], label));
+		CHECK_FALSE(ecs.remove_component(entities[0], label));
+		CHECK_EQ(ecs.find_component(entities[0], label), nullptr);
+		CHECK_EQ(static_cast<Label*>(ecs.find_component(entities[9], label))->text, "9");
+		CHECK_EQ(Label::alive, 9);
 
-		CHECK_EQ(ecs.size(), max_entities);
+		CHECK(ecs.destroy(entities[1]));
+		CHECK_EQ(Label::alive, 8);
+		CHECK_EQ(ecs.find_component(entities[1], label), nullptr);
+
+		auto visited = std::vector<std::string>{};
+		ecs.each_component(label, [&] (const entity::Handle h, void* c) {
+				CHECK(ecs.is_valid(h));
+				visited.push_back(static_cast<Label*>(c)->text);
+			});
+		rg::sort(visited);
+		CHECK_EQ(visited, std::vector<std::string>{"2", "3", "4", "5", "6", "7", "8", "9"});
+
+		// Slots are clean for the next entities
+		auto entt = ecs.create();
+		CHECK_EQ(entt->handle().index(), 1);
+		CHECK_EQ(ecs.find_component(*entt, label), nullptr);
+
+		ecs.clear();
+		CHECK_EQ(Label::alive, 0);
+
+		entt = ecs.create();
+		static_cast<Label*>(ecs.emplace_component(*entt, label))->text = "survivor";
+		CHECK_EQ(Label::alive, 1);
+
+		// Names handed out stay valid while more components are registered
+		const auto velocity_name = ecs.component_info(velocity).name;
+		for (const auto i : vw::iota(0, 64)) {
+			auto info = ecs.component_info(velocity);
+			const auto extra = fmt::format("Extra{}", i);
+			info.name = extra;
+			ecs.register_component(info);
+		}
+		CHECK_EQ(velocity_name, "Velocity");
+		CHECK_EQ(ecs.component_info(*ecs.component_id("Extra7")).name, "Extra7");
 	}
+	CHECK_EQ(Label::alive, 0);	// Destroyed with the ECS
+}
 
-	const auto first_entity = entities.begin();
-	const auto first_entity_id = first_entity->id();
+TEST_CASE ("ECS memory resource") {
+	struct Physics {
+		glm::vec2 velocity;
 
-	// View
-	auto view = ecs.view<Physics, Collision>();
-	REQUIRE(not view.empty());
-	rg::for_each(view, [&] (const auto& entt_comps) {
-			const auto& [_e, ph, col] = entt_comps;
-			REQUIRE((_e.has_value() and ph.has_value() and col.has_value()));
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
 
-			const auto e = _e.raw();
-			CHECK_EQ(e, ph->velocity.x);
-			CHECK_EQ(e, ph->velocity.y);
-			CHECK_EQ(e, col->a.x);
-			CHECK_EQ(e, col->a.y);
-			CHECK_EQ(e, col->b.x);
-			CHECK_EQ(e, col->b.y);
+	struct Rare {
+		using Storage = component::storage::Sparse;
 
-			// Tweak values of one to confirm they are retained
-			if (_e == first_entity->id()) {
-				ph->velocity.x =
-				ph->velocity.y =
-				col->a.x =
-				col->a.y =
-				col->b.x =
-				col->b.y = infinity
-				;
-			}
-		});
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Rare);
+	};
 
+	struct Position {
+		using Storage = component::storage::Archetype;
+
+		glm::vec3 position;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Position);
+	};
+
+	struct Static {
+		using Storage = component::storage::Tag;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Static);
+	};
+
+	using ECS = sage::Basic_ECS<Physics, Rare, Position, Static>;
+
+	const auto populate = [] (ECS& ecs) {
+		const auto label = ecs.register_component<Label>();
+		const auto handles = ecs.create_n(Prefab{Physics{{1, 1}}, Position{}, Static{}}, 1000);
+		for (const auto [i, h] : handles | vw::enumerate) {
+			if (i % 10 != 0)
+				continue;
+
+			auto entt = ECS::Entity{h, &ecs};
+			entt.set(Rare{1});
+			ecs.emplace_component(entt, label);
+		}
+	};
+
+	// Nothing of the world outlives it
+	auto counting = memory::Tracking_Resource{};
 	{
-		const auto bools = first_entity->has<Physics>();
-		REQUIRE(bools.has_value());
-		CHECK_EQ(std::tuple_size_v<std::decay_t<decltype(*bools)>>, 1);
-		CHECK(std::get<0>(*bools));
+		auto ecs = ECS{16, std::nullopt, Profiler::global, &counting};
+		populate(ecs);
+
+		CHECK_GT(ecs.memory().used, 0);
+		CHECK_EQ(ecs.memory().used, counting.usage().used);
+		CHECK_EQ(ecs.count<Rare>(), 100);
+		CHECK_EQ(ecs.count<Position>(), 1000);
 	}
+	CHECK_EQ(counting.usage().used, 0);
+	CHECK_EQ(Label::alive, 0);
 
+	// A world in its own Arena
+	auto arena = memory::Arena{};
 	{
-		const auto bools = first_entity->has<Physics, Collision>();
-		REQUIRE(bools.has_value());
-		CHECK_EQ(std::tuple_size_v<std::decay_t<decltype(*bools)>>, 2);
-		std::apply([] (const auto&... b) { (CHECK(b), ...); }, *bools);
+		auto ecs = ECS{16, std::nullopt, Profiler::global, &arena};
+		populate(ecs);
+
+		CHECK_GT(arena.usage().used, 0);
+		CHECK_EQ(ecs.memory().reserved, arena.usage().reserved);
+		CHECK_LE(ecs.memory().used, arena.usage().used);
+
+		auto sum = 0.f;
+		for (auto&& [_, ph, pos] : ecs.view<const Physics, const Position>())
+			sum += ph.velocity.x + pos.position.x;
+		CHECK_EQ(sum, 1000.f);
+		CHECK_EQ(fmt::format("{}", ecs.memory()).starts_with("reserved="), true);
 	}
+	arena.release();
+	CHECK_EQ(arena.usage().reserved, 0);
+}
 
-	// Check if changes remain
-	const auto components = first_entity->components<Physics, Collision>();
-	REQUIRE(components.has_value());
-	std::apply(
-			[&] <typename... Cs> (const Cs&... comps) {
-				CHECK_GT(sizeof...(comps), 0);
-				(
-					std::invoke([&] {
-						REQUIRE(comps.has_value());
-						if constexpr (std::same_as<std::optional<Physics>, Cs>) {
-							CHECK_EQ(comps->velocity, glm::vec2{infinity, infinity});
-						}
-						else if constexpr (std::same_as<std::optional<Collision>, Cs>) {
-							CHECK_EQ(comps->a, comps->b);
-							CHECK_EQ(comps->a, glm::vec2{infinity, infinity});
-						}
-						else
-							static_assert(false);
-					})
-					, ...
-				);
-			},
-			*components
-		);
+TEST_CASE ("ECS create/destroy churn") {
+	struct Physics {
+		glm::vec2 velocity;
 
-	// Destroy
-	CHECK(ecs.destroy(*first_entity));
-	CHECK(first_entity->id() != first_entity_id);
-	CHECK_EQ(ecs.size(), max_entities - 1);
+		SAGE_ECS_TYPE_NAME_GETTER(Physics);
+	};
+
+	constexpr auto max_entities = 100'000ul,
+				   churn = 10'000ul;
+
+	using ECS = sage::Basic_ECS<Physics>;
+	auto ecs = ECS{max_entities, max_entities};
+
+	auto entities = std::vector<ECS::Entity>{};
+	entities.reserve(max_entities);
+
+	// Fill the ECS with `fill` entities then time `churn` create/destroy pairs on top of them
+	const auto time_churn = [&] (const size_t fill) {
+		ecs.clear();
+		entities.clear();
+
+		for ([[maybe_unused]] const auto _ : vw::iota(0ul, fill)) {
+			auto entt = ecs.create();
+			REQUIRE(entt.has_value());
+			entities.push_back(std::move(*entt));
+		}
+		REQUIRE_EQ(ecs.size(), fill);
+
+		const auto start = std::chrono::steady_clock::now();
+		for ([[maybe_unused]] const auto _ : vw::iota(0ul, churn)) {
+			auto entt = ecs.create();
+			REQUIRE(entt.has_value());
+			REQUIRE(ecs.destroy(*entt));
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		CHECK_EQ(ecs.size(), fill);
+		return elapsed;
+	};
+
+	const auto almost_empty = time_churn(max_entities / 100),
+			   almost_full = time_churn(max_entities - 1);
+
+	MESSAGE(fmt::format("Churn of {} with {} entities: {}", churn, max_entities / 100, std::chrono::duration_cast<std::chrono::microseconds>(almost_empty)));
+	MESSAGE(fmt::format("Churn of {} with {} entities: {}", churn, max_entities - 1, std::chrono::duration_cast<std::chrono::microseconds>(almost_full)));
+
+	// A linear scan for a free slot would make the second churn ~100x slower. Only reported, timings
+	// are too noisy under sanitizers and loaded machines to fail on.
+
+	// Slots are recycled
+	{
+		CHECK_FALSE(ecs.is_full());
+
+		auto last = ecs.create();
+		REQUIRE(last.has_value());
+		CHECK(ecs.is_full());
+		CHECK_FALSE(ecs.create().has_value());
+
+		const auto stale = last->handle();
+		CHECK(ecs.destroy(*last));
+		CHECK_FALSE(ecs.is_full());
+
+		auto recycled = ecs.create();
+		REQUIRE(recycled.has_value());
+		CHECK_EQ(recycled->handle().index(), stale.index());
+
+		// Same slot but the old handle must not resolve to the new entity
+		CHECK_NE(recycled->handle(), stale);
+		CHECK_FALSE(ecs.is_valid(stale));
+		CHECK(ecs.is_valid(recycled->handle()));
+	}
 
-	// Clear
 	ecs.clear();
 	CHECK_EQ(ecs.size(), 0);
-	CHECK(ecs.view<Physics, Collision>().empty());
+	CHECK_FALSE(ecs.is_full());
 }
 
 }
@@ -0,0 +1,410 @@
+#pragma once
+
+#include "src/std.hpp"
+
+#include "src/ecs.hpp"
+#include "src/job.hpp"
+#include "src/log.hpp"
+
+namespace sage::inline ecs {
+
+// Cached world matrices of the entities with a Transform. The Transform of an entity with a
+// component::Parent is relative to the world matrix of its parent.
+//
+// auto hierarchy = Transform_Hierarchy<ECS>{};
+// ...
+// hierarchy.update(ecs);	// Once per frame, after the Transforms are written
+// for (const auto [handle, world] : vw::zip(hierarchy.handles(), hierarchy.worlds()))
+//     renderer.draw(color, world);
+//
+// Entities are kept in preorder: a subtree is a contiguous range that starts with its root, so
+// parents come before their children. update() only recomputes the subtrees of the Transforms
+// that changed since the previous update (see Basic_ECS::changed()), each in a linear pass, and
+// spreads independent subtrees over a job::Pool when there is enough work.
+//
+// The order is rebuilt when Transforms or Parents are added, removed or accessed mutably.
+// An entity whose parent is not valid or has no Transform is a root, so is one entity of a cycle.
+template <typename ECS>
+	requires (ECS::template is_component<component::Transform> and ECS::template is_component<component::Parent>)
+struct Transform_Hierarchy {
+	static constexpr auto null = std::numeric_limits<uint32_t>::max();
+
+private:
+	// In preorder
+	std::vector<entity::Handle> _handles;
+	std::vector<uint32_t> parents;	// Position of the parent, null for roots
+	std::vector<uint32_t> ends;		// One past the last position of the subtree
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> _worlds;
+
+	std::vector<uint32_t> positions;	// Per entity index, null if not in the hierarchy
+	size_t number_of_parents = 0;		// As of the last rebuild, to notice removals
+	size_t _recomputed = 0;
+	component::storage::Tick since = 0;
+
+public:
+	auto update(ECS& ecs, const Parallel& parallel = {}) -> void {
+		const auto is_stale =
+				_handles.size() != ecs.template count<component::Transform>()
+			or number_of_parents != ecs.template count<component::Parent>()
+			or not ecs.template added<const component::Transform>(since).empty()
+			or not ecs.template changed<const component::Parent>(since).empty()
+			;
+
+		auto dirty = std::vector<std::pair<uint32_t, uint32_t>>{};
+
+		if (is_stale) {
+			rebuild(ecs);
+			for (auto root = 0u; root < _handles.size(); root = ends[root])
+				dirty.emplace_back(root, ends[root]);
+		}
+		else {
+			auto changed = std::vector<uint32_t>{};
+			for (auto&& [handle, transform] : ecs.template changed<const component::Transform>(since)) {
+				const auto pos = positions[handle.index()];
+				locals[pos] = transform.trans;
+				changed.push_back(pos);
+			}
+
+			// Subtrees of changed entities that are not in the subtree of another one
+			rg::sort(changed);
+			for (const auto pos : changed)
+				if (dirty.empty() or pos >= dirty.back().second)
+					dirty.emplace_back(pos, ends[pos]);
+		}
+
+		compute(dirty, parallel);
+		since = ecs.advance_tick();
+	}
+
+	// Null if the entity has no Transform, or is not valid, as of the last update
+	auto world(const entity::Handle h) const -> const glm::mat4* {
+		if (h.index() >= positions.size() or positions[h.index()] == null)
+			return nullptr;
+
+		const auto pos = positions[h.index()];
+		return _handles[pos] == h ? &_worlds[pos] : nullptr;
+	}
+
+	// In preorder, parents before their children
+	auto handles() const -> std::span<const entity::Handle> {
+		return _handles;
+	}
+
+	// Same order as handles()
+	auto worlds() const -> std::span<const glm::mat4> {
+		return _worlds;
+	}
+
+	auto size() const -> size_t {
+		return _handles.size();
+	}
+
+	// World matrices computed by the last update
+	auto recomputed() const -> size_t {
+		return _recomputed;
+	}
+
+private:
+	auto rebuild(ECS& ecs) -> void {
+		// Gather in order of index so that the result does not depend on the storage
+		auto gathered = std::vector<std::pair<entity::Handle, glm::mat4>>{};
+		gathered.reserve(ecs.template count<component::Transform>());
+		for (auto&& [handle, transform] : ecs.template view<const component::Transform>())
+			gathered.emplace_back(handle, transform.trans);
+		rg::sort(gathered, {}, [] (const auto& g) { return g.first.index(); });
+
+		const auto n = static_cast<uint32_t>(gathered.size());
+
+		auto slots = std::vector<uint32_t>(ecs.capacity(), null);	// Entity index to gathered
+		for (const auto [k, g] : gathered | vw::enumerate)
+			slots[g.first.index()] = static_cast<uint32_t>(k);
+
+		auto parent_of = std::vector<uint32_t>(n, null);
+		for (auto&& [handle, parent, _] : ecs.template view<const component::Parent, const component::Transform>())
+			if (ecs.is_valid(parent.handle) and parent.handle != handle)
+				parent_of[slots[handle.index()]] = slots[parent.handle.index()];
+
+		// Children in order, linked from the last to keep it
+		auto first_child = std::vector<uint32_t>(n, null),
+			 next_sibling = std::vector<uint32_t>(n, null);
+		for (const auto k : vw::iota(0u, n) | vw::reverse)
+			if (const auto p = parent_of[k]; p != null) {
+				next_sibling[k] = first_child[p];
+				first_child[p] = k;
+			}
+
+		_handles.clear();
+		parents.clear();
+		locals.clear();
+		positions.assign(ecs.capacity(), null);
+
+		auto stack = std::vector<uint32_t>{};
+		const auto visit = [&] (const uint32_t root) {
+				stack.push_back(root);
+				while (not stack.empty()) {
+					const auto k = stack.back();
+					stack.pop_back();
+
+					// The entity where a cycle was cut is still a child of its old parent
+					const auto& [handle, local] = gathered[k];
+					if (positions[handle.index()] != null)
+						continue;
+
+					const auto p = parent_of[k];
+					positions[handle.index()] = static_cast<uint32_t>(_handles.size());
+					_handles.push_back(handle);
+					parents.push_back(p == null ? null : positions[gathered[p].first.index()]);
+					locals.push_back(local);
+
+					// Reversed so that the first child is visited first
+					const auto first = stack.size();
+					for (auto c = first_child[k]; c != null; c = next_sibling[c])
+						stack.push_back(c);
+					std::reverse(stack.begin() + static_cast<std::ptrdiff_t>(first), stack.end());
+				}
+			};
+
+		for (const auto k : vw::iota(0u, n))
+			if (parent_of[k] == null)
+				visit(k);
+
+		// What is left hangs from a cycle, cut it at the first entity found
+		for (const auto k : vw::iota(0u, n))
+			if (positions[gathered[k].first.index()] == null) {
+				SAGE_LOG_WARN("Parent cycle at {}, made it a root", gathered[k].first);
+				parent_of[k] = null;
+				visit(k);
+			}
+
+		SAGE_ASSERT(_handles.size() == n);
+
+		// Preorder: the subtree of a node ends where the last of its descendants ends.
+		// Children are after their parent so walking backwards visits them first.
+		ends.assign(n, 0);
+		for (const auto i : vw::iota(0u, n) | vw::reverse) {
+			ends[i] = std::max(ends[i], i + 1);
+			if (parents[i] != null)
+				ends[parents[i]] = std::max(ends[parents[i]], ends[i]);
+		}
+
+		_worlds.resize(n);
+		number_of_parents = ecs.template count<component::Parent>();
+	}
+
+	auto compute_range(const uint32_t first, const uint32_t last) -> void {
+		for (const auto i : vw::iota(first, last))
+			_worlds[i] = parents[i] == null ? locals[i] : _worlds[parents[i]] * locals[i];
+	}
+
+	// The ranges are disjoint subtrees whose parents are up to date
+	auto compute(std::vector<std::pair<uint32_t, uint32_t>>& ranges, const Parallel& parallel) -> void {
+		_recomputed = rg::fold_left(ranges | vw::transform([] (const auto& r) { return r.second - r.first; }), 0ul, std::plus{});
+
+		auto& pool = parallel.pool != nullptr ? *parallel.pool : job::Pool::shared();
+		if (_recomputed < parallel.serial_threshold or pool.concurrency() == 1) {
+			for (const auto& [first, last] : ranges)
+				compute_range(first, last);
+			return;
+		}
+
+		const auto target = parallel.chunk_size > 0
+			? parallel.chunk_size
+			: std::max(1024ul, _recomputed / (pool.concurrency() * 4));
+
+		// Split the big subtrees: compute their root here and queue the subtrees of its children
+		auto pieces = std::vector<std::pair<uint32_t, uint32_t>>{};
+		while (not ranges.empty()) {
+			const auto [first, last] = ranges.back();
+			ranges.pop_back();
+
+			if (last - first <= target or last - first == 1) {
+				pieces.emplace_back(first, last);
+				continue;
+			}
+
+			compute_range(first, first + 1);
+			for (auto child = first + 1; child < last; child = ends[child])
+				ranges.emplace_back(child, ends[child]);
+		}
+
+		// Chunks of about target worlds
+		auto chunks = std::vector<size_t>{0};
+		auto size = 0ul;
+		for (const auto [i, piece] : pieces | vw::enumerate) {
+			size += piece.second - piece.first;
+			if (size >= target) {
+				chunks.push_back(static_cast<size_t>(i) + 1);
+				size = 0;
+			}
+		}
+		if (chunks.back() != pieces.size())
+			chunks.push_back(pieces.size());
+
+		pool.for_each_chunk(chunks.size() - 1, [&] (const size_t c) {
+				for (const auto& [first, last] : std::span{pieces}.subspan(chunks[c], chunks[c + 1] - chunks[c]))
+					compute_range(first, last);
+			});
+	}
+};
+
+}// sage::ecs
+
+#ifdef SAGE_TEST_ECS_HIERARCHY
+namespace {
+
+using namespace sage;
+
+struct Sprite {
+	using Storage = component::storage::Archetype;
+
+	glm::vec4 color;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Sprite);
+};
+
+using ECS = Basic_ECS<component::Transform, component::Parent, Sprite>;
+using Hierarchy = Transform_Hierarchy<ECS>;
+
+auto translation(const float x, const float y, const float z) -> component::Transform {
+	return { .trans = glm::translate(math::identity<glm::mat4>, {x, y, z}) };
+}
+
+auto origin(const glm::mat4& m) -> glm::vec3 {
+	return m * glm::vec4{0, 0, 0, 1};
+}
+
+TEST_CASE ("Transform hierarchy") {
+	auto ecs = ECS{16};
+	auto hierarchy = Hierarchy{};
+
+	auto root = *ecs.create(),
+		 child = *ecs.create(),
+		 grandchild = *ecs.create(),
+		 other = *ecs.create(),
+		 bare = *ecs.create();
+
+	// Children before their parents in the slots, the order does not depend on it
+	grandchild.set(translation(0, 0, 1), component::Parent{child.handle()});
+	child.set(translation(0, 1, 0), component::Parent{root.handle()});
+	root.set(translation(1, 0, 0));
+	other.set(translation(5, 0, 0), Sprite{});
+	bare.set(Sprite{});
+
+	hierarchy.update(ecs);
+	CHECK_EQ(hierarchy.size(), 4);
+	CHECK_EQ(hierarchy.recomputed(), 4);
+	CHECK_EQ(hierarchy.world(bare.handle()), nullptr);
+
+	CHECK_EQ(origin(*hierarchy.world(root.handle())), glm::vec3{1, 0, 0});
+	CHECK_EQ(origin(*hierarchy.world(child.handle())), glm::vec3{1, 1, 0});
+	CHECK_EQ(origin(*hierarchy.world(grandchild.handle())), glm::vec3{1, 1, 1});
+	CHECK_EQ(origin(*hierarchy.world(other.handle())), glm::vec3{5, 0, 0});
+
+	CHECK_EQ(hierarchy.handles().front(), root.handle());
+	CHECK_EQ(hierarchy.handles()[1], child.handle());
+	CHECK_EQ(hierarchy.handles()[2], grandchild.handle());
+
+	// Nothing changed
+	hierarchy.update(ecs);
+	CHECK_EQ(hierarchy.recomputed(), 0);
+
+	// Only the subtree of what changed, reading does not count
+	CHECK(ecs.components_of<const component::Transform>(root).has_value());
+	std::get<0>(*ecs.components_of<component::Transform>(child))->trans = translation(0, 2, 0).trans;
+	hierarchy.update(ecs);
+	CHECK_EQ(hierarchy.recomputed(), 2);
+	CHECK_EQ(origin(*hierarchy.world(grandchild.handle())), glm::vec3{1, 2, 1});
+
+	// Nested changes are a single subtree
+	root.set(translation(2, 0, 0));
+	grandchild.set(translation(0, 0, 3));
+	hierarchy.update(ecs);
+	CHECK_EQ(hierarchy.recomputed(), 3);
+	CHECK_EQ(origin(*hierarchy.world(grandchild.handle())), glm::vec3{2, 2, 3});
+
+	// Reparent
+	child.set(component::Parent{other.handle()});
+	hierarchy.update(ecs);
+	CHECK_EQ(origin(*hierarchy.world(grandchild.handle())), glm::vec3{5, 2, 3});
+
+	// The parent is gone, child is a root
+	ecs.destroy(other);
+	hierarchy.update(ecs);
+	CHECK_EQ(hierarchy.size(), 3);
+	CHECK_EQ(hierarchy.world(other.handle()), nullptr);
+	CHECK_EQ(origin(*hierarchy.world(grandchild.handle())), glm::vec3{0, 2, 3});
+
+	// Detach
+	grandchild.remove<component::Parent>();
+	hierarchy.update(ecs);
+	CHECK_EQ(origin(*hierarchy.world(grandchild.handle())), glm::vec3{0, 0, 3});
+
+	// A cycle does not hang
+	grandchild.set(component::Parent{child.handle()});
+	child.set(component::Parent{grandchild.handle()});
+	hierarchy.update(ecs);
+	CHECK_EQ(hierarchy.size(), 3);
+	CHECK_NE(hierarchy.world(child.handle()), nullptr);
+	CHECK_NE(hierarchy.world(grandchild.handle()), nullptr);
+}
+
+TEST_CASE ("Transform hierarchy in parallel") {
+	// A forest of roots with chains and fans below them
+	constexpr auto roots = 200ul;
+	constexpr auto fan = 50ul;
+
+	auto ecs = ECS{roots * (fan + 2)};
+	for (const auto r : vw::iota(0ul, roots)) {
+		auto root = *ecs.create();
+		root.set(translation(static_cast<float>(r), 0, 0));
+
+		auto mid = *ecs.create();
+		mid.set(translation(0, 1, 0), component::Parent{root.handle()});
+
+		for (const auto f : vw::iota(0ul, fan)) {
+			auto leaf = *ecs.create();
+			leaf.set(translation(0, 0, static_cast<float>(f)), component::Parent{mid.handle()});
+		}
+	}
+
+	auto pool = job::Pool{3};
+	auto serial = Hierarchy{},
+		 parallel = Hierarchy{};
+
+	const auto check_same = [&] {
+			auto mismatches = 0ul;
+			for (const auto [handle, world] : vw::zip(serial.handles(), serial.worlds()))
+				if (const auto* w = parallel.world(handle); w == nullptr or not (*w == world))
+					++mismatches;
+			CHECK_EQ(mismatches, 0);
+		};
+
+	serial.update(ecs, { .serial_threshold = std::numeric_limits<size_t>::max() });
+	parallel.update(ecs, { .serial_threshold = 0, .chunk_size = 16, .pool = &pool });
+	CHECK_EQ(parallel.recomputed(), roots * (fan + 2));
+	check_same();
+
+	// A single big dirty subtree is split below its root
+	auto big = *ecs.create();
+	big.set(translation(0, 0, 0));
+	for (const auto i : vw::iota(0ul, 1000ul)) {
+		auto leaf = *ecs.create();
+		leaf.set(translation(static_cast<float>(i), 0, 0), component::Parent{big.handle()});
+	}
+
+	serial.update(ecs, { .serial_threshold = std::numeric_limits<size_t>::max() });
+	parallel.update(ecs, { .serial_threshold = 0, .chunk_size = 16, .pool = &pool });
+	check_same();
+
+	for (auto&& [_, transform] : ecs.view<component::Transform>())
+		transform.trans = transform.trans * translation(1, 1, 1).trans;
+
+	serial.update(ecs, { .serial_threshold = std::numeric_limits<size_t>::max() });
+	parallel.update(ecs, { .serial_threshold = 0, .chunk_size = 16, .pool = &pool });
+	CHECK_EQ(parallel.recomputed(), parallel.size());
+	check_same();
+}
+
+}
+#endif
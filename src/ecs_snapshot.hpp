@@ -0,0 +1,864 @@
+#pragma once
+
+#include "src/std.hpp"
+
+#include "src/ecs.hpp"
+#include "src/log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace sage::inline ecs::snapshot {
+
+// Binary snapshot of a whole Basic_ECS, for level loading, checkpoints and test fixtures.
+//
+// Every section starts 16 bytes aligned and offsets are from the start of the snapshot:
+//
+// Header
+// Handle::Rep x capacity               The slots as they are, generations and free list included
+// Column x number_of_columns           One per component of the ECS
+// Per Column:
+//     Index x count                    The entities that have the component
+//     Raw:     C x count               The bytes of the components
+//     Strings: uint32_t x (count + 1)  Offset of every string in the characters that follow
+//              char x ...
+//
+// Loading reads the sections in place, so a snapshot can be mapped (see Mapped_File) and loaded
+// with no parsing: the Raw components are copied into the ECS a block at a time, Names one by one
+// since they are interned. The snapshot must start 16 bytes aligned, as save() and Mapped_File
+// give it. Numbers are native endian and snapshots of another endianness are rejected.
+//
+// Runtime registered components and change ticks are not saved, the loaded components are added
+// at the tick of the load.
+
+inline constexpr auto magic = std::array<char, 8>{'S', 'A', 'G', 'E', 'E', 'C', 'S', '\0'};
+inline constexpr auto version = uint32_t{1};
+inline constexpr auto endianness = uint32_t{0x01020304};
+inline constexpr auto alignment = 16ul;
+
+using Bytes = std::vector<std::byte>;
+
+struct Header {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t endianness;
+	uint64_t capacity;
+	uint64_t size;
+	uint32_t free_head;
+	uint32_t number_of_columns;
+	uint64_t handles;
+	uint64_t columns;
+};
+
+enum class Kind : uint32_t { Raw, Strings };
+
+struct Column {
+	std::array<char, 48> name;	// type_name() of the component, null terminated
+	Kind kind;
+	uint32_t element_size;
+	uint64_t count;
+	uint64_t entities;
+	uint64_t data;
+};
+
+static_assert(std::is_trivially_copyable_v<Header> and std::is_trivially_copyable_v<Column>);
+
+// Components are saved as their bytes if they are trivially copyable, Names as strings since
+// their Ids only mean something to the name::Table of the process. Default Names are empty strings.
+template <typename C>
+concept Named = std::same_as<C, component::Name>;
+
+template <typename C>
+concept Raw = std::is_trivially_copyable_v<C> and not Named<C>;
+
+template <typename C>
+concept Serializable = Raw<C> or Named<C>;
+
+// The implementation, befriended by Basic_ECS
+struct Access {
+	using Index = entity::Handle::Index;
+
+	template <Serializable... Cs>
+	static auto save(const Basic_ECS<Cs...>& ecs) -> Bytes {
+		auto out = Bytes{};
+		out.reserve(sizeof(Header) + ecs.handles.size() * (sizeof(entity::Handle::Rep) + (sizeof(Index) + ... + sizeof(Cs))));
+
+		const auto header = allocate(out, sizeof(Header));
+		const auto handles = allocate(out, ecs.handles.size() * sizeof(entity::Handle::Rep));
+		const auto columns = allocate(out, sizeof...(Cs) * sizeof(Column));
+
+		write(out, header, Header{
+				.magic = magic,
+				.version = version,
+				.endianness = endianness,
+				.capacity = ecs.handles.size(),
+				.size = ecs._size,
+				.free_head = ecs.free_head,
+				.number_of_columns = sizeof...(Cs),
+				.handles = handles,
+				.columns = columns,
+			});
+
+		for (const auto [i, h] : ecs.handles | vw::enumerate)
+			write(out, handles + i * sizeof(entity::Handle::Rep), h.raw());
+
+		[&] <size_t... I> (std::index_sequence<I...>) {
+			(write(out, columns + I * sizeof(Column), save_column<Cs>(ecs, out)), ...);
+		}(std::index_sequence_for<Cs...>{});
+
+		return out;
+	}
+
+	template <Serializable... Cs>
+	static auto load(Basic_ECS<Cs...>& ecs, const std::span<const std::byte> in) -> bool {
+		using ECS = Basic_ECS<Cs...>;
+
+		// Validate everything first, a failed load leaves the ECS as it was
+		const auto header = read<Header>(in, 0);
+		if (not header.has_value())
+			return fail("too small for a header");
+		if (reinterpret_cast<std::uintptr_t>(in.data()) % alignment != 0)
+			return fail("misaligned");
+		if (header->magic != magic)
+			return fail("not a snapshot");
+		if (header->version != version)
+			return fail(fmt::format("version {} instead of {}", header->version, version));
+		if (header->endianness != endianness)
+			return fail("of another endianness");
+		if (header->capacity > ecs.max_capacity() or header->size > header->capacity)
+			return fail(fmt::format("{} entities out of {} do not fit in {}", header->size, header->capacity, ecs.max_capacity()));
+		if (not fits(in, header->handles, header->capacity * sizeof(entity::Handle::Rep))
+			or not fits(in, header->columns, header->number_of_columns * sizeof(Column)))
+		{
+			return fail("truncated");
+		}
+
+		const auto capacity = static_cast<Index>(header->capacity);
+		const auto handle = [&] (const size_t i) {
+				const auto rep = *read<entity::Handle::Rep>(in, header->handles + i * sizeof(entity::Handle::Rep));
+				return entity::Handle{rep & entity::Handle::index_mask, rep >> entity::Handle::index_bits};
+			};
+		const auto is_alive = [&] (const Index i) { return i < capacity and handle(i).index() == i; };
+
+		// Slots in use and the free list must add up
+		{
+			auto alive = 0ul;
+			for (const auto i : vw::iota(Index{0}, capacity))
+				alive += is_alive(i) ? 1 : 0;
+
+			auto free = 0ul;
+			for (auto i = header->free_head; i != entity::Handle::null_index; i = handle(i).index())
+				if (i >= capacity or is_alive(i) or ++free > capacity)
+					return fail("corrupted free list");
+
+			if (alive != header->size or alive + free != capacity)
+				return fail("corrupted entities");
+		}
+
+		// Column of each of the Cs, if any
+		auto found = std::array<std::optional<Column>, sizeof...(Cs)>{};
+		for (const auto c : vw::iota(0u, header->number_of_columns)) {
+			const auto column = *read<Column>(in, header->columns + c * sizeof(Column));
+			const auto name = std::string_view{column.name.data(), rg::find(column.name, '\0')};
+
+			auto is_known = false;
+			auto error = std::optional<std::string>{};
+			[&] <size_t... I> (std::index_sequence<I...>) {
+				(
+					std::invoke([&] {
+						using C = type::At<I, Cs...>;
+						if (is_known or name != C::type_name())
+							return;
+
+						is_known = true;
+						found[I] = column;
+						error = validate<C>(in, column, capacity, is_alive);
+					})
+					, ...
+				);
+			}(std::index_sequence_for<Cs...>{});
+
+			if (error.has_value())
+				return fail(fmt::format("{}: {}", name, *error));
+			if (not is_known)
+				SAGE_LOG_WARN("Snapshot component {} is not in the ECS, skipped", name);
+		}
+
+		// Now load
+		ecs.clear();
+		if (capacity > ecs.handles.size())
+			ecs.grow_to(capacity);
+
+		for (const auto i : vw::iota(Index{0}, capacity))
+			ecs.handles[i] = handle(i);
+
+		// The slots past the capacity of the snapshot go in front of its free list
+		const auto total = static_cast<Index>(ecs.handles.size());
+		for (const auto i : vw::iota(capacity, total))
+			ecs.handles[i] = entity::Handle{i + 1 < total ? i + 1 : header->free_head, ecs.handles[i].generation()};
+
+		ecs.free_head = capacity < total ? capacity : header->free_head;
+		ecs._size = header->size;
+
+		const auto entities = [&] (const Column& column) { return array_of<Index>(in, column.entities, column.count); };
+
+		// Every signature first, in one pass per column
+		[&] <size_t... I> (std::index_sequence<I...>) {
+			(
+				std::invoke([&] {
+					if (found[I].has_value())
+						for (const auto idx : entities(*found[I]))
+							ecs.signatures[idx] |= ECS::template signature_of<type::At<I, Cs...>>();
+				})
+				, ...
+			);
+		}(std::index_sequence_for<Cs...>{});
+
+		// Move every entity to its final archetype once, in the order of the snapshot so that the rows
+		// of a table are in the order of the columns and load_column() copies runs of them
+		if constexpr ((component::storage::Is_Archetype<Cs> or ...)) {
+			auto is_placed = std::vector<bool>(capacity);
+			[&] <size_t... I> (std::index_sequence<I...>) {
+				(
+					std::invoke([&] {
+						if constexpr (component::storage::Is_Archetype<type::At<I, Cs...>>)
+							if (found[I].has_value())
+								for (const auto idx : entities(*found[I]))
+									if (not is_placed[idx]) {
+										is_placed[idx] = true;
+										ecs.archetypes.extend(idx, ECS::to_archetype_signature(ecs.signatures[idx]));
+									}
+					})
+					, ...
+				);
+			}(std::index_sequence_for<Cs...>{});
+		}
+
+		[&] <size_t... I> (std::index_sequence<I...>) {
+			(
+				std::invoke([&] {
+					if (found[I].has_value())
+						load_column<type::At<I, Cs...>>(ecs, in, *found[I], entities(*found[I]));
+				})
+				, ...
+			);
+		}(std::index_sequence_for<Cs...>{});
+
+		// The index is built once all the Names are in
+		if constexpr (ECS::has_names) {
+			ecs.named.reserve(ecs.template count<component::Name>());
+			for (const auto idx : vw::iota(Index{0}, capacity))
+				if (ecs.signatures[idx].test(type::index_of<component::Name, Cs...>()))
+					ecs.index_name(idx);
+		}
+
+		ecs.refill_groups();
+
+		return true;
+	}
+
+private:
+	// Zero filled and aligned, returns the offset
+	static auto allocate(Bytes& out, const size_t bytes) -> uint64_t {
+		const auto offset = (out.size() + alignment - 1) / alignment * alignment;
+		out.resize(offset + bytes);
+		return offset;
+	}
+
+	template <typename T>
+		requires std::is_trivially_copyable_v<T>
+	static auto write(Bytes& out, const uint64_t offset, const T& t) -> void {
+		std::memcpy(out.data() + offset, &t, sizeof(T));
+	}
+
+	static auto fits(const std::span<const std::byte> in, const uint64_t offset, const uint64_t bytes) -> bool {
+		return offset <= in.size() and bytes <= in.size() - offset;
+	}
+
+	template <typename T>
+		requires std::is_trivially_copyable_v<T>
+	static auto read(const std::span<const std::byte> in, const uint64_t offset) -> std::optional<T> {
+		if (not fits(in, offset, sizeof(T)))
+			return std::nullopt;
+
+		auto t = T{};
+		std::memcpy(&t, in.data() + offset, sizeof(T));
+		return t;
+	}
+
+	// In place, the sections are aligned and fit in the snapshot
+	template <typename T>
+		requires std::is_trivially_copyable_v<T>
+	static auto array_of(const std::span<const std::byte> in, const uint64_t offset, const uint64_t count) -> std::span<const T> {
+		SAGE_ASSERT(offset % alignof(T) == 0 and fits(in, offset, count * sizeof(T)));
+		return { reinterpret_cast<const T*>(in.data() + offset), count };
+	}
+
+	static auto fail(const std::string_view why) -> bool {
+		SAGE_LOG_WARN("Cannot load snapshot: {}", why);
+		return false;
+	}
+
+	template <typename C, typename ECS>
+	static auto save_column(const ECS& ecs, Bytes& out) -> Column {
+		auto column = Column{
+				.name = {},
+				.kind = Raw<C> ? Kind::Raw : Kind::Strings,
+				.element_size = Raw<C> ? sizeof(C) : 0,
+				.count = ecs.template count<C>(),
+				.entities = 0,
+				.data = 0,
+			};
+
+		SAGE_ASSERT(C::type_name().size() < column.name.size(), "Name of {} is too long for a snapshot", C::type_name());
+		rg::copy(C::type_name().substr(0, column.name.size() - 1), column.name.begin());
+
+		column.entities = allocate(out, column.count * sizeof(Index));
+
+		// Visit the components in the order their entities are written
+		const auto each = [&] (auto&& fn) {
+				auto k = 0ul;
+				if constexpr (component::storage::Is_Archetype<C>)
+					ecs.archetypes.each_chunk(ECS::Archetype_Storage::template signature_of<C>(), [&] (const auto& chunk) {
+							for (const auto [idx, c] : vw::zip(chunk.entities, chunk.template column<C>()))
+								fn(k++, idx, c);
+						});
+				else if constexpr (component::storage::Is_Sparse<C>)
+					for (const auto idx : ecs.template column<C>().entities())
+						fn(k++, idx, ecs.template column<C>().get(idx));
+				else
+					for (const auto idx : vw::iota(Index{0}, static_cast<Index>(ecs.handles.size())))
+						if (const auto* c = ecs.template column<C>().find(idx); c != nullptr)
+							fn(k++, idx, *c);
+			};
+
+		if constexpr (Raw<C>) {
+			column.data = allocate(out, column.count * sizeof(C));
+			each([&] (const size_t k, const Index idx, const C& c) {
+					write(out, column.entities + k * sizeof(Index), idx);
+					write(out, column.data + k * sizeof(C), c);
+				});
+		}
+		else {
+			column.data = allocate(out, (column.count + 1) * sizeof(uint32_t));
+
+			auto chars = std::string{};
+			each([&] (const size_t k, const Index idx, const C& c) {
+					write(out, column.entities + k * sizeof(Index), idx);
+					write(out, column.data + k * sizeof(uint32_t), static_cast<uint32_t>(chars.size()));
+					chars += c.view();
+				});
+			write(out, column.data + column.count * sizeof(uint32_t), static_cast<uint32_t>(chars.size()));
+
+			const auto at = out.size();
+			out.resize(at + chars.size());
+			std::memcpy(out.data() + at, chars.data(), chars.size());
+		}
+
+		return column;
+	}
+
+	template <typename C>
+	static auto validate(const std::span<const std::byte> in, const Column& column, const Index capacity, const auto& is_alive) -> std::optional<std::string> {
+		if (column.kind != (Raw<C> ? Kind::Raw : Kind::Strings))
+			return "stored differently";
+		if (Raw<C> and column.element_size != sizeof(C))
+			return fmt::format("size {} instead of {}", column.element_size, sizeof(C));
+		if (not fits(in, column.entities, column.count * sizeof(Index)))
+			return "truncated entities";
+
+		if (column.entities % alignment != 0 or column.data % alignment != 0)
+			return "misaligned";
+
+		auto seen = std::vector<bool>(capacity);
+		for (const auto idx : array_of<Index>(in, column.entities, column.count)) {
+			if (not is_alive(idx))
+				return "entity is not alive";
+			if (seen[idx])
+				return "entity is in twice";
+			seen[idx] = true;
+		}
+
+		if constexpr (Raw<C>) {
+			if (not fits(in, column.data, column.count * sizeof(C)))
+				return "truncated";
+		}
+		else {
+			if (not fits(in, column.data, (column.count + 1) * sizeof(uint32_t)))
+				return "truncated offsets";
+
+			auto previous = 0u;
+			for (const auto k : vw::iota(0ul, column.count + 1)) {
+				const auto offset = *read<uint32_t>(in, column.data + k * sizeof(uint32_t));
+				if (offset < previous)
+					return "corrupted offsets";
+				previous = offset;
+			}
+
+			if (not fits(in, column.data + (column.count + 1) * sizeof(uint32_t), previous))
+				return "truncated strings";
+		}
+
+		return std::nullopt;
+	}
+
+	// Into the entities that have the component in their signature and the Archetype rows of it
+	template <typename C, typename ECS>
+	static auto load_column(ECS& ecs, const std::span<const std::byte> in, const Column& column, const std::span<const Index> entities) -> void {
+		const auto ticks = component::storage::Ticks{ .added = ecs.current_tick, .changed = ecs.current_tick };
+
+		if constexpr (Named<C>) {
+			auto&& col = ecs.template column<C>();
+			const auto offsets = array_of<uint32_t>(in, column.data, column.count + 1);
+			const auto* chars = reinterpret_cast<const char*>(in.data() + column.data + (column.count + 1) * sizeof(uint32_t));
+
+			for (const auto [k, idx] : entities | vw::enumerate) {
+				const auto first = offsets[static_cast<size_t>(k)],
+						   last = offsets[static_cast<size_t>(k) + 1];
+				col.set(idx, first == last ? C{} : C{std::string_view{chars + first, chars + last}});
+				ecs.template touch<C>(idx, true);
+			}
+		}
+		else if constexpr (component::storage::Is_Archetype<C>) {
+			// The rows are mostly in the order of the snapshot, see load()
+			auto position = std::vector<uint32_t>(ecs.handles.size());
+			for (const auto [k, idx] : entities | vw::enumerate)
+				position[idx] = static_cast<uint32_t>(k);
+
+			ecs.archetypes.each_chunk(ECS::Archetype_Storage::template signature_of<C>(), [&] (typename ECS::Archetype_Storage::Chunk& chunk) {
+					auto& components = chunk.template column<C>();
+					for (auto row = 0ul; row < chunk.size(); ) {
+						const auto k = position[chunk.entities[row]];
+						auto run = 1ul;
+						while (row + run < chunk.size() and position[chunk.entities[row + run]] == k + run)
+							++run;
+
+						std::memcpy(components.data() + row, in.data() + column.data + k * sizeof(C), run * sizeof(C));
+						row += run;
+					}
+					rg::fill(chunk.template ticks_of<C>(), ticks);
+				});
+		}
+		else
+			ecs.template column<C>().append(entities, ticks, array_of<C>(in, column.data, column.count));
+	}
+};
+
+// Capture the ECS, it is a copy of its columns.
+template <Serializable... Cs>
+auto save(const Basic_ECS<Cs...>& ecs) -> Bytes {
+	return Access::save(ecs);
+}
+
+// Replace everything in the ECS with the snapshot, the Handles of the snapshot are valid afterwards.
+// The components of the snapshot are matched by name, the ones the ECS does not know are skipped.
+// False, and the ECS is untouched, if the snapshot is corrupted, of another version, does not fit
+// in the max_capacity() of the ECS or has components of the ECS saved with another size.
+template <Serializable... Cs>
+[[nodiscard]]
+auto load(Basic_ECS<Cs...>& ecs, const std::span<const std::byte> snapshot) -> bool {
+	return Access::load(ecs, snapshot);
+}
+
+// Read only mapping of a whole file, empty if it cannot be mapped.
+struct Mapped_File {
+private:
+	void* address = MAP_FAILED;
+	size_t _size = 0;
+
+public:
+	explicit Mapped_File(const fs::path& path) {
+		const auto fd = ::open(path.c_str(), O_RDONLY);
+		if (fd == -1) {
+			SAGE_LOG_WARN("Cannot open {}: {}", path, std::strerror(errno));
+			return;
+		}
+
+		auto err = std::error_code{};
+		_size = fs::file_size(path, err);
+		if (not err and _size > 0)
+			address = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+
+		if (address == MAP_FAILED)
+			_size = 0;
+
+		::close(fd);
+	}
+
+	Mapped_File(const Mapped_File&) = delete;
+	auto operator= (const Mapped_File&) -> Mapped_File& = delete;
+
+	~Mapped_File() {
+		if (address != MAP_FAILED)
+			::munmap(address, _size);
+	}
+
+public:
+	auto bytes() const -> std::span<const std::byte> {
+		return { static_cast<const std::byte*>(address), _size };
+	}
+};
+
+template <Serializable... Cs>
+[[nodiscard]]
+auto load(Basic_ECS<Cs...>& ecs, const fs::path& path) -> bool {
+	const auto file = Mapped_File{path};
+	return load(ecs, file.bytes());
+}
+
+// Writes a snapshot to a file on its own thread so that saving does not stall the frame,
+// only save() runs on the calling thread:
+//
+// auto writer = snapshot::Writer{"checkpoint.snapshot", snapshot::save(ecs)};
+// ...
+// if (writer.is_done() and not writer.wait())
+//     SAGE_LOG_WARN("Checkpoint failed");
+//
+// The snapshot goes to a temporary file that is renamed when complete, so the file at `path`
+// is always a whole snapshot. Destroying the Writer early cancels the write.
+struct Writer {
+	static constexpr auto block_bytes = 1ul << 20;
+
+private:
+	std::atomic<bool> done = false;
+	bool ok = false;
+	std::jthread thread;
+
+public:
+	Writer(fs::path path, Bytes snapshot)
+		: thread{[this, path = std::move(path), snapshot = std::move(snapshot)] (const std::stop_token stoken) {
+				ok = write(stoken, path, snapshot);
+				done.store(true, std::memory_order_release);
+			}}
+	{}
+
+	Writer(const Writer&) = delete;
+	auto operator= (const Writer&) -> Writer& = delete;
+
+public:
+	auto is_done() const -> bool {
+		return done.load(std::memory_order_acquire);
+	}
+
+	// Block until written, true if the file is complete
+	auto wait() -> bool {
+		if (thread.joinable())
+			thread.join();
+		return ok;
+	}
+
+private:
+	static auto write(const std::stop_token stoken, const fs::path& path, const std::span<const std::byte> snapshot) -> bool {
+		::prctl(PR_SET_NAME, "sage_snapshot");
+
+		auto tmp = path;
+		tmp += ".tmp";
+
+		{
+			auto stream = std::ofstream{tmp, std::ios::out | std::ios::binary | std::ios::trunc};
+			for (auto at = 0ul; stream and at < snapshot.size(); at += block_bytes) {
+				if (stoken.stop_requested())
+					break;
+
+				const auto block = snapshot.subspan(at, std::min(block_bytes, snapshot.size() - at));
+				stream.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+			}
+
+			if (not stream or stoken.stop_requested()) {
+				stream.close();
+				fs::remove(tmp);
+				return false;
+			}
+		}
+
+		auto err = std::error_code{};
+		fs::rename(tmp, path, err);
+		if (err)
+			SAGE_LOG_WARN("Cannot write snapshot {}: {}", path, err.message());
+		return not err;
+	}
+};
+
+}// sage::ecs::snapshot
+
+#ifdef SAGE_TEST_ECS_SNAPSHOT
+namespace {
+
+using namespace sage;
+
+struct Physics {
+	glm::vec2 velocity;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Physics);
+};
+
+struct Rare {
+	using Storage = component::storage::Sparse;
+
+	int value;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Rare);
+};
+
+struct Position {
+	using Storage = component::storage::Archetype;
+
+	glm::vec3 position;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Position);
+};
+
+struct Sprite {
+	using Storage = component::storage::Archetype;
+
+	glm::vec4 color;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Sprite);
+};
+
+using ECS = Basic_ECS<component::Name, Physics, Rare, Position, Sprite>;
+
+// A mix of all storages, with holes in the slots
+auto populate(ECS& ecs, const size_t n) -> void {
+	auto entities = std::vector<ECS::Entity>{};
+	entities.reserve(n);
+
+	for (const auto i : vw::iota(0ul, n)) {
+		auto entt = ecs.create();
+		const auto x = static_cast<float>(i);
+
+		entt->set(component::Name{fmt::format("Entity {}", i)}, Physics{{x, -x}}, Position{{x, x, x}});
+		if (i % 3 == 0)
+			entt->set(Sprite{{x, 0, 0, 1}});
+		if (i % 10 == 0)
+			entt->set(Rare{static_cast<int>(i)});
+
+		entities.push_back(std::move(*entt));
+	}
+
+	for (auto i = 0ul; i < entities.size(); i += 7)
+		ecs.destroy(entities[i]);
+}
+
+auto check_same(ECS& a, ECS& b) -> void {
+	CHECK_EQ(a.size(), b.size());
+	CHECK_GE(b.capacity(), a.capacity());
+	CHECK_EQ(a.count<component::Name>(), b.count<component::Name>());
+	CHECK_EQ(a.count<Physics>(), b.count<Physics>());
+	CHECK_EQ(a.count<Rare>(), b.count<Rare>());
+	CHECK_EQ(a.count<Position>(), b.count<Position>());
+	CHECK_EQ(a.count<Sprite>(), b.count<Sprite>());
+
+	auto mismatches = 0ul;
+	for (auto&& [handle, name] : a.view<const component::Name>()) {
+		const auto x = ECS::Entity{handle, &a};
+		const auto y = ECS::Entity{handle, &b};
+
+		if (not b.is_valid(y) or a.signature(handle) != b.signature(handle)) {
+			++mismatches;
+			continue;
+		}
+
+		const auto [xn, xp, xr, xpos, xs] = *a.components_of<const component::Name, const Physics, const Rare, const Position, const Sprite>(x);
+		const auto [yn, yp, yr, ypos, ys] = *b.components_of<const component::Name, const Physics, const Rare, const Position, const Sprite>(y);
+
+		const auto same = [] (const auto* l, const auto* r, auto&& eq) {
+				return (l == nullptr) == (r == nullptr) and (l == nullptr or eq(*l, *r));
+			};
+
+		if (not same(xn, yn, [] (auto& l, auto& r) { return l.view() == r.view(); })
+			or not same(xp, yp, [] (auto& l, auto& r) { return l.velocity == r.velocity; })
+			or not same(xr, yr, [] (auto& l, auto& r) { return l.value == r.value; })
+			or not same(xpos, ypos, [] (auto& l, auto& r) { return l.position == r.position; })
+			or not same(xs, ys, [] (auto& l, auto& r) { return l.color == r.color; })
+			or (not name.is_default() and b.find_named(name.view()) != handle))	// The index is rebuilt
+		{
+			++mismatches;
+		}
+	}
+	CHECK_EQ(mismatches, 0);
+
+	// Same free list
+	const auto next_a = a.create(),
+			   next_b = b.create();
+	CHECK_EQ(next_a->handle(), next_b->handle());
+}
+
+TEST_CASE ("ECS snapshot round trip") {
+	auto ecs = ECS{16};
+	populate(ecs, 1000);
+
+	const auto bytes = snapshot::save(ecs);
+	CHECK_EQ(reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(std::max_align_t), 0);
+
+	auto loaded = ECS{16};
+	populate(loaded, 10);	// Replaced by the snapshot
+	CHECK(snapshot::load(loaded, bytes));
+	check_same(ecs, loaded);
+
+	// Loading into a bigger ECS keeps its extra slots
+	auto bigger = ECS{4096};
+	CHECK(snapshot::load(bigger, bytes));
+	CHECK_EQ(bigger.capacity(), 4096);
+	for ([[maybe_unused]] const auto _ : vw::iota(0ul, bigger.capacity() - bigger.size()))
+		CHECK(bigger.create().has_value());
+	CHECK(bigger.is_full() == (bigger.capacity() == bigger.max_capacity()));
+
+	// Loaded components are recent
+	CHECK_EQ(rg::distance(loaded.added<const Physics>(loaded.tick())), loaded.count<Physics>());
+
+	// Empty
+	auto empty = ECS{8};
+	auto copy = ECS{8};
+	populate(copy, 5);
+	CHECK(snapshot::load(copy, snapshot::save(empty)));
+	CHECK_EQ(copy.size(), 0);
+	CHECK(copy.create().has_value());
+}
+
+TEST_CASE ("ECS snapshot into another ECS") {
+	struct Extra {
+		int value;
+
+		SAGE_ECS_TYPE_NAME_GETTER(Extra);
+	};
+
+	auto ecs = ECS{16};
+	populate(ecs, 100);
+
+	// Only the components they have in common, in any order and storage
+	auto other = Basic_ECS<Extra, Sprite, Physics>{16};
+	CHECK(snapshot::load(other, snapshot::save(ecs)));
+	CHECK_EQ(other.size(), ecs.size());
+	CHECK_EQ(other.count<Physics>(), ecs.count<Physics>());
+	CHECK_EQ(other.count<Sprite>(), ecs.count<Sprite>());
+	CHECK_EQ(other.count<Extra>(), 0);
+
+	for (auto&& [handle, sprite, physics] : other.view<const Sprite, const Physics>()) {
+		CHECK_EQ(sprite.color.x, physics.velocity.x);
+		CHECK(ecs.is_valid(handle));
+	}
+}
+
+TEST_CASE ("ECS snapshot rejects") {
+	auto ecs = ECS{16};
+	populate(ecs, 100);
+	const auto bytes = snapshot::save(ecs);
+
+	auto target = ECS{16};
+	populate(target, 3);
+	const auto size = target.size();
+
+	const auto rejected = [&] (const std::span<const std::byte> snap) {
+			const auto ok = snapshot::load(target, snap);
+			CHECK_EQ(target.size(), size);	// Untouched
+			return not ok;
+		};
+
+	CHECK(rejected({}));
+	CHECK(rejected(std::span{bytes}.first(bytes.size() / 2)));
+	CHECK(rejected(std::span{bytes}.first(sizeof(snapshot::Header))));
+
+	auto bad_version = bytes;
+	bad_version[offsetof(snapshot::Header, version)] = std::byte{0xff};
+	CHECK(rejected(bad_version));
+
+	// A dead entity in a column
+	auto bad_entity = bytes;
+	const auto header = *reinterpret_cast<const snapshot::Header*>(bytes.data());
+	const auto column = *reinterpret_cast<const snapshot::Column*>(bytes.data() + header.columns);
+	std::memset(bad_entity.data() + column.entities, 0xff, sizeof(entity::Handle::Index));
+	CHECK(rejected(bad_entity));
+
+	// The same entity twice in a column
+	auto twice = bytes;
+	std::memcpy(twice.data() + column.entities, twice.data() + column.entities + sizeof(entity::Handle::Index), sizeof(entity::Handle::Index));
+	CHECK(rejected(twice));
+
+	// Sections are read in place
+	auto shifted = snapshot::Bytes(bytes.size() + 1);
+	std::memcpy(shifted.data() + 1, bytes.data(), bytes.size());
+	CHECK(rejected(std::span{shifted}.subspan(1)));
+
+	// Same name, other layout
+	struct Fat_Physics {
+		glm::vec4 velocity;
+
+		static constexpr auto type_name() -> std::string_view { return "Physics"; }
+	};
+	auto fat = Basic_ECS<Fat_Physics>{16};
+	CHECK_FALSE(snapshot::load(fat, bytes));
+	CHECK_EQ(fat.size(), 0);
+
+	// Too many entities
+	auto small = ECS{4, 4};
+	CHECK_FALSE(snapshot::load(small, bytes));
+	CHECK_EQ(small.size(), 0);
+}
+
+TEST_CASE ("ECS snapshot file") {
+	auto ecs = ECS{16};
+	populate(ecs, 1000);
+
+	const auto path = fs::temp_directory_path() / fmt::format("sage_test_{}.snapshot", ::getpid());
+
+	{
+		auto writer = snapshot::Writer{path, snapshot::save(ecs)};
+		CHECK(writer.wait());
+		CHECK(writer.is_done());
+	}
+	CHECK(fs::exists(path));
+	CHECK_FALSE(fs::exists(fs::path{path} += ".tmp"));
+
+	auto loaded = ECS{16};
+	CHECK(snapshot::load(loaded, path));
+	check_same(ecs, loaded);
+
+	fs::remove(path);
+	CHECK_FALSE(snapshot::load(loaded, path));
+}
+
+TEST_CASE ("ECS snapshot benchmark") {
+	using Clock = std::chrono::steady_clock;
+
+#ifdef SAGE_BENCH
+	constexpr auto sizes = std::array{ 10'000ul, 100'000ul, 1'000'000ul };
+#else
+	constexpr auto sizes = std::array{ 10'000ul };
+#endif
+
+	const auto path = fs::temp_directory_path() / fmt::format("sage_bench_{}.snapshot", ::getpid());
+
+	for (const auto n : sizes) {
+		auto ecs = ECS{n};
+		populate(ecs, n);
+
+		const auto t0 = Clock::now();
+		auto bytes = snapshot::save(ecs);
+		const auto t1 = Clock::now();
+
+		const auto mb = static_cast<double>(bytes.size()) / (1 << 20);
+		auto writer = snapshot::Writer{path, std::move(bytes)};
+		CHECK(writer.wait());
+
+		auto loaded = ECS{n};
+		const auto t2 = Clock::now();
+		CHECK(snapshot::load(loaded, path));
+		const auto t3 = Clock::now();
+
+		CHECK_EQ(loaded.size(), ecs.size());
+
+		MESSAGE(fmt::format("Snapshot of {} entities, {:.1f}MiB: save {}µs load {}µs",
+				n,
+				mb,
+				std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count(),
+				std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count()
+			));
+	}
+
+	fs::remove(path);
+}
+
+}
+#endif
@@ -0,0 +1,501 @@
+#pragma once
+
+#include "src/std.hpp"
+
+#include "src/ecs.hpp"
+#include "src/job.hpp"
+
+namespace sage::inline ecs {
+
+// Uniform hash grid over the xy positions of the entities with a C, for proximity queries.
+//
+// auto grid = Spatial_Grid<ECS>{{ .cell_size = 2 }};
+// ...
+// grid.update(ecs);	// Once per frame, after the positions are written
+// for (const auto handle : grid.in_rect(camera_min, camera_max))
+//     ...
+//
+// Space is split into square cells that are hashed into a fixed number of buckets, so the grid is
+// unbounded and its memory does not depend on the extent of the world. Pick the cell size close to
+// the usual query radius: smaller cells mean more buckets visited, larger more entries filtered.
+//
+// update() only moves the entities whose C changed since the previous update (see
+// Basic_ECS::changed()). The grid is rebuilt, spread over a job::Pool, when entities gain or lose a C.
+//
+// Queries return what the grid saw at the last update, in no particular order.
+template <typename ECS, typename C = component::Position>
+	requires ECS::template is_component<C>
+		and (requires (const C& c) { c.position.x; } or requires (const C& c) { c.trans[3].x; })
+struct Spatial_Grid {
+	static constexpr auto null = std::numeric_limits<uint32_t>::max();
+
+	struct Spec {
+		float cell_size = 1;
+		size_t buckets = 1ul << 14;	// Power of 2
+	};
+
+	struct Entry {
+		glm::vec2 position;
+		entity::Handle handle;
+	};
+
+private:
+	struct Cell {
+		int32_t x, y;
+
+		auto operator==(const Cell&) const -> bool = default;
+	};
+
+	struct Location {
+		uint32_t bucket = null;
+		uint32_t slot = null;
+	};
+
+	float cell_size;
+	std::vector<std::vector<Entry>> buckets;
+	std::vector<Location> locations;	// Per entity index
+
+	size_t _size = 0;
+	size_t _moved = 0;
+	component::storage::Tick since = 0;
+
+public:
+	explicit Spatial_Grid(const Spec& spec = {})
+		: cell_size{spec.cell_size}
+		, buckets(spec.buckets)
+	{
+		SAGE_ASSERT(cell_size > 0, "Cell size must be positive, got {}", cell_size);
+		SAGE_ASSERT(std::has_single_bit(spec.buckets), "Buckets must be a power of 2, got {}", spec.buckets);
+	}
+
+public:
+	auto update(ECS& ecs, const Parallel& parallel = {}) -> void {
+		const auto is_stale =
+				_size != ecs.template count<C>()
+			or locations.size() != ecs.capacity()
+			or not ecs.template added<const C>(since).empty()
+			;
+
+		if (is_stale)
+			rebuild(ecs, parallel);
+		else
+			move(ecs);
+
+		since = ecs.advance_tick();
+	}
+
+	auto size() const -> size_t {
+		return _size;
+	}
+
+	// Entries written by the last update, all of them if it rebuilt
+	auto moved() const -> size_t {
+		return _moved;
+	}
+
+	// Call fn(entry) for the entities with min <= position <= max
+	auto for_each_in_rect(const glm::vec2 min, const glm::vec2 max, std::invocable<const Entry&> auto&& fn) const -> void {
+		if (min.x > max.x or min.y > max.y)
+			return;
+
+		const auto first = cell_of(min),
+				   last = cell_of(max);
+		const auto contains = [&] (const glm::vec2 p) {
+				return min.x <= p.x and p.x <= max.x and min.y <= p.y and p.y <= max.y;
+			};
+
+		// A big rect is cheaper to answer by walking every bucket once
+		const auto cells = (static_cast<double>(last.x) - first.x + 1) * (static_cast<double>(last.y) - first.y + 1);
+		if (cells >= static_cast<double>(buckets.size())) {
+			for (const auto& bucket : buckets)
+				for (const auto& entry : bucket)
+					if (contains(entry.position))
+						std::invoke(fn, entry);
+			return;
+		}
+
+		// Different cells can share a bucket, only take the entries of the cell being visited
+		for (auto y = first.y; y <= last.y; ++y)
+			for (auto x = first.x; x <= last.x; ++x)
+				for (const auto cell = Cell{x, y}; const auto& entry : buckets[bucket_of(cell)])
+					if (cell_of(entry.position) == cell and contains(entry.position))
+						std::invoke(fn, entry);
+	}
+
+	auto in_rect(const glm::vec2 min, const glm::vec2 max) const -> std::vector<entity::Handle> {
+		auto handles = std::vector<entity::Handle>{};
+		for_each_in_rect(min, max, [&] (const Entry& e) { handles.push_back(e.handle); });
+		return handles;
+	}
+
+	// Call fn(entry) for the entities at most radius away from center
+	auto for_each_in_radius(const glm::vec2 center, const float radius, std::invocable<const Entry&> auto&& fn) const -> void {
+		const auto r = glm::vec2{radius, radius};
+		for_each_in_rect(center - r, center + r, [&] (const Entry& e) {
+				if (distance_squared(e.position, center) <= radius * radius)
+					std::invoke(fn, e);
+			});
+	}
+
+	auto in_radius(const glm::vec2 center, const float radius) const -> std::vector<entity::Handle> {
+		auto handles = std::vector<entity::Handle>{};
+		for_each_in_radius(center, radius, [&] (const Entry& e) { handles.push_back(e.handle); });
+		return handles;
+	}
+
+	// Closest entity at most max_distance away from point, ties are broken arbitrarily
+	auto nearest(const glm::vec2 point, const float max_distance = std::numeric_limits<float>::infinity()) const -> std::optional<entity::Handle> {
+		auto best = std::optional<entity::Handle>{};
+		auto best_distance = max_distance * max_distance;
+		const auto consider = [&] (const Entry& e) {
+				if (const auto d = distance_squared(e.position, point); d <= best_distance) {
+					best = e.handle;
+					best_distance = d;
+				}
+			};
+
+		if (_size == 0)
+			return best;
+
+		const auto center = cell_of(point);
+		const auto max_rings = static_cast<double>(max_distance / cell_size) + 1;	// Infinite without a max_distance
+
+		// Rings of cells around the cell of point until they are farther than the best so far.
+		// Once the rings have visited as many cells as there are buckets, walk the buckets instead.
+		auto visited = 0ul;
+		for (auto ring = 0; ring <= max_rings; ++ring) {
+			// Anything in this ring or beyond is at least (ring - 1) cells away
+			if (best.has_value() and ring > 0) {
+				const auto reach = static_cast<float>(ring - 1) * cell_size;
+				if (reach * reach > best_distance)
+					break;
+			}
+
+			if (visited >= buckets.size()) {
+				for (const auto& bucket : buckets)
+					for (const auto& entry : bucket)
+						consider(entry);
+				break;
+			}
+			visited += ring == 0 ? 1 : 8 * static_cast<size_t>(ring);
+
+			const auto visit = [&] (const Cell cell) {
+					for (const auto& entry : buckets[bucket_of(cell)])
+						if (cell_of(entry.position) == cell)
+							consider(entry);
+				};
+
+			if (ring == 0) {
+				visit(center);
+				continue;
+			}
+			for (auto i = -ring; i <= ring; ++i) {
+				visit({center.x + i, center.y - ring});
+				visit({center.x + i, center.y + ring});
+			}
+			for (auto i = -ring + 1; i <= ring - 1; ++i) {
+				visit({center.x - ring, center.y + i});
+				visit({center.x + ring, center.y + i});
+			}
+		}
+
+		return best;
+	}
+
+private:
+	static auto position_of(const C& c) -> glm::vec2 {
+		if constexpr (requires { c.position.x; })
+			return { c.position.x, c.position.y };
+		else
+			return { c.trans[3].x, c.trans[3].y };
+	}
+
+	static auto distance_squared(const glm::vec2 a, const glm::vec2 b) -> float {
+		const auto d = a - b;
+		return d.x * d.x + d.y * d.y;
+	}
+
+	auto cell_of(const glm::vec2 p) const -> Cell {
+		return {
+			static_cast<int32_t>(std::floor(p.x / cell_size)),
+			static_cast<int32_t>(std::floor(p.y / cell_size)),
+		};
+	}
+
+	auto bucket_of(const Cell cell) const -> uint32_t {
+		const auto h = (static_cast<uint32_t>(cell.x) * 73'856'093u) ^ (static_cast<uint32_t>(cell.y) * 19'349'663u);
+		return h & static_cast<uint32_t>(buckets.size() - 1);
+	}
+
+	// Only the entities that moved, an entity that stays in its cell is updated in place
+	auto move(ECS& ecs) -> void {
+		_moved = 0;
+		for (auto&& [handle, c] : ecs.template changed<const C>(since)) {
+			auto& loc = locations[handle.index()];
+			const auto position = position_of(c);
+			const auto bucket = bucket_of(cell_of(position));
+			++_moved;
+
+			if (bucket == loc.bucket) {
+				buckets[bucket][loc.slot].position = position;
+				continue;
+			}
+
+			// Swap remove from the old bucket
+			auto& old = buckets[loc.bucket];
+			if (loc.slot != old.size() - 1) {
+				old[loc.slot] = old.back();
+				locations[old[loc.slot].handle.index()].slot = loc.slot;
+			}
+			old.pop_back();
+
+			loc = { bucket, static_cast<uint32_t>(buckets[bucket].size()) };
+			buckets[bucket].push_back({ position, handle });
+		}
+	}
+
+	// Hash every entity by its index, then fill disjoint ranges of buckets on the workers
+	auto rebuild(ECS& ecs, const Parallel& parallel) -> void {
+		_size = ecs.template count<C>();
+		_moved = _size;
+
+		auto entries = std::vector<Entry>(ecs.capacity());
+		locations.assign(ecs.capacity(), {});
+
+		ecs.template par_each<const C>([&] (const entity::Handle handle, const C& c) {
+				const auto position = position_of(c);
+				entries[handle.index()] = { position, handle };
+				locations[handle.index()].bucket = bucket_of(cell_of(position));
+			},
+			parallel
+		);
+
+		auto& pool = parallel.pool != nullptr ? *parallel.pool : job::Pool::shared();
+		const auto tasks = _size < parallel.serial_threshold ? 1ul : pool.concurrency();
+		const auto per_task = (buckets.size() + tasks - 1) / tasks;
+
+		pool.for_each_chunk(tasks, [&] (const size_t t) {
+				const auto first = static_cast<uint32_t>(t * per_task),
+						   last = static_cast<uint32_t>(std::min((t + 1) * per_task, buckets.size()));
+
+				for (const auto b : vw::iota(first, last))
+					buckets[b].clear();
+
+				for (const auto [i, loc] : locations | vw::enumerate)
+					if (first <= loc.bucket and loc.bucket < last) {
+						loc.slot = static_cast<uint32_t>(buckets[loc.bucket].size());
+						buckets[loc.bucket].push_back(entries[static_cast<size_t>(i)]);
+					}
+			});
+	}
+};
+
+}// sage::ecs
+
+#ifdef SAGE_TEST_ECS_SPATIAL
+namespace {
+
+using namespace sage;
+
+using ECS = Basic_ECS<component::Position, component::Transform>;
+using Grid = Spatial_Grid<ECS>;
+
+auto sorted(std::vector<entity::Handle> handles) -> std::vector<entity::Handle> {
+	rg::sort(handles, {}, &entity::Handle::raw);
+	return handles;
+}
+
+TEST_CASE ("Spatial grid queries") {
+	auto ecs = ECS{16};
+	// Few buckets so that cells collide
+	auto grid = Grid{{ .cell_size = 1, .buckets = 4 }};
+
+	auto a = *ecs.create(),
+		 b = *ecs.create(),
+		 c = *ecs.create(),
+		 d = *ecs.create(),
+		 no_position = *ecs.create();
+
+	a.set(component::Position{{0.5, 0.5, 0}});
+	b.set(component::Position{{2.5, 0.5, 0}});
+	c.set(component::Position{{-3.5, -3.5, 0}});
+	d.set(component::Position{{10, 10, 0}});
+	no_position.set(component::Transform{});
+
+	grid.update(ecs);
+	CHECK_EQ(grid.size(), 4);
+	CHECK_EQ(grid.moved(), 4);
+
+	CHECK_EQ(grid.in_rect({0, 0}, {1, 1}), std::vector{a.handle()});
+	CHECK_EQ(sorted(grid.in_rect({0, 0}, {3, 1})), sorted({a.handle(), b.handle()}));
+	CHECK_EQ(sorted(grid.in_rect({-100, -100}, {100, 100})), sorted({a.handle(), b.handle(), c.handle(), d.handle()}));
+	CHECK(grid.in_rect({1, 1}, {0, 0}).empty());
+
+	CHECK_EQ(grid.in_radius({0.5, 0.5}, 1), std::vector{a.handle()});
+	CHECK_EQ(sorted(grid.in_radius({1.5, 0.5}, 1)), sorted({a.handle(), b.handle()}));
+	CHECK(grid.in_radius({5, 5}, 1).empty());
+
+	CHECK_EQ(grid.nearest({2, 0}), b.handle());
+	CHECK_EQ(grid.nearest({-1, -1}, 3), a.handle());
+	CHECK_EQ(grid.nearest({-3, -3}, 1), c.handle());
+	CHECK_FALSE(grid.nearest({5, -5}, 1).has_value());
+
+	// Nothing changed, reading does not count
+	CHECK(ecs.components_of<const component::Position>(a).has_value());
+	grid.update(ecs);
+	CHECK_EQ(grid.moved(), 0);
+
+	// Within the cell and across cells
+	std::get<0>(*ecs.components_of<component::Position>(a))->position = {0.75, 0.75, 0};
+	b.set(component::Position{{-3, -3, 0}});
+	grid.update(ecs);
+	CHECK_EQ(grid.moved(), 2);
+	CHECK_EQ(grid.in_rect({0, 0}, {1, 1}), std::vector{a.handle()});
+	CHECK_EQ(sorted(grid.in_rect({-4, -4}, {-2, -2})), sorted({b.handle(), c.handle()}));
+	CHECK(grid.in_rect({2, 0}, {3, 1}).empty());
+
+	// Added and removed
+	ecs.destroy(d);
+	b.remove<component::Position>();
+	no_position.set(component::Position{{20, 20, 0}});
+	grid.update(ecs);
+	CHECK_EQ(grid.size(), 3);
+	CHECK_EQ(grid.nearest({15, 15}), no_position.handle());
+	CHECK_EQ(grid.in_rect({-4, -4}, {-2, -2}), std::vector{c.handle()});
+}
+
+TEST_CASE ("Spatial grid of transforms") {
+	using Transforms = Spatial_Grid<ECS, component::Transform>;
+
+	auto ecs = ECS{4};
+	auto grid = Transforms{{ .cell_size = 4 }};
+
+	auto entt = *ecs.create();
+	entt.set(component::Transform{ .trans = glm::translate(math::identity<glm::mat4>, {6, 7, 0}) });
+
+	grid.update(ecs);
+	CHECK_EQ(grid.in_radius({6, 7}, 0.5), std::vector{entt.handle()});
+}
+
+TEST_CASE ("Spatial grid agrees with a scan") {
+	auto ecs = ECS{1024};
+	auto pool = job::Pool{3};
+	auto serial = Grid{{ .cell_size = 8, .buckets = 256 }},
+		 parallel = Grid{{ .cell_size = 8, .buckets = 256 }};
+
+	auto rng = std::mt19937{42};
+	auto coordinate = std::uniform_real_distribution<float>{-200, 200};
+	auto entities = std::vector<ECS::Entity>{};
+
+	const auto scatter = [&] {
+			for (auto& entt : entities)
+				entt.set(component::Position{{coordinate(rng), coordinate(rng), 0}});
+		};
+
+	const auto scan = [&] (const glm::vec2 center, const float radius) {
+			auto handles = std::vector<entity::Handle>{};
+			for (auto&& [handle, pos] : ecs.view<const component::Position>()) {
+				const auto d = glm::vec2{pos.position.x, pos.position.y} - center;
+				if (d.x * d.x + d.y * d.y <= radius * radius)
+					handles.push_back(handle);
+			}
+			return sorted(handles);
+		};
+
+	const auto check = [&] {
+			serial.update(ecs, { .serial_threshold = std::numeric_limits<size_t>::max() });
+			parallel.update(ecs, { .serial_threshold = 0, .pool = &pool });
+
+			auto mismatches = 0;
+			for ([[maybe_unused]] const auto _ : vw::iota(0, 100)) {
+				const auto center = glm::vec2{coordinate(rng), coordinate(rng)};
+				const auto radius = std::uniform_real_distribution<float>{0, 50}(rng);
+
+				const auto expected = scan(center, radius);
+				mismatches += sorted(serial.in_radius(center, radius)) != expected;
+				mismatches += sorted(parallel.in_radius(center, radius)) != expected;
+
+				const auto near = serial.nearest(center, radius);
+				mismatches += near.has_value() != not expected.empty();
+				if (near.has_value())
+					mismatches += rg::find(expected, *near) == expected.end();
+
+				// Without a max distance, however far the closest is
+				const auto far = center * 10.f;
+				const auto closest = serial.nearest(far);
+				auto expected_distance = std::numeric_limits<float>::infinity(),
+					 closest_distance = -1.f;
+				for (auto&& [handle, pos] : ecs.view<const component::Position>()) {
+					const auto d = glm::vec2{pos.position.x, pos.position.y} - far;
+					expected_distance = std::min(expected_distance, d.x * d.x + d.y * d.y);
+					if (closest == handle)
+						closest_distance = d.x * d.x + d.y * d.y;
+				}
+				mismatches += closest_distance != expected_distance;
+			}
+			CHECK_EQ(mismatches, 0);
+		};
+
+	for ([[maybe_unused]] const auto _ : vw::iota(0, 1000))
+		entities.push_back(*ecs.create());
+	scatter();
+	check();
+
+	// Incremental
+	scatter();
+	check();
+	CHECK_EQ(serial.moved(), 1000);
+}
+
+TEST_CASE ("Spatial grid benchmark") {
+#ifdef SAGE_BENCH
+	constexpr auto number_of_entities = 100'000ul,
+				   number_of_queries = 1'000ul;
+#else
+	constexpr auto number_of_entities = 2'000ul,
+				   number_of_queries = 20ul;
+#endif
+
+	auto ecs = ECS{number_of_entities};
+	auto grid = Grid{{ .cell_size = 16 }};
+
+	auto rng = std::mt19937{7};
+	auto coordinate = std::uniform_real_distribution<float>{-2000, 2000};
+	auto entities = std::vector<ECS::Entity>{};
+	for ([[maybe_unused]] const auto _ : vw::iota(0ul, number_of_entities)) {
+		entities.push_back(*ecs.create());
+		entities.back().set(component::Position{{coordinate(rng), coordinate(rng), 0}});
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	grid.update(ecs);
+	const auto rebuild = std::chrono::steady_clock::now() - begin;
+
+	for (auto i = 0ul; i < entities.size(); i += 10)
+		std::get<0>(*ecs.components_of<component::Position>(entities[i]))->position.x += 1;
+
+	begin = std::chrono::steady_clock::now();
+	grid.update(ecs);
+	const auto moved = std::chrono::steady_clock::now() - begin;
+
+	begin = std::chrono::steady_clock::now();
+	auto found = 0ul;
+	for ([[maybe_unused]] const auto _ : vw::iota(0ul, number_of_queries))
+		found += grid.in_radius({coordinate(rng), coordinate(rng)}, 32).size();
+	const auto queries = std::chrono::steady_clock::now() - begin;
+
+	CHECK_EQ(grid.moved(), number_of_entities / 10);
+	MESSAGE(fmt::format(
+			"{} entities: rebuild {}, update of {} moved {}, {} radius queries {} ({} found)",
+			number_of_entities,
+			std::chrono::duration_cast<std::chrono::microseconds>(rebuild),
+			grid.moved(),
+			std::chrono::duration_cast<std::chrono::microseconds>(moved),
+			number_of_queries,
+			std::chrono::duration_cast<std::chrono::microseconds>(queries),
+			found
+		));
+}
+
+}
+#endif
@@ -0,0 +1,463 @@
+#pragma once
+
+#include "src/std.hpp"
+
+#include "src/ecs.hpp"
+#include "src/job.hpp"
+#include "src/perf.hpp"
+
+namespace sage::inline ecs {
+
+// The components a system reads and writes, see System
+template <typename... Cs>
+struct Reads {};
+
+template <typename... Cs>
+struct Writes {};
+
+template <typename R = Reads<>, typename W = Writes<>>
+struct System;
+
+// Declares what a system touches so that the Scheduler can run it next to the systems it does not
+// conflict with:
+//
+// scheduler.add<System<Reads<Physics>, Writes<Position>>>("Movement", [] (auto& ctx) {
+//         for (auto&& [_, physics, position] : ctx.template view<const Physics, Position>())
+//             ...
+//     });
+//
+// The system is handed a Context that only lets it reach the declared components, const for the
+// Reads. Structural changes go through ctx.commands() and are applied at the next play_commands().
+template <typename... Rs, typename... Ws>
+	requires type::Unique<Rs..., Ws...>
+struct System<Reads<Rs...>, Writes<Ws...>> {
+	template <typename C>
+	static constexpr auto can_read = type::Any<std::remove_const_t<C>, Rs..., Ws...>;
+
+	template <typename C>
+	static constexpr auto can_access = std::is_const_v<C> ? can_read<C> : type::Any<C, Ws...>;
+
+	template <typename ECS>
+	static constexpr auto reads() -> ECS::Signature {
+		return ECS::template signature_of<Rs...>();
+	}
+
+	template <typename ECS>
+	static constexpr auto writes() -> ECS::Signature {
+		return ECS::template signature_of<Ws...>();
+	}
+
+	template <typename ECS>
+		requires (ECS::template is_component<Rs> and ...) and (ECS::template is_component<Ws> and ...)
+	struct Context {
+		using Tick = ECS::Tick;
+
+	private:
+		ECS& ecs;
+
+	public:
+		explicit Context(ECS& e)
+			: ecs{e}
+		{}
+
+	public:
+		template <typename... Cs>
+			requires (can_access<Cs> and ...)
+		auto view() -> decltype(auto) {
+			return ecs.template view<Cs...>();
+		}
+
+		template <typename C, typename... Cs>
+			requires can_access<C> and (can_access<Cs> and ...)
+		auto added(const Tick since) -> decltype(auto) {
+			return ecs.template added<C, Cs...>(since);
+		}
+
+		template <typename C, typename... Cs>
+			requires can_access<C> and (can_access<Cs> and ...)
+		auto changed(const Tick since) -> decltype(auto) {
+			return ecs.template changed<C, Cs...>(since);
+		}
+
+		template <typename... Cs>
+			requires (can_access<Cs> and ...)
+		auto par_each(auto&& fn, const Parallel& parallel = {}) -> void {
+			ecs.template par_each<Cs...>(std::forward<decltype(fn)>(fn), parallel);
+		}
+
+		template <typename... Cs, typename T, typename Reduce, typename Map>
+			requires (can_access<Cs> and ...)
+		auto par_reduce(T init, Reduce&& reduce, Map&& map, const Parallel& parallel = {}) -> T {
+			return ecs.template par_reduce<Cs...>(std::move(init), std::forward<Reduce>(reduce), std::forward<Map>(map), parallel);
+		}
+
+		template <typename... Cs>
+			requires (can_access<Cs> and ...)
+		auto components_of(const ECS::Entity& e) -> decltype(auto) {
+			return ecs.template components_of<Cs...>(e);
+		}
+
+		template <typename C>
+			requires can_read<C>
+		auto count() const -> size_t {
+			return ecs.template count<C>();
+		}
+
+		auto is_valid(const entity::Handle h) const -> bool {
+			return ecs.is_valid(h);
+		}
+
+		auto commands() -> ECS::Commands& {
+			return ecs.commands();
+		}
+
+		auto tick() const -> Tick {
+			return ecs.tick();
+		}
+	};
+};
+
+template <typename S>
+concept Is_System = requires {
+		S::template can_read<int>;
+	};
+
+// Runs systems on a job::Pool, each as soon as the systems it conflicts with are done.
+//
+// Two systems conflict if one writes a component the other reads or writes, or if either is
+// exclusive. Conflicting systems run in the order they were added, the rest in any order and
+// concurrently, so adding systems in the order the layers used to run them keeps the results.
+//
+// par_each and par_reduce inside a system are spread over the same pool, on the threads that are
+// not running a system.
+//
+// The names must outlive the Scheduler, they are handed to the Profiler as they are.
+template <typename ECS>
+struct Scheduler {
+	using Signature = ECS::Signature;
+	using Duration = Profiler::Duration;
+
+	struct Timing {
+		std::string_view name;
+		Duration duration;
+	};
+
+private:
+	struct Entry {
+		std::string_view name;
+		Signature reads, writes;
+		bool is_exclusive;
+		std::function<void(ECS&)> run;
+	};
+
+	std::vector<Entry> systems;
+
+	// The conflict DAG, edges go from the earlier system to the later
+	std::vector<std::vector<uint32_t>> successors;
+	std::vector<uint32_t> predecessors;
+
+	std::vector<Timing> _timings;
+
+public:
+	template <Is_System S>
+	auto add(const std::string_view name, std::invocable<typename S::template Context<ECS>&> auto&& fn) -> Scheduler& {
+		return add_entry({
+				.name = name,
+				.reads = S::template reads<ECS>(),
+				.writes = S::template writes<ECS>(),
+				.is_exclusive = false,
+				.run = [fn = std::forward<decltype(fn)>(fn)] (ECS& ecs) mutable {
+						auto ctx = typename S::template Context<ECS>{ecs};
+						std::invoke(fn, ctx);
+					},
+			});
+	}
+
+	// Gets the whole ECS and runs alone, e.g. to create and destroy entities
+	auto add_exclusive(const std::string_view name, std::invocable<ECS&> auto&& fn) -> Scheduler& {
+		return add_entry({
+				.name = name,
+				.reads = {},
+				.writes = {},
+				.is_exclusive = true,
+				.run = std::forward<decltype(fn)>(fn),
+			});
+	}
+
+	// Run every system once, the calling thread works too
+	auto run(ECS& ecs, const Parallel& parallel = {}) -> void {
+		const auto n = static_cast<uint32_t>(systems.size());
+		auto& pool = parallel.pool != nullptr ? *parallel.pool : job::Pool::shared();
+
+		const auto run_one = [&] (const uint32_t s) {
+				const auto begin = std::chrono::steady_clock::now();
+				systems[s].run(ecs);
+				_timings[s] = { systems[s].name, std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now() - begin) };
+			};
+
+		if (n < 2 or pool.concurrency() == 1) {
+			for (const auto s : vw::iota(0u, n))
+				run_one(s);
+			return;
+		}
+
+		auto m = std::mutex{};
+		auto remaining = predecessors;
+
+		// A batch of the ready systems, each system forks the successors it was the last to wait for.
+		// No thread is parked on the systems, the idle ones help with the batches inside them too.
+		const auto run_ready = [&] (const auto& self, const std::vector<uint32_t>& ready) -> void {
+				pool.for_each_chunk(ready.size(), [&] (const size_t i) {
+						const auto s = ready[i];
+						run_one(s);
+
+						auto next = std::vector<uint32_t>{};
+						{
+							LOCK_GUARD(m);
+							for (const auto successor : successors[s])
+								if (--remaining[successor] == 0)
+									next.push_back(successor);
+						}
+						self(self, next);
+					});
+			};
+
+		auto ready = std::vector<uint32_t>{};
+		for (const auto s : vw::iota(0u, n))
+			if (remaining[s] == 0)
+				ready.push_back(s);
+
+		run_ready(run_ready, ready);
+	}
+
+	// Same and hand the time of every system to the profiler
+	auto run(ECS& ecs, Profiler& profiler, const Parallel& parallel = {}) -> void {
+		run(ecs, parallel);
+		for (const auto& t : _timings)
+			profiler.record(t.name, t.duration);
+	}
+
+	// Of the last run, in the order the systems were added
+	auto timings() const -> std::span<const Timing> {
+		return _timings;
+	}
+
+	auto size() const -> size_t {
+		return systems.size();
+	}
+
+	// Whether system `later` waits for system `earlier`
+	auto depends_on(const size_t later, const size_t earlier) const -> bool {
+		SAGE_ASSERT(later < systems.size() and earlier < systems.size());
+		return earlier < later and rg::find(successors[earlier], static_cast<uint32_t>(later)) != successors[earlier].end();
+	}
+
+private:
+	auto add_entry(Entry&& entry) -> Scheduler& {
+		const auto s = static_cast<uint32_t>(systems.size());
+
+		successors.emplace_back();
+		predecessors.push_back(0);
+		for (const auto [earlier, other] : systems | vw::enumerate)
+			if (conflict(other, entry)) {
+				successors[static_cast<size_t>(earlier)].push_back(s);
+				++predecessors[s];
+			}
+
+		systems.push_back(std::move(entry));
+		_timings.resize(systems.size());
+		return *this;
+	}
+
+	static auto conflict(const Entry& a, const Entry& b) -> bool {
+		return a.is_exclusive
+			or b.is_exclusive
+			or (a.writes & (b.reads | b.writes)).any()
+			or (b.writes & a.reads).any()
+			;
+	}
+};
+
+}// sage::ecs
+
+#ifdef SAGE_TEST_ECS_SYSTEM
+namespace {
+
+using namespace sage;
+
+struct Position {
+	using Storage = component::storage::Archetype;
+
+	glm::vec3 position;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Position);
+};
+
+struct Physics {
+	using Storage = component::storage::Archetype;
+
+	glm::vec2 velocity;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Physics);
+};
+
+struct Sprite {
+	using Storage = component::storage::Dense;
+
+	glm::vec4 color;
+
+	SAGE_ECS_TYPE_NAME_GETTER(Sprite);
+};
+
+using ECS = Basic_ECS<Position, Physics, Sprite>;
+
+TEST_CASE ("System scheduler conflicts") {
+	auto scheduler = Scheduler<ECS>{};
+	const auto nothing = [] (auto&) {};
+
+	scheduler
+		.add<System<Reads<Physics>, Writes<Position>>>("Movement", nothing)	// 0
+		.add<System<Reads<Position>>>("Read position", nothing)				// 1
+		.add<System<Reads<>, Writes<Sprite>>>("Color", nothing)				// 2
+		.add<System<Reads<Physics, Sprite>>>("Read", nothing)				// 3
+		.add<System<Reads<Physics>>>("Read physics", nothing)				// 4
+		.add_exclusive("Spawn", [] (ECS&) {})								// 5
+		.add<System<Reads<Physics>>>("After spawn", nothing)				// 6
+		;
+
+	CHECK_EQ(scheduler.size(), 7);
+
+	CHECK(scheduler.depends_on(1, 0));			// Read after write
+	CHECK_FALSE(scheduler.depends_on(2, 0));	// Disjoint
+	CHECK_FALSE(scheduler.depends_on(2, 1));
+	CHECK(scheduler.depends_on(3, 2));
+	CHECK_FALSE(scheduler.depends_on(3, 0));	// Reads only
+	CHECK_FALSE(scheduler.depends_on(4, 0));
+	CHECK_FALSE(scheduler.depends_on(4, 3));
+
+	for (const auto s : vw::iota(0ul, 5ul))
+		CHECK(scheduler.depends_on(5, s));
+	CHECK(scheduler.depends_on(6, 5));
+	CHECK_FALSE(scheduler.depends_on(0, 1));	// Only later on earlier
+}
+
+TEST_CASE ("System scheduler runs") {
+	auto ecs = ECS{1000};
+	for (const auto i : vw::iota(0, 1000)) {
+		auto entt = *ecs.create();
+		entt.set(Position{}, Physics{{1, static_cast<float>(i)}}, Sprite{});
+	}
+
+	auto pool = job::Pool{3};
+	auto scheduler = Scheduler<ECS>{};
+
+	// The systems that conflict must not overlap
+	auto position_users = std::atomic<int>{0};
+	auto overlaps = std::atomic<int>{0};
+	const auto use_position = [&] {
+			if (position_users.fetch_add(1) != 0)
+				++overlaps;
+			std::this_thread::sleep_for(1ms);
+			position_users.fetch_sub(1);
+		};
+
+	// Two systems that do not conflict run at the same time: each waits a bit for the other
+	auto started = std::atomic<int>{0};
+	auto met = std::atomic<int>{0};
+	const auto meet = [&] {
+			started.fetch_add(1);
+			for (auto spins = 0; spins < 1000 and started.load() < 2; ++spins)
+				std::this_thread::sleep_for(100us);
+			if (started.load() >= 2)
+				met.fetch_add(1);
+		};
+
+	auto total_velocity = 0.f;
+	auto order = std::vector<std::string_view>{};
+	auto order_m = std::mutex{};
+	const auto log = [&] (const std::string_view name) {
+			LOCK_GUARD(order_m);
+			order.push_back(name);
+		};
+
+	scheduler
+		.add<System<Reads<Physics>, Writes<Position>>>("Movement", [&] (auto& ctx) {
+				use_position();
+				meet();
+				ctx.template par_each<const Physics, Position>([] (entity::Handle, const Physics& ph, Position& pos) {
+						pos.position += glm::vec3{ph.velocity, 0};
+					}, Parallel{ .serial_threshold = 0, .pool = &pool });
+				log("Movement");
+			})
+		.add<System<Reads<Physics>, Writes<Sprite>>>("Color", [&] (auto& ctx) {
+				meet();
+				for (auto&& [_, ph, sprite] : ctx.template view<const Physics, Sprite>())
+					sprite.color = glm::vec4{ph.velocity.y};
+				log("Color");
+			})
+		.add<System<Reads<Position>>>("Sum", [&] (auto& ctx) {
+				use_position();
+				total_velocity = ctx.template par_reduce<const Position>(0.f, std::plus{}, [] (entity::Handle, const Position& pos) {
+						return pos.position.y;
+					});
+				log("Sum");
+			})
+		.add_exclusive("Spawn", [&] (ECS& e) {
+				e.create()->set(Position{}, Physics{});
+				log("Spawn");
+			})
+		;
+
+	auto profiler = Profiler{{ .max_quads = 1 }};
+	scheduler.run(ecs, profiler, { .pool = &pool });
+
+	CHECK_EQ(overlaps.load(), 0);
+	CHECK_EQ(met.load(), 2);
+	CHECK_EQ(total_velocity, 999.f * 1000.f / 2.f);
+	CHECK_EQ(ecs.size(), 1001);
+
+	// Conflicting systems keep the order they were added in
+	const auto position_of = [&] (const std::string_view name) { return rg::find(order, name) - order.begin(); };
+	CHECK_LT(position_of("Movement"), position_of("Sum"));
+	CHECK_EQ(order.back(), "Spawn");
+
+	const auto results = profiler.consume_results().get<Profiler::Timer_Results>();
+	CHECK_EQ(results.size(), 4);
+	CHECK_EQ(results.front().name, "Movement");
+	CHECK_GE(results.front().result.duration, 1ms);
+	CHECK_EQ(scheduler.timings().size(), 4);
+
+	// Again, on a pool of one the systems run in order on the calling thread
+	auto single = job::Pool{0};
+	order.clear();
+	started = 2;
+	scheduler.run(ecs, { .pool = &single });
+	CHECK_EQ(order, std::vector<std::string_view>{"Movement", "Color", "Sum", "Spawn"});
+	CHECK_EQ(total_velocity, 2.f * 999.f * 1000.f / 2.f);
+}
+
+TEST_CASE ("System scheduler nested batches") {
+	auto ecs = ECS{16};
+	auto pool = job::Pool{3};
+	auto scheduler = Scheduler<ECS>{};
+
+	// The threads that are not running a system help with the batch inside one
+	auto m = std::mutex{};
+	auto threads = std::set<std::thread::id>{};
+	scheduler
+		.add<System<Reads<>, Writes<Position>>>("Nested", [&] (auto&) {
+				pool.for_each_chunk(16, [&] (const size_t) {
+						std::this_thread::sleep_for(2ms);
+						LOCK_GUARD(m);
+						threads.insert(std::this_thread::get_id());
+					});
+			})
+		.add<System<Reads<>, Writes<Sprite>>>("Short", [] (auto&) {})
+		;
+
+	scheduler.run(ecs, { .pool = &pool });
+	CHECK_GT(threads.size(), 1);
+}
+
+}
+#endif
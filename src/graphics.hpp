@@ -5,6 +5,8 @@
 #include "src/math.hpp"
 #include "src/util.hpp"
 #include "src/perf.hpp"
+#include "src/simd.hpp"
+#include "src/job.hpp"
 
 #include "src/camera.hpp"
 #include "src/repr.hpp"
@@ -265,6 +267,50 @@ public:
 	auto layout() -> const Layout& { return lay; }
 };
 
+// A quad drawn instanced: the corners of a unit quad are transformed on the GPU, a quarter of the
+// bytes of 4 Quad verteces. Fields must match the layout, see asset/shader/instanced.glsl
+struct Instance {
+	glm::vec4 axes;			// 2D linear part of the transform, the x axis in xy and the y axis in zw
+	glm::vec3 origin;		// Center of the quad
+	glm::vec4 color;
+	glm::vec4 coords;		// Texture coordinates of the bottom left (xy) and top right (zw) corners
+	float texture_index = 0;
+
+	static constexpr auto layout() -> Layout {
+		return Layout{{
+				buffer::Element{{ .name = "a_Axes",			.type = shader::data::Type::Float4	}},
+				buffer::Element{{ .name = "a_Origin",		.type = shader::data::Type::Float3	}},
+				buffer::Element{{ .name = "a_Color",		.type = shader::data::Type::Float4	}},
+				buffer::Element{{ .name = "a_TexCoords",	.type = shader::data::Type::Float4	}},
+				buffer::Element{{ .name = "a_TexIndex",		.type = shader::data::Type::Float	}},
+			}};
+	}
+};
+
+// Memory of a streaming vertex buffer that the CPU writes to directly, see Streaming
+struct Region {
+	std::span<std::byte> bytes;
+	size_t first_vertex;			// Of the region in the buffer, the base vertex of the draw call reading it
+	Profiler::Duration stalled;		// Waiting for the GPU to be done with the region
+};
+
+// A vertex buffer split in regions that are written in turn while the GPU reads the previous ones:
+//
+// auto region = vb.acquire_region();	// Blocks until the GPU is done with it
+// write(region.bytes); draw(region.first_vertex);
+// vb.release_region();					// After the draw call that reads it
+//
+// is_streaming() is false if the buffer could not be set up that way, verteces are uploaded as usual then.
+template <typename VB>
+concept Streaming =
+	Concept<VB>
+	and requires (VB vb, const VB cvb) {
+		{ cvb.is_streaming() } -> std::same_as<bool>;
+		{ vb.acquire_region() } -> std::same_as<Region>;
+		{ vb.release_region() } -> std::same_as<void>;
+	}
+	;
+
 }//buffer::vertex
 
 namespace index {
@@ -448,21 +494,30 @@ inline struct Null {
 } null;
 static_assert(Concept_2D<Null>);
 
-template<texture::Concept Texture>
+// Quads are written to the batch's own memory, or straight into the mapped memory of a streaming
+// vertex buffer given by write_to().
+//
+// A quad is 4 buffer::vertex::Quad verteces, or a single buffer::vertex::Instance.
+template<texture::Concept Texture, typename Vertex = buffer::vertex::Quad>
+	requires type::Any<Vertex, buffer::vertex::Quad, buffer::vertex::Instance>
 struct Batch {
-	using Vertices = std::vector<buffer::vertex::Quad>;
+	using Vertices = std::vector<Vertex>;
 	// TODO: Proper asset system and asset handles
 	using Texture_Slots = std::vector<const Texture*>;
 
 public:
+	static constexpr auto verteces_per_quad = std::same_as<Vertex, buffer::vertex::Instance> ? 1ul : 4ul;
 	static constexpr auto max_quads = 10'000;
-	static constexpr auto max_verteces = max_quads * 4;
+	static constexpr auto max_verteces = max_quads * verteces_per_quad;
 	static constexpr auto max_indeces = max_quads * 6;
 	// TODO: Query from GPU
 	static constexpr auto max_texture_slots = 32u;
 
 private:
-	Vertices _verteces;
+	Vertices own_verteces;
+	std::span<Vertex> target;	// own_verteces or a region of a vertex buffer
+	size_t _size;
+	size_t _first_vertex;
 	Texture_Slots _texture_slots;
 	size_t _indeces;
 
@@ -471,40 +526,79 @@ private:
 public:
 	struct Capacity_Args { size_t verteces, texture_slots; };
 	Batch(Capacity_Args&& caps)
+		: own_verteces(caps.verteces)
+		, target{own_verteces}
+		, _size{0}
+		, _first_vertex{0}
+		, _indeces{0}
 	{
-		_verteces.reserve(caps.verteces);
 		_texture_slots.reserve(caps.texture_slots);
 
 		_texture_slots.push_back(&default_texture);
 	}
 
+	Batch(Batch&&) = delete;	// target may point into own_verteces
+
 public:
 	// TODO: More type safety
 	auto push_texture(const Texture* tex) -> decltype(buffer::vertex::Quad::Texture::index) {
-		SAGE_ASSERT(_texture_slots.size() < _texture_slots.capacity(), "Pushing more than {} textures", _texture_slots.capacity());
-
-		const auto i = rg::find_if(
-				_texture_slots | vw::drop(1),	// Scan after default texture
-				[&] (const auto& x) { return *tex == *x; }
-			);
+		const auto i = std::distance(_texture_slots.cbegin(), find_texture(tex));
 
-		if (i == _texture_slots.end())
+		if (static_cast<size_t>(i) == _texture_slots.size()) {
+			SAGE_ASSERT(_texture_slots.size() < _texture_slots.capacity(), "Pushing more than {} textures", _texture_slots.capacity());
 			_texture_slots.push_back(tex);
+		}
+
+		return i;
+	}
 
-		return std::distance(_texture_slots.begin(), i);
+	// Whether push_texture() has a slot for it, flush otherwise
+	auto can_push_texture(const Texture* tex) const -> bool {
+		return _texture_slots.size() < _texture_slots.capacity() or find_texture(tex) != _texture_slots.end();
 	}
 
 	// TODO: Make a namespace for shapes
-	auto push_quad(std::array<buffer::vertex::Quad, 4>&& q) -> void {
-		SAGE_ASSERT(_verteces.size() < max_verteces);
+	auto push_quad(std::array<Vertex, verteces_per_quad>&& q) -> void {
+		SAGE_ASSERT(not is_full());
 
-		rg::move(std::move(q), std::back_inserter(_verteces));
+		rg::move(std::move(q), target.begin() + _size);
+		_size += q.size();
 		_indeces += 6;
 	}
 
+	// The memory of the next `quads` quads for the caller to fill, from many threads if they write to
+	// disjoint parts of it
+	auto claim(const size_t quads) -> std::span<Vertex> {
+		SAGE_ASSERT(quads <= room());
+
+		const auto verts = target.subspan(_size, quads * verteces_per_quad);
+		_size += verts.size();
+		_indeces += quads * 6;
+		return verts;
+	}
+
+	// Write the next quads to `bytes`, vertex `first_vertex` of the buffer they are in
+	auto write_to(const std::span<std::byte> bytes, const size_t first_vertex) -> void {
+		SAGE_ASSERT(verteces_are_empty(), "Flush before switching memory");
+		SAGE_ASSERT(reinterpret_cast<uintptr_t>(bytes.data()) % alignof(Vertex) == 0);
+
+		target = {
+			reinterpret_cast<Vertex*>(bytes.data()),
+			std::min(bytes.size() / sizeof(Vertex), own_verteces.size())
+		};
+		_first_vertex = first_vertex;
+	}
+
+	auto write_to_own() -> void {
+		SAGE_ASSERT(verteces_are_empty(), "Flush before switching memory");
+
+		target = own_verteces;
+		_first_vertex = 0;
+	}
+
 public:
 	auto clear_verteces() -> void {
-		_verteces.clear();
+		_size = 0;
 		_indeces = 0;
 	}
 
@@ -518,7 +612,16 @@ public:
 	}
 
 	auto verteces_are_empty() const -> bool {
-		return _verteces.empty();
+		return _size == 0;
+	}
+
+	auto is_full() const -> bool {
+		return _size + verteces_per_quad > target.size();
+	}
+
+	// Quads that still fit
+	auto room() const -> size_t {
+		return (target.size() - _size) / verteces_per_quad;
 	}
 
 	auto texture_slots_are_empty() const -> bool {
@@ -534,24 +637,370 @@ public:
 		return _indeces;
 	}
 
-	auto verteces() const -> const Vertices& {
-		return _verteces;
+	auto quads() const -> size_t {
+		return _size / verteces_per_quad;
+	}
+
+	auto verteces() const -> std::span<const Vertex> {
+		return target.first(_size);
 	}
 
 	auto verteces_as_bytes() const -> std::span<const std::byte> {
-		return std::as_bytes(std::span{_verteces});
+		return std::as_bytes(verteces());
+	}
+
+	// Of the quads in the vertex buffer, the base vertex (or base instance) of their draw call
+	auto first_vertex() const -> size_t {
+		return _first_vertex;
 	}
 
 	auto texture_slots() const -> const Texture_Slots& {
 		return _texture_slots;
 	}
+
+private:
+	auto find_texture(const Texture* tex) const -> typename Texture_Slots::const_iterator {
+		return rg::find_if(
+				_texture_slots | vw::drop(1),	// Scan after default texture
+				[&] (const auto& x) { return *tex == *x; }
+			);
+	}
+};
+
+// A sprite of draw_many, like draw()'s Simple_Args
+struct Sprite_Instance {
+	glm::vec3 position;
+	glm::vec2 size;
+	float rotation = 0.f;	// Degrees
+	glm::vec4 color = { 1.f, 1.f, 1.f, 1.f };
+};
+
+namespace detail {
+
+// The 2D linear part of a sprite's transform, as in buffer::vertex::Instance::axes
+inline auto sprite_axes(const glm::vec2& size, const float rotation) -> glm::vec4 {
+	const auto [sin, cos] = simd::sincos(glm::radians(rotation));
+	return { cos * size.x, sin * size.x, -sin * size.y, cos * size.y };
+}
+
+#if SAGE_SIMD_X86
+
+// Lanes hold one component of 4 sprites, transposed back into a glm::vec4 per sprite
+inline auto store_axes(__m128 ax, __m128 ay, __m128 bx, __m128 by, glm::vec4* axes) -> void {
+	_MM_TRANSPOSE4_PS(ax, ay, bx, by);
+	_mm_storeu_ps(&axes[0].x, ax);
+	_mm_storeu_ps(&axes[1].x, ay);
+	_mm_storeu_ps(&axes[2].x, bx);
+	_mm_storeu_ps(&axes[3].x, by);
+}
+
+inline auto sprite_axes_sse(const std::span<const Sprite_Instance> sprites, const std::span<glm::vec4> axes) -> size_t {
+	const auto to_radians = _mm_set1_ps(glm::radians(1.f));
+
+	auto i = 0ul;
+	for (; i + 4 <= sprites.size(); i += 4) {
+		const auto* s = sprites.data() + i;
+
+		const auto [sin, cos] = simd::sincos(_mm_mul_ps(
+				_mm_setr_ps(s[0].rotation, s[1].rotation, s[2].rotation, s[3].rotation),
+				to_radians
+			));
+		const auto w = _mm_setr_ps(s[0].size.x, s[1].size.x, s[2].size.x, s[3].size.x),
+				   h = _mm_setr_ps(s[0].size.y, s[1].size.y, s[2].size.y, s[3].size.y);
+
+		store_axes(
+				_mm_mul_ps(cos, w),
+				_mm_mul_ps(sin, w),
+				_mm_xor_ps(_mm_mul_ps(sin, h), _mm_set1_ps(-0.f)),
+				_mm_mul_ps(cos, h),
+				axes.data() + i
+			);
+	}
+	return i;
+}
+
+[[gnu::target("avx2")]]
+inline auto sprite_axes_avx2(const std::span<const Sprite_Instance> sprites, const std::span<glm::vec4> axes) -> size_t {
+	static_assert(sizeof(Sprite_Instance) % sizeof(float) == 0);
+
+	constexpr auto stride = static_cast<int>(sizeof(Sprite_Instance) / sizeof(float));
+	const auto lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	const auto to_radians = _mm256_set1_ps(glm::radians(1.f));
+
+	auto i = 0ul;
+	for (; i + 8 <= sprites.size(); i += 8) {
+		const auto* s = sprites.data() + i;
+
+		const auto [sin, cos] = simd::sincos(_mm256_mul_ps(_mm256_i32gather_ps(&s->rotation, lanes, sizeof(float)), to_radians));
+		const auto w = _mm256_i32gather_ps(&s->size.x, lanes, sizeof(float)),
+				   h = _mm256_i32gather_ps(&s->size.y, lanes, sizeof(float));
+
+		const auto ax = _mm256_mul_ps(cos, w),
+				   ay = _mm256_mul_ps(sin, w),
+				   bx = _mm256_xor_ps(_mm256_mul_ps(sin, h), _mm256_set1_ps(-0.f)),
+				   by = _mm256_mul_ps(cos, h);
+
+		store_axes(_mm256_castps256_ps128(ax), _mm256_castps256_ps128(ay), _mm256_castps256_ps128(bx), _mm256_castps256_ps128(by), axes.data() + i);
+		store_axes(_mm256_extractf128_ps(ax, 1), _mm256_extractf128_ps(ay, 1), _mm256_extractf128_ps(bx, 1), _mm256_extractf128_ps(by, 1), axes.data() + i + 4);
+	}
+	return i;
+}
+
+#endif
+
+// Axes of many sprites, 4 or 8 at a time with the instructions of `level`
+inline auto sprite_axes(const std::span<const Sprite_Instance> sprites, const std::span<glm::vec4> axes, const simd::Level level = simd::level()) -> void {
+	SAGE_ASSERT(axes.size() >= sprites.size());
+
+	auto done = 0ul;
+
+	#if SAGE_SIMD_X86
+	switch (level) {
+		case simd::Level::AVX2:	done = sprite_axes_avx2(sprites, axes);	break;
+		case simd::Level::SSE:	done = sprite_axes_sse(sprites, axes);	break;
+		default:				break;
+	}
+	#else
+	(void)level;
+	#endif
+
+	for (const auto i : vw::iota(done, sprites.size()))
+		axes[i] = sprite_axes(sprites[i].size, sprites[i].rotation);
+}
+
+}// renderer::detail
+
+// How Base_2D batches the quads of a scene
+enum class Order {
+	Sorted,		// By layer, depth and texture at the end of the scene, equal keys keep the submission order
+	Submission,	// As drawn, for blending that depends on it
+};
+
+// Quads recorded for a scene without the renderer, so that every thread (or layer, or ECS chunk) can fill
+// its own list concurrently. Only a compact Command and a sort key are recorded per quad, the renderer
+// generates the verteces once the scene is sorted, straight into the memory of the batch, see
+// Base_2D::submit():
+//
+// auto lists = std::vector<Renderer::Draw_List>(pool.concurrency());
+//
+// renderer.scene(camera, [&] {
+//   pool.for_each_chunk(lists.size(), [&] (const auto i) { tiles.render(lists[i], i); });
+//   for (auto& list : lists)
+//     renderer.submit(list);
+// });
+//
+// A list is used by one thread at a time, submitted lists are read and cleared at the end of the scene.
+// The textures and sub-textures drawn must live until then too.
+template <texture::Concept Texture, typename Vertex = buffer::vertex::Quad>
+struct Draw_List {
+	using Sub_Texture = texture::Sub_Texture<Texture>;
+
+	using Drawings = type::Set<Texture, Sub_Texture, glm::vec4>;
+
+	struct Simple_Args {
+		const glm::vec3& position;
+		const glm::vec2& size;
+		float rotation = 0.f;
+	};
+
+	using Draw_Args = type::Set<Simple_Args, glm::mat4>;
+
+	// A quad before its verteces are generated, see generate()
+	struct Command {
+		glm::vec4 axes;			// As in buffer::vertex::Instance
+		glm::vec4 color;
+		glm::vec3 origin;
+		const Texture* texture;		// nullptr for colors
+		const typename Sub_Texture::Coordinates* coords;	// Of a Sub_Texture, nullptr for the whole drawing
+	};
+
+	// Sort keys have the layer in the top 8 bits, then depth (back to front) in 32 and the texture in 24.
+	// Depth is above the texture: quads are only grouped by texture at equal depth, so draws that should
+	// share a batch share their depth too.
+	static constexpr auto texture_bits = 24;
+	static constexpr auto texture_mask = (uint64_t{1} << texture_bits) - 1;
+
+private:
+	std::vector<uint64_t> _keys;			// Of each command
+	std::vector<Command> _commands;
+	std::vector<const Texture*> _textures;	// Position + 1 is the texture of a sort key, 0 is for colors
+	uint8_t current_layer = 0;
+
+public:
+	// See Base_2D::draw()
+	template <typename Drawing, typename _Draw_Args>
+		requires
+				(Drawings::template contains<Drawing>())
+			and (Draw_Args::template contains<_Draw_Args>())
+	auto draw(const Drawing& drawing, const _Draw_Args& args) -> void {
+		record(command(drawing, args));
+	}
+
+	// See Base_2D::draw_many()
+	template <typename Drawing>
+		requires (Drawings::template contains<Drawing>())
+	auto draw_many(const Drawing& drawing, const std::span<const Sprite_Instance> sprites) -> void {
+		_keys.reserve(_keys.size() + sprites.size());
+		_commands.reserve(_commands.size() + sprites.size());
+
+		commands(drawing, sprites, [this] (const Command& c) {
+				record(c);
+			});
+	}
+
+	auto draw_many(const std::span<const Sprite_Instance> sprites) -> void {
+		draw_many(glm::vec4{ 1.f, 1.f, 1.f, 1.f }, sprites);
+	}
+
+	// Draws in higher layers are on top of lower ones regardless of depth
+	template <std::invocable Draws>
+	auto layer(const uint8_t l, Draws&& draws) -> void {
+		const auto previous = std::exchange(current_layer, l);
+		std::invoke(std::forward<Draws>(draws));
+		current_layer = previous;
+	}
+
+	auto clear() -> void {
+		_keys.clear();
+		_commands.clear();
+		_textures.clear();
+	}
+
+public:
+	auto size() const -> size_t {
+		return _commands.size();
+	}
+
+	auto empty() const -> bool {
+		return _commands.empty();
+	}
+
+	auto keys() const -> std::span<const uint64_t> {
+		return _keys;
+	}
+
+	auto commands() const -> std::span<const Command> {
+		return _commands;
+	}
+
+	auto textures() const -> std::span<const Texture* const> {
+		return _textures;
+	}
+
+public:
+	// The command of a drawing. Of a glm::mat4 only the 2D affine part is kept, see Base_2D::draw()
+	template <typename Drawing, typename _Draw_Args>
+	static auto command(const Drawing& drawing, const _Draw_Args& args) -> Command {
+		const auto [color, texture, coords] = attributes(drawing);
+
+		if constexpr (std::same_as<_Draw_Args, Simple_Args>)
+			// Straight from size and rotation, no 4x4 matrices for a 2D quad
+			return { .axes = detail::sprite_axes(args.size, args.rotation), .color = color, .origin = args.position, .texture = texture, .coords = coords };
+		else
+			return { .axes = { args[0].x, args[0].y, args[1].x, args[1].y }, .color = color, .origin = { args[3].x, args[3].y, args[3].z }, .texture = texture, .coords = coords };
+	}
+
+	// emit(command) of each sprite, their axes are computed 4 or 8 at a time with the widest instructions of the CPU
+	template <typename Drawing, typename Emit>
+	static auto commands(const Drawing& drawing, const std::span<const Sprite_Instance> sprites, Emit&& emit) -> void {
+		const auto [color, texture, coords] = attributes(drawing);
+
+		auto axes = std::array<glm::vec4, 256>{};
+		for (auto first = 0ul; first < sprites.size(); first += axes.size()) {
+			const auto block = sprites.subspan(first, std::min(axes.size(), sprites.size() - first));
+			detail::sprite_axes(block, axes);
+
+			for (const auto i : vw::iota(0ul, block.size()))
+				emit(Command{ .axes = axes[i], .color = color * block[i].color, .origin = block[i].position, .texture = texture, .coords = coords });
+		}
+	}
+
+	// The verteces of a command to `target`, a quad centered at the origin spanned by the x (axes.xy) and
+	// y (axes.zw) axes. The corners are computed here for buffer::vertex::Quad and on the GPU for
+	// buffer::vertex::Instance.
+	static auto generate(const Command& c, const float texture_index, const std::span<Vertex> target) -> void {
+		constexpr auto full_drawing_coords = typename Sub_Texture::Coordinates{ glm::vec2{0.f,0.f}, glm::vec2{1.f,0.f}, glm::vec2{1.f,1.f}, glm::vec2{0.f,1.f} };
+
+		SAGE_ASSERT((target.size() == Batch<Texture, Vertex>::verteces_per_quad));
+
+		const auto& coords = c.coords != nullptr ? *c.coords : full_drawing_coords;
+
+		if constexpr (std::same_as<Vertex, buffer::vertex::Instance>)
+			target[0] = {
+				.axes = c.axes,
+				.origin = c.origin,
+				.color = c.color,
+				.coords = { coords[0].x, coords[0].y, coords[2].x, coords[2].y },	// Bottom left, top right
+				.texture_index = texture_index,
+			};
+		else {
+			constexpr auto corners = std::array{ glm::vec2{-0.5f,-0.5f}, glm::vec2{0.5f,-0.5f}, glm::vec2{0.5f,0.5f}, glm::vec2{-0.5f,0.5f} };
+
+			for (const auto vertex : vw::iota(0ul, corners.size()))
+				target[vertex] = {
+						.position = {
+							c.origin.x + corners[vertex].x * c.axes.x + corners[vertex].y * c.axes.z,
+							c.origin.y + corners[vertex].x * c.axes.y + corners[vertex].y * c.axes.w,
+							c.origin.z,
+						},
+						.color = c.color,
+						.texture = {
+							.coord = coords[vertex],
+							.index = texture_index,
+						},
+					};
+		}
+	}
+
+private:
+	// Color, texture (nullptr for colors) and texture coordinates (nullptr for the whole drawing)
+	template <typename Drawing>
+	static auto attributes(const Drawing& drawing) {
+		using Coordinates = const typename Sub_Texture::Coordinates*;
+		constexpr auto default_color = glm::vec4{ 1.f, 1.f, 1.f, 1.f };
+
+		if constexpr (std::same_as<Drawing, Texture>) {
+			return std::make_tuple(default_color, &drawing, Coordinates{nullptr});
+		}
+		else if constexpr (std::same_as<Drawing, Sub_Texture>) {
+			return std::make_tuple(default_color, &drawing.parent(), &drawing.coordinates());
+		}
+		else if constexpr (std::same_as<Drawing, glm::vec4>)
+			return std::make_tuple(drawing, static_cast<const Texture*>(nullptr), Coordinates{nullptr});
+		else
+			static_assert(false, "Unhandled type");
+	}
+
+	auto record(const Command& c) -> void {
+		// Flipping the sign bit of positive floats and every bit of negative ones orders them as unsigned ints
+		const auto bits = std::bit_cast<uint32_t>(c.origin.z);
+		const auto ordered = bits ^ ((bits >> 31) ? 0xffff'ffffu : 0x8000'0000u);
+
+		_keys.push_back(uint64_t{current_layer} << 56 | uint64_t{ordered} << texture_bits | texture_id(c.texture));
+		_commands.push_back(c);
+	}
+
+	// Textures are numbered in the order they are first drawn
+	auto texture_id(const Texture* texture) -> uint64_t {
+		if (texture == nullptr)
+			return 0;
+
+		const auto i = static_cast<size_t>(std::distance(_textures.begin(), rg::find(_textures, texture)));
+		if (i == _textures.size()) {
+			SAGE_ASSERT(i + 1 < texture_mask, "More textures in a list than fit in a sort key");
+			_textures.push_back(texture);
+		}
+
+		return i + 1;
+	}
 };
 
-template <typename _Vertex_Array, typename _Texture, typename Draw_Call, typename Clear_Call, typename _Frame_Buffer, typename _Shader>
+// Quads are drawn as 4 buffer::vertex::Quad verteces, or instanced as one buffer::vertex::Instance each
+template <typename _Vertex_Array, typename _Texture, typename Draw_Call, typename Clear_Call, typename _Frame_Buffer, typename _Shader, typename _Vertex = buffer::vertex::Quad>
 	requires
 			array::vertex::Concept<_Vertex_Array>
 		and texture::Concept<_Texture>
-		and std::invocable<Draw_Call, const Batch<_Texture>&>
+		and std::invocable<Draw_Call, const Batch<_Texture, _Vertex>&>
 		and std::invocable<Clear_Call>
 		and buffer::frame::Concept<_Frame_Buffer>
 		and shader::Concept<_Shader>
@@ -560,10 +1009,20 @@ protected:
 	using Vertex_Array = _Vertex_Array;
 	using Texture = _Texture;
 	using Sub_Texture = texture::Sub_Texture<Texture>;
-	using Batch = renderer::Batch<Texture>;
+	using Vertex = _Vertex;
+	using Batch = renderer::Batch<Texture, Vertex>;
 	using Frame_Buffer = _Frame_Buffer;
 	using Shader = _Shader;
 
+	// Batches are written straight into the vertex buffer instead of being uploaded on flush
+	static constexpr auto can_stream = buffer::vertex::Streaming<typename Vertex_Array::Vertex_Buffer>;
+
+	// Quads per chunk when generating the verteces of a sorted scene in parallel, see set_parallel()
+	static constexpr auto default_chunk_size = 2'048ul;
+
+public:
+	using Draw_List = renderer::Draw_List<Texture, Vertex>;
+
 protected:
 	struct Scene_Data {
 		Vertex_Array vertex_array;
@@ -585,6 +1044,25 @@ private:
 
 	Profiler& profiler;
 
+	Order _order = Order::Sorted;
+	job::Parallel parallel = { .serial_threshold = 8'192, .chunk_size = default_chunk_size };
+
+	// The renderer's own draws of a sorted scene, the first of the submitted lists
+	Draw_List list;
+	std::vector<Draw_List*> submitted;
+
+	// A quad of the submitted lists, the key has the texture numbered over all the lists
+	struct Entry {
+		uint64_t key;
+		uint32_t quad;
+		uint32_t list;
+	};
+
+	std::vector<Entry> entries, entries_scratch;
+	std::vector<const Texture*> scene_textures;
+	std::vector<uint64_t> texture_ids;		// Of a list's textures in scene_textures, see submit_queued()
+	std::vector<float> slots;				// Of each entry's texture in the batch
+
 protected:
 	Base_2D(Scene_Data&& sd, Profiler& prof = Profiler::global)
 		: scene_data{std::move(sd)}
@@ -627,8 +1105,16 @@ public:
 		scene_data.shader.bind();
 		scene_data.shader.set("u_ViewProjection", cam.projection);
 
+		open_batch();
+
+		if (_order == Order::Sorted)
+			submitted.push_back(&list);
+
 		std::invoke(std::forward<Draws>(draws));
 
+		if (_order == Order::Sorted)
+			submit_queued();
+
 		flush();
 
 		scene_data.frame_buffer.unbind();
@@ -636,15 +1122,36 @@ public:
 		scene_active = false;
 	}
 
-	using Drawings = type::Set<Texture, Sub_Texture, glm::vec4>;
+	auto order() const -> Order {
+		return _order;
+	}
 
-	struct Simple_Args {
-		const glm::vec3& position;
-		const glm::vec2& size;
-		float rotation = 0.f;
-	};
+	auto set_order(const Order o) -> void {
+		SAGE_ASSERT(not scene_active, "Order changes between scenes");
+		_order = o;
+	}
 
-	using Draw_Args = type::Set<Simple_Args, glm::mat4>;
+	// How the verteces of a sorted scene are generated over a job::Pool. serial_threshold counts the quads
+	// of a batch, a chunk_size of 0 picks 2'048 quads.
+	auto set_parallel(const job::Parallel& p) -> void {
+		parallel = p;
+	}
+
+	// Draws in higher layers are on top of lower ones regardless of depth, in sorted scenes
+	//
+	// renderer.scene(camera, [&] {
+	//   level.render();
+	//   renderer.layer(1, [&] { hud.render(); });
+	// });
+	template <std::invocable Draws>
+	auto layer(const uint8_t l, Draws&& draws) -> void {
+		SAGE_ASSERT(scene_active);
+		list.layer(l, std::forward<Draws>(draws));
+	}
+
+	using Drawings = typename Draw_List::Drawings;
+	using Simple_Args = typename Draw_List::Simple_Args;
+	using Draw_Args = typename Draw_List::Draw_Args;
 
 	// Drawing is drawn with its center at `args.position` expanding outward.
 	// Example (size width/height chose to make the code diagram legible)
@@ -662,71 +1169,72 @@ public:
 	//                |
 	//                V
 	//
+	// A glm::mat4 is used as a 2D affine transform, for both vertex types: the x and y axes of the quad
+	// are the xy of its first two columns and the center is its translation. Rotations out of the xy
+	// plane and scaling in z are dropped, every corner is at the z of the translation.
 	template <typename Drawing, typename _Draw_Args>
 		requires
 				(Drawings::template contains<Drawing>())
 			and (Draw_Args::template contains<_Draw_Args>())
 	auto draw(const Drawing& drawing, const _Draw_Args& args) {
-		using namespace sage::math;
-
 		SAGE_ASSERT(scene_active);
 
-		PROFILER_RENDERING(profiler, "Draw", [] (auto& result) { ++result.quads; });
+		PROFILER_RENDERING(profiler, "Draw", [] (auto& result) {
+				++result.quads;
+				result.vertex_bytes += Batch::verteces_per_quad * sizeof(Vertex);
+			});
 
-		if (batch.indeces() >= Batch::max_indeces)
-			flush();
+		if (_order == Order::Sorted)
+			list.draw(drawing, args);
+		else
+			push(Draw_List::command(drawing, args));
+	}
 
-		const auto transform = std::invoke([&] {
-				if constexpr (std::same_as<_Draw_Args, Simple_Args>)
-					return glm::translate(identity<glm::mat4>, args.position)
-						* glm::rotate(identity<glm::mat4>, glm::radians(args.rotation), { 0.f, 0.f, 1.f })
-						* glm::scale(identity<glm::mat4>, { args.size.x, args.size.y, 1.f })
-						;
-				else if constexpr (std::same_as<_Draw_Args, glm::mat4>)
-					return args;
-				else
-					static_assert(false);
+	// Draw many sprites of the same drawing tinted by their color, their transforms are computed 4 or 8
+	// at a time with the widest instructions of the CPU, see simd::level().
+	//
+	// particles.render(sprites);
+	// renderer.draw_many(texture, sprites);
+	template <typename Drawing>
+		requires (Drawings::template contains<Drawing>())
+	auto draw_many(const Drawing& drawing, const std::span<const Sprite_Instance> sprites) -> void {
+		SAGE_ASSERT(scene_active);
+
+		PROFILER_RENDERING(profiler, "Draw many", [n = sprites.size()] (auto& result) {
+				result.quads += n;
+				result.vertex_bytes += n * Batch::verteces_per_quad * sizeof(Vertex);
 			});
 
-		const auto verteces =
-			transform
-			* glm::mat4{
-				-0.5f, -0.5f, 0.0f, 1.0f,
-				 0.5f, -0.5f, 0.0f, 1.0f,
-				 0.5f,  0.5f, 0.0f, 1.0f,
-				-0.5f,  0.5f, 0.0f, 1.0f,
-			}
-			;
+		if (_order == Order::Sorted)
+			list.draw_many(drawing, sprites);
+		else
+			Draw_List::commands(drawing, sprites, [this] (const auto& c) {
+					push(c);
+				});
+	}
 
-		const auto [color, tex_index, coords] = std::invoke([&] {
-				constexpr auto full_drawing_coords = std::array{ glm::vec2{0.f,0.f}, glm::vec2{1.f,0.f}, glm::vec2{1.f,1.f}, glm::vec2{0.f,1.f} };
-				constexpr auto default_color = glm::vec4{ 1.f, 1.f, 1.f, 1.f };
+	auto draw_many(const std::span<const Sprite_Instance> sprites) -> void {
+		draw_many(glm::vec4{ 1.f, 1.f, 1.f, 1.f }, sprites);
+	}
 
-				if constexpr (std::same_as<Drawing, Texture>) {
-					return std::make_tuple(default_color, batch.push_texture(&drawing), full_drawing_coords);
-				}
-				else if constexpr (std::same_as<Drawing, Sub_Texture>) {
-					return std::make_tuple(default_color, batch.push_texture(&drawing.parent()), drawing.coordinates());
-				}
-				else if constexpr (std::same_as<Drawing, glm::vec4>)
-					return std::make_tuple(drawing, 0.f, full_drawing_coords);
-				else
-					static_assert(false, "Unhandled type");
-			});
+	// Draw the quads of a list recorded by another thread, on the thread of the scene. Sorted scenes
+	// merge the lists at their end, the list must live until then.
+	auto submit(Draw_List& l) -> void {
+		SAGE_ASSERT(scene_active);
+		SAGE_ASSERT(&l != &list);
 
-		SAGE_ASSERT(coords.size() == static_cast<size_t>(verteces.length()) and verteces.length() == 4);
+		PROFILER_RENDERING(profiler, "Submit", [n = l.size()] (auto& result) {
+				result.quads += n;
+				result.vertex_bytes += n * Batch::verteces_per_quad * sizeof(Vertex);
+			});
 
-		auto verts = std::array<buffer::vertex::Quad, verteces.length()>{};
-		for (const auto vertex : vw::iota(0ul, verts.size()))
-			verts[vertex] = {
-					.position = verteces[vertex],
-					.color = color,
-					.texture = {
-						.coord = coords[vertex],
-						.index = tex_index,
-					},
-				};
-		batch.push_quad(std::move(verts));
+		if (_order == Order::Sorted)
+			submitted.push_back(&l);
+		else {
+			for (const auto& c : l.commands())
+				push(c);
+			l.clear();
+		}
 	}
 
 public:
@@ -735,15 +1243,132 @@ public:
 	}
 
 private:
+	auto is_streaming() const -> bool {
+		if constexpr (can_stream)
+			return scene_data.vertex_array.vertex_buffer().is_streaming();
+		else
+			return false;
+	}
+
+	// Merge the submitted lists, sort them and batch them. The verteces of a batch are generated in
+	// parallel straight into its memory, the mapped region when streaming, each chunk to its own part of it.
+	auto submit_queued() -> void {
+		entries.clear();
+		scene_textures.clear();
+
+		for (const auto [l, submitted_list] : submitted | vw::enumerate) {
+			texture_ids.assign(1, 0);	// Colors
+			for (const auto* texture : submitted_list->textures()) {
+				const auto i = static_cast<size_t>(std::distance(scene_textures.begin(), rg::find(scene_textures, texture)));
+				if (i == scene_textures.size())
+					scene_textures.push_back(texture);
+				texture_ids.push_back(i + 1);
+			}
+
+			SAGE_ASSERT(scene_textures.size() < Draw_List::texture_mask, "More textures in a scene than fit in a sort key");
+
+			for (const auto [quad, key] : submitted_list->keys() | vw::enumerate)
+				entries.push_back({
+						.key = (key & ~Draw_List::texture_mask) | texture_ids[key & Draw_List::texture_mask],
+						.quad = static_cast<uint32_t>(quad),
+						.list = static_cast<uint32_t>(l),
+					});
+		}
+
+		radix_sort(entries, entries_scratch, [] (const Entry& e) { return e.key; });
+
+		slots.resize(entries.size());
+
+		auto first = 0ul;
+		while (first < entries.size()) {
+			// As many of the next quads as the batch has room and texture slots for
+			auto last = first;
+			const auto* texture = static_cast<const Texture*>(nullptr);
+			auto slot = 0.f;
+			for (; last < entries.size() and last - first < batch.room(); ++last) {
+				const auto* t = command_of(entries[last]).texture;
+				if (t != nullptr and t != texture) {
+					if (not batch.can_push_texture(t))
+						break;
+
+					texture = t;
+					slot = batch.push_texture(t);
+				}
+				slots[last] = t != nullptr ? slot : 0.f;
+			}
+
+			generate_to_batch(first, last, batch.claim(last - first));
+
+			if (last < entries.size()) {
+				flush();
+				open_batch();
+			}
+			first = last;
+		}
+
+		for (auto* submitted_list : submitted)
+			submitted_list->clear();
+		submitted.clear();
+	}
+
+	auto command_of(const Entry& e) const -> const typename Draw_List::Command& {
+		return submitted[e.list]->commands()[e.quad];
+	}
+
+	// The verteces of entries [first, last) to `target`, disjoint parts of it at once on parallel.pool
+	auto generate_to_batch(const size_t first, const size_t last, const std::span<Vertex> target) -> void {
+		const auto generate = [&] (const size_t from, const size_t to) {
+			for (const auto i : vw::iota(from, to))
+				Draw_List::generate(command_of(entries[i]), slots[i], target.subspan((i - first) * Batch::verteces_per_quad, Batch::verteces_per_quad));
+		};
+
+		const auto quads = last - first;
+		if (quads < parallel.serial_threshold) {
+			generate(first, last);
+			return;
+		}
+
+		const auto chunk = parallel.chunk_size > 0 ? parallel.chunk_size : default_chunk_size;
+		auto& pool = parallel.pool != nullptr ? *parallel.pool : job::Pool::shared();
+		pool.for_each_chunk((quads + chunk - 1) / chunk, [&] (const size_t c) {
+				generate(first + c * chunk, std::min(first + (c + 1) * chunk, last));
+			});
+	}
+
+	// Flushes first when the batch is out of verteces or texture slots
+	auto push(const typename Draw_List::Command& c) -> void {
+		if (batch.is_full() or (c.texture != nullptr and not batch.can_push_texture(c.texture))) {
+			flush();
+			open_batch();
+		}
+
+		const auto slot = c.texture != nullptr ? batch.push_texture(c.texture) : 0.f;
+		Draw_List::generate(c, slot, batch.claim(1));
+	}
+
+	// Point the batch to the next region of a streaming vertex buffer, every open_batch() is followed by a flush()
+	auto open_batch() -> void {
+		if constexpr (can_stream) {
+			if (not is_streaming())
+				return;
+
+			const auto region = scene_data.vertex_array.vertex_buffer().acquire_region();
+			batch.write_to(region.bytes, region.first_vertex);
+
+			PROFILER_RENDERING(profiler, "Stall", [&] (auto& result) { result.stalled += region.stalled; });
+		}
+	}
+
 	auto flush() -> void {
 		SAGE_ASSERT(scene_active);
 
 		PROFILER_RENDERING(profiler, "Flush", [] (auto& result) { ++result.draw_calls; });
 
 		scene_data.vertex_array.bind();
-		scene_data.vertex_array.vertex_buffer()
-			.set_verteces(batch.verteces_as_bytes())
-			;
+		if (not is_streaming())
+			scene_data.vertex_array.vertex_buffer()
+				.set_verteces(batch.verteces_as_bytes())
+				;
 
 		// Poor man's enumerate
 		rg::for_each(batch.texture_slots(), [i = 0ul] (const auto& tex) mutable {
@@ -752,7 +1377,11 @@ private:
 
 		std::invoke(draw_call, batch);
 
-		batch.clear_verteces();
+		if constexpr (can_stream)
+			if (is_streaming())
+				scene_data.vertex_array.vertex_buffer().release_region();
+
+		batch.clear();
 	}
 };
 
@@ -849,3 +1478,217 @@ FMT_FORMATTER(sage::graphics::shader::Source) {
 namespace sage::graphics::buffer {
 REPR_DEF_FMT(Element);
 }
+
+#ifdef SAGE_TEST_GRAPHICS
+namespace {
+
+using namespace sage;
+using namespace sage::graphics;
+
+struct Test_Texture {
+	int id = 0;	// The default texture of a batch is 0
+
+	Test_Texture(const int i) : id{i} {}
+	Test_Texture(const Size<size_t>&) {}
+
+	auto width() const -> size_t { return 1; }
+	auto height() const -> size_t { return 1; }
+	auto bind(const size_t) const -> void {}
+	auto unbind() const -> void {}
+	auto native_handle() const -> void* { return nullptr; }
+	auto operator== (const Test_Texture& other) const -> bool { return id == other.id; }
+};
+
+struct Test_Vertex_Buffer {
+	buffer::vertex::Vertices vert;
+	buffer::Layout lay = buffer::vertex::Quad::layout();
+
+	auto bind() -> void {}
+	auto unbind() -> void {}
+	auto verteces() -> const buffer::vertex::Vertices& { return vert; }
+	auto layout() -> const buffer::Layout& { return lay; }
+	auto set_verteces(const std::span<const std::byte>) -> void {}
+};
+
+struct Test_Vertex_Array : array::vertex::Null {
+	using Vertex_Buffer = Test_Vertex_Buffer;
+
+	Test_Vertex_Buffer vb;
+
+	auto vertex_buffer() -> Test_Vertex_Buffer& { return vb; }
+	auto vertex_buffer() const -> const Test_Vertex_Buffer& { return vb; }
+};
+
+// A quad as drawn: the center of its corners and the id of its texture
+struct Drawn {
+	float x, z;
+	int texture;
+
+	auto operator== (const Drawn&) const -> bool = default;
+};
+
+// Of each flush
+auto drawn = std::vector<std::vector<Drawn>>{};
+auto bound = std::vector<size_t>{};	// Texture slots
+
+using Test_Renderer_Base = renderer::Base_2D<
+		Test_Vertex_Array,
+		Test_Texture,
+		decltype([] (const auto& batch) {
+				const auto verteces = batch.verteces();
+				auto quads = std::vector<Drawn>{};
+				for (auto first = 0ul; first < verteces.size(); first += 4) {
+					const auto quad = verteces.subspan(first, 4);
+					quads.push_back({
+							.x = (quad[0].position.x + quad[2].position.x) / 2,
+							.z = quad[0].position.z,
+							.texture = batch.texture_slots()[static_cast<size_t>(quad[0].texture.index)]->id,
+						});
+				}
+				drawn.push_back(std::move(quads));
+				bound.push_back(batch.texture_slots().size());
+			}),
+		decltype([] {}),
+		buffer::frame::Null,
+		shader::Null
+	>;
+
+struct Test_Renderer : Test_Renderer_Base {
+	Test_Renderer()
+		: Test_Renderer_Base{{ .vertex_array = {}, .frame_buffer = {}, .shader = {} }}
+	{}
+};
+
+using Args = Test_Renderer::Simple_Args;
+
+const auto scene_camera = camera::Camera{};
+const auto size = glm::vec2{1, 1};
+
+TEST_CASE ("Renderer 2D texture slots") {
+	auto textures = std::vector<Test_Texture>{};
+	for (const auto i : vw::iota(1, 41))
+		textures.emplace_back(i);
+
+	auto renderer = Test_Renderer{};
+
+	for (const auto order : { renderer::Order::Sorted, renderer::Order::Submission }) {
+		drawn.clear();
+		bound.clear();
+
+		renderer.set_order(order);
+		renderer.scene(scene_camera, [&] {
+				for (const auto& texture : textures)
+					renderer.draw(texture, Args{ .position = {}, .size = size });
+			});
+
+		// The default texture and 31 others, then the other 9 in a second batch
+		CHECK_EQ(bound, std::vector<size_t>{ renderer::Batch<Test_Texture>::max_texture_slots, 10 });
+		CHECK_EQ(drawn[0].size() + drawn[1].size(), textures.size());
+	}
+}
+
+TEST_CASE ("Renderer 2D order") {
+	auto textures = std::vector<Test_Texture>{ 1, 2 };
+	auto renderer = Test_Renderer{};
+
+	// Each draw is told apart by its x
+	const auto draw = [&] {
+			const auto at = [] (const float x, const float z) { return glm::vec3{x, 0, z}; };
+
+			renderer.layer(1, [&] { renderer.draw(glm::vec4{1}, Args{ .position = at(1, -2), .size = size }); });
+			renderer.draw(textures[1], Args{ .position = at(2, 0), .size = size });
+			renderer.draw(textures[0], Args{ .position = at(3, 0), .size = size });
+			renderer.draw(glm::vec4{1}, Args{ .position = at(4, 0), .size = size });
+			renderer.draw(glm::vec4{1}, Args{ .position = at(5, 3), .size = size });
+			renderer.draw(glm::vec4{1}, Args{ .position = at(6, 0), .size = size });
+			renderer.draw(glm::vec4{1}, Args{ .position = at(7, 0.5f), .size = size });
+			renderer.draw(textures[1], Args{ .position = at(8, 0), .size = size });
+		};
+
+	const auto drawn_xs = [] {
+			REQUIRE_EQ(drawn.size(), 1);
+			auto xs = std::vector<float>{};
+			for (const auto& quad : drawn[0])
+				xs.push_back(quad.x);
+			return xs;
+		};
+
+	SUBCASE ("Sorted by layer, depth and texture, equal keys in submission order") {
+		drawn.clear();
+		renderer.scene(scene_camera, draw);
+
+		// Colors before the textures in the order they were first drawn, at each depth from back to front
+		CHECK_EQ(drawn_xs(), std::vector<float>{ 4, 6, 2, 8, 3, 7, 5, 1 });
+		CHECK_EQ(drawn[0][2].texture, 2);
+		CHECK_EQ(drawn[0][4].texture, 1);
+	}
+
+	SUBCASE ("Submission") {
+		drawn.clear();
+		renderer.set_order(renderer::Order::Submission);
+		renderer.scene(scene_camera, draw);
+
+		CHECK_EQ(drawn_xs(), std::vector<float>{ 1, 2, 3, 4, 5, 6, 7, 8 });
+	}
+}
+
+TEST_CASE ("Renderer 2D draw lists") {
+	auto textures = std::vector<Test_Texture>{};
+	for (const auto i : vw::iota(1, 41))
+		textures.emplace_back(i);
+
+	auto positions = std::vector<glm::vec3>{};
+	for (const auto i : vw::iota(0, 12'000))
+		positions.emplace_back(static_cast<float>(i), 0, static_cast<float>(i % 3));
+
+	const auto record = [&] (auto& target, const size_t first, const size_t last) {
+			for (const auto i : vw::iota(first, last))
+				target.draw(textures[i % textures.size()], Args{ .position = positions[i], .size = size, .rotation = 30.f });
+		};
+
+	auto renderer = Test_Renderer{};
+
+	drawn.clear();
+	renderer.scene(scene_camera, [&] { record(renderer, 0, positions.size()); });
+	const auto expected = drawn;
+
+	auto pool = job::Pool{3};
+	for (const auto serial_threshold : { std::numeric_limits<size_t>::max(), 0ul }) {
+		renderer.set_parallel({ .serial_threshold = serial_threshold, .chunk_size = 333, .pool = &pool });
+
+		auto lists = std::vector<Test_Renderer::Draw_List>(4);
+		const auto per_list = positions.size() / lists.size();
+
+		drawn.clear();
+		renderer.scene(scene_camera, [&] {
+				pool.for_each_chunk(lists.size(), [&] (const size_t l) { record(lists[l], l * per_list, (l + 1) * per_list); });
+				for (auto& list : lists)
+					renderer.submit(list);
+			});
+
+		CHECK_EQ(drawn, expected);
+		CHECK(rg::all_of(lists, &Test_Renderer::Draw_List::empty));
+	}
+}
+
+TEST_CASE ("Renderer 2D matrix and simple args") {
+	using namespace sage::math;
+
+	const auto position = glm::vec3{3, 4, 0.5f};
+	const auto scale = glm::vec2{2, 3};
+	const auto transform =
+		glm::translate(identity<glm::mat4>, position)
+		* glm::rotate(identity<glm::mat4>, glm::radians(30.f), { 0.f, 0.f, 1.f })
+		* glm::scale(identity<glm::mat4>, { scale.x, scale.y, 1.f })
+		;
+
+	const auto simple = Test_Renderer::Draw_List::command(glm::vec4{1}, Test_Renderer::Simple_Args{ .position = position, .size = scale, .rotation = 30.f });
+	const auto matrix = Test_Renderer::Draw_List::command(glm::vec4{1}, transform);
+
+	for (const auto i : vw::iota(0, 4))
+		CHECK_LT(std::abs(simple.axes[i] - matrix.axes[i]), 1e-5f);
+	CHECK_EQ(simple.origin, matrix.origin);
+}
+
+}
+#endif
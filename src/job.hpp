@@ -0,0 +1,234 @@
+#pragma once
+
+#include "src/std.hpp"
+#include "src/util.hpp"
+
+namespace sage::job {
+
+// A fixed set of worker threads that run batches of chunks.
+//
+// for_each_chunk(n, fn) calls fn(i) for every i in [0, n) spread over the workers and the calling
+// thread, and returns when all of them are done. Chunks are handed out through an atomic counter
+// so a slow chunk does not hold back the rest.
+//
+// Any number of batches can be open at once, from different threads or started from within a chunk,
+// e.g. a par_each inside a system. Idle workers join the newest one, and a thread that is done with
+// the chunks of its own batch runs chunks of the others while it waits for the last of its own.
+//
+// Nothing is allocated per batch, it lives on the stack of the caller and fn is passed by reference.
+struct Pool {
+private:
+	// Type erased pointer to the fn of a batch
+	struct Batch {
+		void (*call)(void*, size_t) = nullptr;
+		void* fn = nullptr;
+		size_t chunks = 0;
+		std::atomic<size_t> next = 0;
+		size_t users = 0;	// Threads in run_chunks, guarded by m
+	};
+
+	std::vector<std::jthread> workers;
+
+	std::mutex m;
+	std::condition_variable wake;	// A batch opened or lost its last user
+	std::vector<Batch*> open;		// That may have chunks left, newest last
+	bool stop = false;
+
+public:
+	// The calling thread also works so one less than the cores by default
+	explicit Pool(const size_t number_of_workers = std::max(1u, std::thread::hardware_concurrency()) - 1) {
+		workers.reserve(number_of_workers);
+		for (const auto i : vw::iota(0ul, number_of_workers))
+			workers.emplace_back([this, i] { work(i); });
+	}
+
+	Pool(const Pool&) = delete;
+	auto operator= (const Pool&) -> Pool& = delete;
+
+	~Pool() {
+		{
+			LOCK_GUARD(m);
+			stop = true;
+		}
+		wake.notify_all();
+		workers.clear();	// Join before the rest of the members go away
+	}
+
+public:
+	// Shared by the engine, created on first use
+	static auto shared() -> Pool& {
+		static auto pool = Pool{};
+		return pool;
+	}
+
+	// Threads that run the chunks of a batch, including the caller
+	auto concurrency() const -> size_t {
+		return workers.size() + 1;
+	}
+
+	template <std::invocable<size_t> Fn>
+	auto for_each_chunk(const size_t chunks, Fn&& fn) -> void {
+		if (chunks == 0)
+			return;
+
+		if (workers.empty() or chunks == 1) {
+			for (const auto i : vw::iota(0ul, chunks))
+				std::invoke(fn, i);
+			return;
+		}
+
+		auto batch = Batch{
+				.call = [] (void* f, const size_t i) { std::invoke(*static_cast<std::remove_reference_t<Fn>*>(f), i); },
+				.fn = static_cast<void*>(std::addressof(fn)),
+				.chunks = chunks,
+			};
+
+		{
+			LOCK_GUARD(m);
+			open.push_back(&batch);
+			batch.users = 1;
+		}
+		wake.notify_all();
+
+		run_chunks(batch);
+
+		// Late threads must not touch fn after we return, help the other batches until they leave
+		auto lock = std::unique_lock{m};
+		leave(batch);
+		while (batch.users != 0) {
+			if (open.empty()) {
+				wake.wait(lock);
+				continue;
+			}
+
+			auto& other = join();
+			lock.unlock();
+			run_chunks(other);
+			lock.lock();
+			leave(other);
+		}
+	}
+
+private:
+	static auto run_chunks(Batch& batch) -> void {
+		for (auto i = batch.next.fetch_add(1, std::memory_order_relaxed); i < batch.chunks; i = batch.next.fetch_add(1, std::memory_order_relaxed))
+			batch.call(batch.fn, i);
+	}
+
+	// Under m
+	auto join() -> Batch& {
+		auto& batch = *open.back();
+		++batch.users;
+		return batch;
+	}
+
+	// Under m, after run_chunks: every chunk of the batch is handed out
+	auto leave(Batch& batch) -> void {
+		if (const auto it = rg::find(open, &batch); it != open.end())
+			open.erase(it);
+
+		if (--batch.users == 0)
+			wake.notify_all();
+	}
+
+	auto work(const size_t id) -> void {
+		::prctl(PR_SET_NAME, fmt::format("sage_job_{}", id).c_str());
+
+		auto lock = std::unique_lock{m};
+		while (true) {
+			wake.wait(lock, [this] { return stop or not open.empty(); });
+			if (stop)
+				return;
+
+			auto& batch = join();
+			lock.unlock();
+			run_chunks(batch);
+			lock.lock();
+			leave(batch);
+		}
+	}
+};
+
+// How to spread work over a Pool. Each user picks its own defaults, e.g. Basic_ECS::par_each() or
+// renderer::Base_2D::set_parallel().
+struct Parallel {
+	// Below this many items the work is not worth spreading, run on the calling thread
+	size_t serial_threshold = 16'384;
+
+	// Items per chunk, 0 lets the user pick
+	size_t chunk_size = 0;
+
+	Pool* pool = nullptr;	// Defaults to Pool::shared()
+};
+
+}// sage::job
+
+#ifdef SAGE_TEST_JOB
+namespace {
+
+using namespace sage;
+
+TEST_CASE ("Job pool") {
+	for (const auto workers : { 0ul, 1ul, 4ul }) {
+		auto pool = job::Pool{workers};
+		CHECK_EQ(pool.concurrency(), workers + 1);
+
+		constexpr auto chunks = 1000ul;
+		auto hits = std::vector<std::atomic<int>>(chunks);
+
+		// Reuse the pool for several batches
+		for ([[maybe_unused]] const auto _ : vw::iota(0, 10))
+			pool.for_each_chunk(chunks, [&] (const size_t i) {
+					hits[i].fetch_add(1, std::memory_order_relaxed);
+				});
+
+		CHECK(rg::all_of(hits, [] (const auto& h) { return h.load() == 10; }));
+
+		pool.for_each_chunk(0, [] (const size_t) { FAIL("No chunks to run"); });
+	}
+}
+
+TEST_CASE ("Job pool concurrent submitters") {
+	auto pool = job::Pool{2};
+	auto sum = std::atomic<size_t>{0};
+
+	{
+		auto submitters = std::vector<std::jthread>{};
+		for ([[maybe_unused]] const auto _ : vw::iota(0, 4))
+			submitters.emplace_back([&] {
+					pool.for_each_chunk(100, [&] (const size_t i) { sum += i; });
+				});
+	}
+
+	CHECK_EQ(sum.load(), 4 * (99 * 100 / 2));
+}
+
+TEST_CASE ("Job pool nested batches") {
+	auto pool = job::Pool{3};
+	auto sum = std::atomic<size_t>{0};
+
+	pool.for_each_chunk(10, [&] (const size_t) {
+			pool.for_each_chunk(10, [&] (const size_t i) { sum += i; });
+		});
+
+	CHECK_EQ(sum.load(), 10 * (9 * 10 / 2));
+
+	// The threads that are not busy with the outer batch run the chunks of the nested one
+	auto m = std::mutex{};
+	auto threads = std::set<std::thread::id>{};
+	pool.for_each_chunk(2, [&] (const size_t outer) {
+			if (outer == 1)
+				return;
+
+			pool.for_each_chunk(16, [&] (const size_t) {
+					std::this_thread::sleep_for(2ms);
+					LOCK_GUARD(m);
+					threads.insert(std::this_thread::get_id());
+				});
+		});
+
+	CHECK_GT(threads.size(), 1);
+}
+
+}
+#endif
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "src/std.hpp"
+#include "src/util.hpp"
+#include "src/log.hpp"
+
+#include <sys/mman.h>
+
+namespace sage::memory {
+
+// Bytes the OS handed out for a resource and bytes in use in them
+struct Usage {
+	size_t reserved;
+	size_t used;
+
+	friend FMT_FORMATTER(Usage);
+};
+
+// Monotonic resource over large regions mapped from the OS, advised to be backed by huge pages so
+// that the memory of a world is a few contiguous TLB friendly regions.
+//
+// Deallocating does nothing, everything goes back to the OS at once by release() or the destructor,
+// so a world allocated from its own Arena is torn down in one shot. Regions double in size.
+//
+// Not thread safe, the structural changes of an ECS happen on a single thread anyway.
+struct Arena : std::pmr::memory_resource {
+	static constexpr auto huge_page_bytes = 2ul * 1024 * 1024;
+
+private:
+	struct Region {
+		std::byte* data;
+		size_t size;
+	};
+
+	std::vector<Region> regions;
+	std::byte* cursor = nullptr;
+	std::byte* end = nullptr;
+	size_t next_region_bytes;
+	size_t _used = 0;
+
+public:
+	explicit Arena(const size_t initial_region_bytes = 32 * huge_page_bytes)
+		: next_region_bytes{round_up(std::max(initial_region_bytes, 1ul), huge_page_bytes)}
+	{}
+
+	Arena(const Arena&) = delete;
+	auto operator= (const Arena&) -> Arena& = delete;
+
+	~Arena() {
+		release();
+	}
+
+public:
+	// Unmap everything, whatever was allocated from the Arena must be gone already
+	auto release() -> void {
+		for (const auto& region : regions)
+			::munmap(region.data, region.size);
+
+		regions.clear();
+		cursor = end = nullptr;
+		_used = 0;
+	}
+
+	auto usage() const -> Usage {
+		return {
+			.reserved = rg::fold_left(regions | vw::transform(&Region::size), 0ul, std::plus{}),
+			.used = _used
+		};
+	}
+
+private:
+	auto do_allocate(const size_t bytes, const size_t alignment) -> void* override {
+		auto* at = align(cursor, alignment);
+		if (cursor == nullptr or at + bytes > end) {
+			map(std::max(next_region_bytes, round_up(bytes + alignment, huge_page_bytes)));
+			at = align(cursor, alignment);
+		}
+
+		_used += static_cast<size_t>(at + bytes - cursor);
+		cursor = at + bytes;
+		return at;
+	}
+
+	auto do_deallocate(void*, size_t, size_t) -> void override {}
+
+	auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override {
+		return this == &other;
+	}
+
+	auto map(const size_t bytes) -> void {
+		auto* data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (data == MAP_FAILED)
+			throw std::bad_alloc{};
+
+		#ifdef MADV_HUGEPAGE
+		if (::madvise(data, bytes, MADV_HUGEPAGE) != 0)
+			SAGE_LOG_WARN("Huge pages are not available: {}", std::strerror(errno));
+		#endif
+
+		regions.push_back({ static_cast<std::byte*>(data), bytes });
+		cursor = static_cast<std::byte*>(data);
+		end = cursor + bytes;
+		next_region_bytes = bytes * 2;
+	}
+
+	static auto align(std::byte* p, const size_t alignment) -> std::byte* {
+		const auto address = reinterpret_cast<uintptr_t>(p);
+		return p + (round_up(address, alignment) - address);
+	}
+
+	static constexpr auto round_up(const size_t n, const size_t multiple) -> size_t {
+		return (n + multiple - 1) / multiple * multiple;
+	}
+};
+
+// Counts the bytes allocated through it and not deallocated yet, e.g. those of a single world.
+// Reserved bytes are the ones of the upstream if it is an Arena, otherwise the bytes in use.
+struct Tracking_Resource : std::pmr::memory_resource {
+private:
+	std::pmr::memory_resource* upstream;
+	size_t _used = 0;
+
+public:
+	explicit Tracking_Resource(std::pmr::memory_resource* _upstream = std::pmr::get_default_resource())
+		: upstream{_upstream}
+	{
+		SAGE_ASSERT(upstream != nullptr);
+	}
+
+	Tracking_Resource(const Tracking_Resource&) = delete;
+	auto operator= (const Tracking_Resource&) -> Tracking_Resource& = delete;
+
+public:
+	auto usage() const -> Usage {
+		if (const auto* arena = dynamic_cast<const Arena*>(upstream); arena != nullptr)
+			return { .reserved = arena->usage().reserved, .used = _used };
+		else
+			return { .reserved = _used, .used = _used };
+	}
+
+	auto upstream_resource() const -> std::pmr::memory_resource* {
+		return upstream;
+	}
+
+private:
+	auto do_allocate(const size_t bytes, const size_t alignment) -> void* override {
+		auto* p = upstream->allocate(bytes, alignment);
+		_used += bytes;
+		return p;
+	}
+
+	auto do_deallocate(void* p, const size_t bytes, const size_t alignment) -> void override {
+		upstream->deallocate(p, bytes, alignment);
+		_used -= bytes;
+	}
+
+	auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override {
+		return this == &other;
+	}
+};
+
+}// sage::memory
+
+template <>
+FMT_FORMATTER(sage::memory::Usage) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::memory::Usage) {
+		constexpr auto mib = 1024.f * 1024.f;
+		return fmt::format_to(ctx.out(), "reserved={:.1f}MiB used={:.1f}MiB",
+				static_cast<float>(obj.reserved) / mib,
+				static_cast<float>(obj.used) / mib
+			);
+	}
+};
+
+#ifdef SAGE_TEST_MEMORY
+namespace {
+
+using namespace sage;
+
+TEST_CASE ("Memory arena") {
+	auto arena = memory::Arena{1};
+	CHECK_EQ(arena.usage().reserved, 0);
+
+	// Regions are huge pages
+	auto* a = arena.allocate(100, 8);
+	CHECK_EQ(arena.usage().reserved, memory::Arena::huge_page_bytes);
+	CHECK_EQ(arena.usage().used, 100);
+
+	auto* b = arena.allocate(64, 64);
+	CHECK_EQ(reinterpret_cast<uintptr_t>(b) % 64, 0);
+	CHECK_GE(static_cast<std::byte*>(b), static_cast<std::byte*>(a) + 100);
+	CHECK_LE(arena.usage().used, 100 + 64 + 64);
+
+	// Deallocating is a no-op, memory is written to
+	arena.deallocate(a, 100, 8);
+	std::memset(b, 0xff, 64);
+	CHECK_EQ(static_cast<unsigned char*>(b)[63], 0xff);
+
+	// Bigger than a region, and the next region doubles
+	const auto before = arena.usage().reserved;
+	auto* big = arena.allocate(3 * memory::Arena::huge_page_bytes, 16);
+	std::memset(big, 0, 3 * memory::Arena::huge_page_bytes);
+	CHECK_GE(arena.usage().reserved, before + 3 * memory::Arena::huge_page_bytes);
+
+	arena.release();
+	CHECK_EQ(arena.usage().reserved, 0);
+	CHECK_EQ(arena.usage().used, 0);
+
+	// Still usable after a release
+	auto vec = std::pmr::vector<int>{&arena};
+	vec.resize(1000, 7);
+	CHECK_EQ(vec.back(), 7);
+}
+
+TEST_CASE ("Memory tracking resource") {
+	{
+		auto tracking = memory::Tracking_Resource{};
+		{
+			auto vec = std::pmr::vector<int>{&tracking};
+			vec.reserve(1000);
+			CHECK_EQ(tracking.usage().used, 1000 * sizeof(int));
+			CHECK_EQ(tracking.usage().reserved, tracking.usage().used);
+		}
+		CHECK_EQ(tracking.usage().used, 0);
+	}
+
+	auto arena = memory::Arena{};
+	auto tracking = memory::Tracking_Resource{&arena};
+	auto vec = std::pmr::vector<int>{&tracking};
+	vec.reserve(1000);
+	CHECK_EQ(tracking.usage().used, 1000 * sizeof(int));
+	CHECK_EQ(tracking.usage().reserved, arena.usage().reserved);
+	CHECK_EQ(fmt::format("{}", memory::Usage{ .reserved = 2 * 1024 * 1024, .used = 1024 * 1024 }), "reserved=2.0MiB used=1.0MiB");
+}
+
+}
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "src/std.hpp"
+#include "src/util.hpp"
+
+namespace sage::name {
+
+// A small handle to an interned string, equal Ids are equal strings
+struct Id {
+	using Rep = uint32_t;
+
+	static constexpr auto null_rep = std::numeric_limits<Rep>::max();
+
+	Rep rep = null_rep;
+
+	static constexpr auto null() -> Id {
+		return {};
+	}
+
+	constexpr auto is_null() const -> bool {
+		return rep == null_rep;
+	}
+
+	constexpr auto operator<=> (const Id&) const = default;
+};
+
+// Interned strings: every distinct string is stored once and gets an Id, so components hold
+// 4 bytes instead of a std::string and names compare and hash as integers.
+// Strings are never removed, views to them stay valid as long as the Table.
+//
+// Thread safe, Ids are usually looked up once and kept around.
+struct Table {
+private:
+	mutable std::mutex m;
+	std::deque<std::string> strings;	// Indexed by Id, a deque so that the views of `ids` stay valid
+	std::unordered_map<std::string_view, Id> ids;
+
+public:
+	static auto global() -> Table& {
+		static auto table = Table{};
+		return table;
+	}
+
+	Table() = default;
+	Table(Table&&) = delete;
+
+public:
+	auto intern(const std::string_view str) -> Id {
+		LOCK_GUARD(m);
+
+		if (const auto found = ids.find(str); found != ids.end())
+			return found->second;
+
+		SAGE_ASSERT(strings.size() < Id::null_rep, "Too many names");
+
+		const auto id = Id{ static_cast<Id::Rep>(strings.size()) };
+		const auto& stored = strings.emplace_back(str);
+		ids.emplace(stored, id);
+		return id;
+	}
+
+	// Id of a string interned before, does not intern
+	auto find(const std::string_view str) const -> std::optional<Id> {
+		LOCK_GUARD(m);
+
+		if (const auto found = ids.find(str); found != ids.end())
+			return found->second;
+		else
+			return std::nullopt;
+	}
+
+	auto view(const Id id) const -> std::string_view {
+		LOCK_GUARD(m);
+
+		SAGE_ASSERT(id.rep < strings.size(), "Id {} is not from this table", id.rep);
+		return strings[id.rep];
+	}
+
+	auto size() const -> size_t {
+		LOCK_GUARD(m);
+		return strings.size();
+	}
+};
+
+}// sage::name
+
+template <>
+struct std::hash<sage::name::Id> {
+	auto operator() (const sage::name::Id id) const -> size_t {
+		return std::hash<sage::name::Id::Rep>{}(id.rep);
+	}
+};
+
+#ifdef SAGE_TEST_NAME
+namespace {
+
+using namespace sage;
+
+TEST_CASE ("Name table") {
+	auto table = name::Table{};
+
+	const auto dirt = table.intern("Tile of Dirt");
+	const auto water = table.intern("Tile of Water");
+	CHECK_NE(dirt, water);
+	CHECK_EQ(table.intern("Tile of Dirt"), dirt);
+	CHECK_EQ(table.intern(std::string{"Tile of "} + "Water"), water);
+	CHECK_EQ(table.size(), 2);
+
+	CHECK_EQ(table.view(dirt), "Tile of Dirt");
+	CHECK_EQ(table.view(water), "Tile of Water");
+
+	CHECK_EQ(table.find("Tile of Water"), water);
+	CHECK_FALSE(table.find("Tile of Lava").has_value());
+	CHECK_EQ(table.size(), 2);
+
+	CHECK(name::Id::null().is_null());
+	CHECK_FALSE(dirt.is_null());
+}
+
+TEST_CASE ("Name table views are stable") {
+	auto table = name::Table{};
+
+	// Short strings live inside the std::string, they must not move as the table grows
+	const auto first = table.view(table.intern("a"));
+	for (const auto i : vw::iota(0, 10'000))
+		table.intern(fmt::format("{}", i));
+
+	CHECK_EQ(first, "a");
+	CHECK_EQ(table.view(*table.find("9999")), "9999");
+	CHECK_EQ(table.size(), 10'001);
+}
+
+TEST_CASE ("Name table from many threads") {
+	auto table = name::Table{};
+
+	auto ids = std::array<std::vector<name::Id>, 4>{};
+	{
+		auto threads = std::vector<std::jthread>{};
+		for (auto& per_thread : ids)
+			threads.emplace_back([&] {
+					for (const auto i : vw::iota(0, 1000))
+						per_thread.push_back(table.intern(fmt::format("Entity {}", i)));
+				});
+	}
+
+	CHECK_EQ(table.size(), 1000);
+	for (const auto& per_thread : ids)
+		CHECK_EQ(per_thread, ids.front());
+}
+
+}
+#endif
@@ -52,18 +52,24 @@ public:
 		struct Result {
 			std::optional<Batch> batch;
 			uintmax_t draw_calls,
-					  quads;
+					  quads,
+					  vertex_bytes;	// Written for the quads, see bytes_per_quad()
+			Duration stalled;	// Waiting for the GPU to be done with vertex memory before writing to it
 
 		public:
 			Result()
 				: draw_calls{0}
 				, quads{0}
+				, vertex_bytes{0}
+				, stalled{0}
 			{}
 
 			Result(std::optional<Batch>&& batch)
 				: batch{std::move(batch)}
 				, draw_calls{0}
 				, quads{0}
+				, vertex_bytes{0}
+				, stalled{0}
 			{}
 
 			Result(const Result&) = default;
@@ -71,15 +77,23 @@ public:
 				: batch{other.batch} // copy to not lose the information
 				, draw_calls{std::exchange(other.draw_calls, 0)}
 				, quads{std::exchange(other.quads, 0)}
+				, vertex_bytes{std::exchange(other.vertex_bytes, 0)}
+				, stalled{std::exchange(other.stalled, Duration{0})}
 			{}
 
 			auto operator= (Result&& other) -> Result& {
 				draw_calls = std::exchange(other.draw_calls, 0);
 				quads = std::exchange(other.quads, 0);
+				vertex_bytes = std::exchange(other.vertex_bytes, 0);
+				stalled = std::exchange(other.stalled, Duration{0});
 
 				return *this;
 			}
 
+			auto bytes_per_quad() const -> uintmax_t {
+				return quads == 0 ? 0 : vertex_bytes / quads;
+			}
+
 		public:
 			friend FMT_FORMATTER(Result);
 		};
@@ -130,9 +144,19 @@ public:
 	};
 	using Timer_Results = std::vector<Timer_Result_Pair>;
 
+	// A container that had to grow, e.g. the ECS running out of slots
+	struct Growth {
+		std::string_view name;
+		size_t from, to;
+
+		friend FMT_FORMATTER(Growth);
+	};
+	using Growth_Results = std::vector<Growth>;
+
 	using Results = util::Polymorphic_Array<
 			Timer_Results,
-			Rendering::Result
+			Rendering::Result,
+			Growth_Results
 		>;
 
 private:
@@ -143,7 +167,8 @@ public:
 	Profiler(Rendering::Batch&& batch, const size_t timer_result_capacity = 100)
 		: results{
 			Timer_Results{},
-			Rendering::Result{std::move(batch)}
+			Rendering::Result{std::move(batch)},
+			Growth_Results{}
 		}
 	{
 		results.get<Timer_Results>().reserve(timer_result_capacity);
@@ -173,6 +198,16 @@ public:
 		return { res };
 	}
 
+	// A duration measured elsewhere, e.g. on a thread that must not touch the Profiler
+	auto record(const std::string_view name, const Duration duration) -> void {
+		auto& timer_results = results.get<Timer_Results>();
+
+		SAGE_ASSERT(timer_results.size() < timer_results.capacity(),
+				"Make sure the profiling results are consumed at some point and if you need more increase the `timer_results_capacity` hint in the Profiler constructor", timer_results.size(), timer_results.capacity());
+
+		timer_results.push_back({ .name = name, .result = { duration } });
+	}
+
 	#pragma GCC diagnostic push
 	#pragma GCC diagnostic ignored "-Wvariadic-macros"
 
@@ -195,6 +230,16 @@ public:
 		return Rendering{ results.get<Rendering::Result>(), std::forward<Fn>(fn) };
 	}
 
+	#ifndef NDEBUG
+	#define PROFILER_GROWTH(_prof_, _name_, _from_, _to_) _prof_.growth(_name_, _from_, _to_)
+	#else
+	#define PROFILER_GROWTH(...) (void)0
+	#endif
+
+	auto growth(const std::string_view name, const size_t from, const size_t to) -> void {
+		results.get<Growth_Results>().push_back({ .name = name, .from = from, .to = to });
+	}
+
 	[[nodiscard]]
 	auto consume_results() -> Results {
 		// Writing: return std::move(results); in one line does not work
@@ -202,6 +247,7 @@ public:
 
 		results.get<Timer_Results>().clear();
 		results.get<Rendering::Result>() = Rendering::Result();
+		results.get<Growth_Results>().clear();
 
 		return r;
 	}
@@ -227,7 +273,7 @@ FMT_FORMATTER(sage::perf::Profiler::Rendering::Result) {
 
 	FMT_FORMATTER_FORMAT(sage::perf::Profiler::Rendering::Result) {
 		return fmt::format_to(ctx.out(),
-				"batch{{{}}} quads={} draw_calls={}",
+				"batch{{{}}} quads={} draw_calls={} vertex_bytes={} ({} per quad) stalled={}",
 				// TODO: Make a specialization that is shorter than fmt's optional(...)
 				std::invoke([&] {
 						if (obj.batch.has_value())
@@ -236,7 +282,10 @@ FMT_FORMATTER(sage::perf::Profiler::Rendering::Result) {
 							return "Unspecified"s;
 					}),
 				obj.quads,
-				obj.draw_calls
+				obj.draw_calls,
+				obj.vertex_bytes,
+				obj.bytes_per_quad(),
+				obj.stalled
 			);
 	}
 };
@@ -259,6 +308,15 @@ FMT_FORMATTER(sage::perf::Profiler::Timer_Result_Pair) {
 	}
 };
 
+template<>
+FMT_FORMATTER(sage::perf::Profiler::Growth) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::perf::Profiler::Growth) {
+		return fmt::format_to(ctx.out(), "(name={:?} from={} to={})", obj.name, obj.from, obj.to);
+	}
+};
+
 template<>
 FMT_FORMATTER(sage::perf::Profiler::Results) {
 	FMT_FORMATTER_DEFAULT_PARSE
@@ -294,6 +352,9 @@ FMT_FORMATTER(sage::perf::Profiler::Results) {
 		const auto& rendering_result = obj.get<Profiler::Rendering::Result>();
 		fmt::format_to(ctx.out(), "\nRendering {}", rendering_result);
 
+		for (const auto& growth : obj.get<Profiler::Growth_Results>())
+			fmt::format_to(ctx.out(), "\nGrowth {}", growth);
+
 
 		return fmt::format_to(ctx.out(), "\n=============================\nLegend\n{}", sage::perf::target::legend());
 	}
@@ -102,14 +102,30 @@ private:
 };
 
 // TODO: Split dynamic/static vertex_buffer?
+//
+// A dynamic buffer is a ring of `stream_regions` regions of `size` bytes, persistently mapped so
+// that batches are written straight into it, see sage::graphics::buffer::vertex::Streaming.
+// A fence per region keeps the CPU from overwriting what the GPU has not drawn yet.
+// Without glBufferStorage it is a single region that set_verteces() uploads to.
 struct Vertex_Buffer {
 	using Layout = sage::graphics::buffer::Layout;
 	using Vertices = sage::graphics::buffer::vertex::Vertices;
+	using Region = sage::graphics::buffer::vertex::Region;
+
+	static constexpr auto stream_regions = 3ul;
 
 private:
+	struct Stream {
+		std::byte* mapped;
+		size_t region_bytes;
+		size_t region = 0;
+		std::array<GLsync, stream_regions> fences = {};
+	};
+
 	glfw::ID renderer_id;
 	Vertices _verteces;
 	Layout _layout;
+	std::optional<Stream> stream;
 
 public:
 	Vertex_Buffer(const size_t size, Layout&& l)
@@ -118,6 +134,25 @@ public:
 		renderer_id.emplace();
 		glCreateBuffers(1, &renderer_id.raw());
 		glBindBuffer(GL_ARRAY_BUFFER, renderer_id.raw());
+
+		if (GLAD_GL_VERSION_4_4) {
+			constexpr auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+			glNamedBufferStorage(renderer_id.raw(), stream_regions * size, nullptr, flags);
+			auto* mapped = glMapNamedBufferRange(renderer_id.raw(), 0, stream_regions * size, flags);
+
+			if (mapped != nullptr) {
+				stream = Stream{ .mapped = static_cast<std::byte*>(mapped), .region_bytes = size };
+				return;
+			}
+
+			// Storage is immutable, start over with a plain buffer
+			SAGE_LOG_WARN("Could not map vertex buffer, falling back to uploading the verteces");
+			glDeleteBuffers(1, &renderer_id.raw());
+			glCreateBuffers(1, &renderer_id.raw());
+			glBindBuffer(GL_ARRAY_BUFFER, renderer_id.raw());
+		}
+
 		glBufferData(
 				GL_ARRAY_BUFFER,
 				size,
@@ -145,11 +180,20 @@ public:
 		: renderer_id{std::move(other.renderer_id)}
 		, _verteces{std::move(other._verteces)}
 		, _layout{std::move(other._layout)}
+		, stream{std::exchange(other.stream, std::nullopt)}
 	{}
 
 	~Vertex_Buffer() {
-		if (renderer_id)
+		if (stream.has_value())
+			for (const auto fence : stream->fences)
+				if (fence != nullptr)
+					glDeleteSync(fence);
+
+		if (renderer_id) {
+			if (stream.has_value())
+				glUnmapNamedBuffer(renderer_id.raw());
 			glDeleteBuffers(1, &renderer_id.raw());
+		}
 	}
 
 public:
@@ -169,10 +213,58 @@ public:
 
 	auto set_verteces(const std::span<const std::byte> bytes) -> void {
 		SAGE_ASSERT(renderer_id.raw());
+		SAGE_ASSERT(not is_streaming(), "Streaming buffers are written through acquire_region()");
+
 		glBindBuffer(GL_ARRAY_BUFFER, renderer_id.raw());
 		glBufferSubData(GL_ARRAY_BUFFER, 0, bytes.size(), bytes.data());
 	}
 
+	auto is_streaming() const -> bool {
+		return stream.has_value();
+	}
+
+	// The next region of the ring, waits for the GPU to finish drawing from it
+	auto acquire_region() -> Region {
+		SAGE_ASSERT(is_streaming());
+
+		auto stall = Tick<Profiler::Duration>{};
+		auto stalled = Profiler::Duration{0};
+
+		if (auto& fence = stream->fences[stream->region]; fence != nullptr) {
+			constexpr auto timeout_ns = 1'000'000'000ul;
+
+			for (auto flags = GLbitfield{GL_SYNC_FLUSH_COMMANDS_BIT}; ; flags = 0) {
+				const auto status = glClientWaitSync(fence, flags, timeout_ns);
+				if (status == GL_ALREADY_SIGNALED or status == GL_CONDITION_SATISFIED)
+					break;
+				else if (status == GL_WAIT_FAILED) {
+					SAGE_LOG_WARN("Waiting for vertex buffer region {} failed", stream->region);
+					break;
+				}
+			}
+
+			glDeleteSync(std::exchange(fence, nullptr));
+			stalled = stall();
+		}
+
+		return {
+			.bytes = { stream->mapped + stream->region * stream->region_bytes, stream->region_bytes },
+			.first_vertex = stream->region * stream->region_bytes / _layout.stride(),
+			.stalled = stalled,
+		};
+	}
+
+	// Fence the region after the draw call that reads it, and move to the next one
+	auto release_region() -> void {
+		SAGE_ASSERT(is_streaming());
+
+		auto& fence = stream->fences[stream->region];
+		SAGE_ASSERT(fence == nullptr, "Region released twice");
+
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		stream->region = (stream->region + 1) % stream_regions;
+	}
+
 	auto layout() const -> const Layout& {
 		return _layout;
 	}
@@ -181,6 +273,27 @@ public:
 	REPR_DECL(Vertex_Buffer);
 	friend FMT_FORMATTER(Vertex_Buffer);
 };
+static_assert(sage::graphics::buffer::vertex::Streaming<Vertex_Buffer>);
+
+// Feed the attributes from `first_index` on with the elements of the layout of `vb`, a divisor of 1
+// advances them once per instance instead of once per vertex
+inline auto set_attributes(const Vertex_Buffer& vb, const GLuint first_index, const GLuint divisor = 0) -> void {
+	vb.bind();
+
+	rg::for_each(vb.layout().elements(), [&, index = first_index] (const auto& elem) mutable {
+			glEnableVertexAttribArray(index);
+			glVertexAttribPointer(
+					index,
+					elem.component_count,
+					shader_data_type_to_opengl(elem.type),
+					elem.normalized ? GL_TRUE : GL_FALSE,
+					vb.layout().stride(),
+					(const void*)elem.offset
+				);
+			glVertexAttribDivisor(index, divisor);
+			++index;
+		});
+}
 
 struct Index_Buffer {
 	using Indeces = sage::graphics::buffer::index::Indeces;
@@ -291,21 +404,7 @@ public:
 
 		glBindVertexArray(renderer_id.raw());
 
-		_vertex_buffer.bind();
-
-		rg::for_each(_vertex_buffer.layout().elements(), [&, index = 0ul] (const auto& elem) mutable {
-				glEnableVertexAttribArray(index);
-				glVertexAttribPointer(
-						index,
-						elem.component_count,
-						shader_data_type_to_opengl(elem.type),
-						elem.normalized ? GL_TRUE : GL_FALSE,
-						_vertex_buffer.layout().stride(),
-						(const void*)elem.offset
-					);
-				++index;
-			});
-
+		set_attributes(_vertex_buffer, 0);
 
 		_index_buffer.bind();
 
@@ -346,6 +445,76 @@ public:
 	friend FMT_FORMATTER(Vertex_Array);
 };
 
+// A unit quad drawn once per instance, the verteces of vertex_buffer() are
+// sage::graphics::buffer::vertex::Instances that place and color each one.
+struct Instanced_Vertex_Array {
+	using Vertex_Buffer = oslinux::Vertex_Buffer;
+	using Index_Buffer = oslinux::Index_Buffer;
+
+private:
+	glfw::ID renderer_id;
+	Vertex_Buffer unit_quad;
+	Vertex_Buffer instances;
+	Index_Buffer _index_buffer;
+
+public:
+	Instanced_Vertex_Array(Vertex_Buffer&& inst)
+		: unit_quad{
+			Vertex_Buffer::Vertices{
+				-0.5f, -0.5f,
+				 0.5f, -0.5f,
+				 0.5f,  0.5f,
+				-0.5f,  0.5f,
+			},
+			Vertex_Buffer::Layout{{ sage::graphics::buffer::Element{{ .name = "a_Corner", .type = sage::graphics::shader::data::Type::Float2 }} }}
+		}
+		, instances{std::move(inst)}
+		, _index_buffer{6}
+	{
+		SAGE_ASSERT(instances.layout().elements().size());
+
+		renderer_id.emplace();
+		glCreateVertexArrays(1, &renderer_id.raw());
+
+		glBindVertexArray(renderer_id.raw());
+
+		set_attributes(unit_quad, 0);
+		set_attributes(instances, unit_quad.layout().elements().size(), 1);
+
+		_index_buffer.bind();
+	}
+
+	Instanced_Vertex_Array(Instanced_Vertex_Array&& other)
+		: renderer_id{std::move(other.renderer_id)}
+		, unit_quad{std::move(other.unit_quad)}
+		, instances{std::move(other.instances)}
+		, _index_buffer{std::move(other._index_buffer)}
+	{}
+
+	~Instanced_Vertex_Array() {
+		if (renderer_id)
+			glDeleteVertexArrays(1, &renderer_id.raw());
+	}
+
+public:
+	auto bind() const -> void {
+		SAGE_ASSERT(renderer_id);
+		glBindVertexArray(renderer_id.raw());
+	}
+
+	auto unbind() const -> void {
+		glBindVertexArray(0);
+	}
+
+public:
+	auto vertex_buffer() const	-> const Vertex_Buffer&	{ return instances; }
+	auto vertex_buffer()		-> Vertex_Buffer&		{ return instances; }
+
+	auto index_buffer() const -> const Index_Buffer& {
+		return _index_buffer;
+	}
+};
+
 // When setting up the shader from file do not try to manually read the contents of the file
 // and pass them to the Shader(string, string) constructor. Instead use the Shader(fs::path) overload.
 //
@@ -776,44 +945,60 @@ private:
 	}
 };
 
+using Clear_Call = decltype([] {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	});
+
 using Renderer_2D_Base = sage::graphics::renderer::Base_2D<
 		Vertex_Array,
 		Texture2D,
 		decltype([] (const auto& batch) {
-				glDrawElements(GL_TRIANGLES, batch.indeces(), GL_UNSIGNED_INT, nullptr);
-			}),
-		decltype([] {
-				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glDrawElementsBaseVertex(GL_TRIANGLES, batch.indeces(), GL_UNSIGNED_INT, nullptr, batch.first_vertex());
 			}),
+		Clear_Call,
 		Frame_Buffer,
 		Shader
 	>;
 
-struct Renderer_2D : Renderer_2D_Base {
-	using Base = Renderer_2D_Base;
+using Renderer_2D_Instanced_Base = sage::graphics::renderer::Base_2D<
+		Instanced_Vertex_Array,
+		Texture2D,
+		decltype([] (const auto& batch) {
+				glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, batch.quads(), batch.first_vertex());
+			}),
+		Clear_Call,
+		Frame_Buffer,
+		Shader,
+		sage::graphics::buffer::vertex::Instance
+	>;
+
+// Renderer_2D sends 4 verteces per quad, transformed on the CPU.
+// Renderer_2D_Instanced sends one buffer::vertex::Instance per quad and the shader expands it,
+// pick one as the Renderer of the App.
+template <typename _Base>
+struct Basic_Renderer_2D : _Base {
+	using Base = _Base;
 
 	using Texture = Base::Texture;
 	using Sub_Texture = Base::Sub_Texture;
 	using Batch = Base::Batch;
+	using Vertex = Base::Vertex;
 	using Vertex_Array = Base::Vertex_Array;
 	using Frame_Buffer = Base::Frame_Buffer;
 	using Shader = Base::Shader;
 	using Draw_Args = Base::Draw_Args;
 	using Drawings = Base::Drawings;
+	using Draw_List = Base::Draw_List;
+
+	static constexpr auto is_instanced = std::same_as<Vertex, sage::graphics::buffer::vertex::Instance>;
 
 public:
-	Renderer_2D(Profiler& prof = Profiler::global)
+	Basic_Renderer_2D(Profiler& prof = Profiler::global)
 		: Base{
 			{
-				.vertex_array{
-					Vertex_Buffer{
-						Batch::max_verteces * sizeof(sage::graphics::buffer::vertex::Quad),
-						sage::graphics::buffer::vertex::Quad::layout()
-					},
-					Index_Buffer{Batch::max_indeces}
-				},
+				.vertex_array = make_vertex_array(),
 				.frame_buffer = Frame_Buffer{{ .size={1280, 720} }},
-				.shader{"asset/shader/texture.glsl"},
+				.shader{is_instanced ? "asset/shader/instanced.glsl" : "asset/shader/texture.glsl"},
 			},
 			prof
 		}
@@ -824,11 +1009,11 @@ public:
 
 		glClearColor(0.5f, 0.5f, 0.5f, 1.f);
 
-		scene_data.shader.bind();
+		this->scene_data.shader.bind();
 		// Make an iota array to fill the Sampler2Ds
-		auto iota = std::array<int, Base::Batch::max_texture_slots>{};
+		auto iota = std::array<int, Batch::max_texture_slots>{};
 		rg::iota(iota, 0);
-		scene_data.shader.upload_uniform("u_Textures", std::span{iota});
+		this->scene_data.shader.upload_uniform("u_Textures", std::span{iota});
 	}
 
 	auto event_callback(const Event& e) -> void {
@@ -839,8 +1024,21 @@ public:
 			glViewport(0, 0, payload.width, payload.height);
 		}
 	}
+
+private:
+	static auto make_vertex_array() -> Vertex_Array {
+		auto verteces = Vertex_Buffer{Batch::max_verteces * sizeof(Vertex), Vertex::layout()};
+
+		if constexpr (is_instanced)
+			return Vertex_Array{std::move(verteces)};
+		else
+			return Vertex_Array{std::move(verteces), Index_Buffer{Batch::max_indeces}};
+	}
 };
 
+using Renderer_2D = Basic_Renderer_2D<Renderer_2D_Base>;
+using Renderer_2D_Instanced = Basic_Renderer_2D<Renderer_2D_Instanced_Base>;
+
 }//sage::oslinux::graphics
 
 template <>
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "src/std.hpp"
+#include "src/util.hpp"
+
+#if defined(__x86_64__) or defined(__i386__)
+	#define SAGE_SIMD_X86 1
+	#include <immintrin.h>
+#else
+	#define SAGE_SIMD_X86 0
+#endif
+
+namespace sage::simd {
+
+// The widest instructions the CPU has, kernels pick their implementation with it at runtime
+enum class Level {
+	Scalar,
+	SSE,	// 4 floats, SSE2 is part of x86-64
+	AVX2,	// 8 floats
+};
+
+inline auto detect() -> Level {
+	#if SAGE_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return Level::AVX2;
+	else if (__builtin_cpu_supports("sse2"))
+		return Level::SSE;
+	#endif
+
+	return Level::Scalar;
+}
+
+inline auto level() -> Level {
+	static const auto detected = detect();
+	return detected;
+}
+
+constexpr auto lanes(const Level l) -> size_t {
+	switch (l) {
+		case Level::AVX2:	return 8;
+		case Level::SSE:	return 4;
+		default:			return 1;
+	}
+}
+
+// Sine and cosine of angles in radians, within 1e-5 of std::sin/cos up to a few thousand turns.
+//
+// The angle is reduced to r in [-pi/4, pi/4] around the nearest multiple q of pi/2, where short
+// polynomials are exact enough, then the quadrant q swaps and negates them.
+namespace detail::sincos {
+
+constexpr auto two_over_pi = 0.636619772367581343f;
+// pi/2 in three parts, the first two with few enough bits that q * part is exact
+constexpr auto pi_over_2_a = 1.5703125f;
+constexpr auto pi_over_2_b = 4.837512969970703125e-4f;
+constexpr auto pi_over_2_c = 7.54978995489188216e-8f;
+
+// Taylor coefficients of sin(r) / r and cos(r) in r^2
+constexpr auto s1 = -1.f / 6, s2 = 1.f / 120, s3 = -1.f / 5040;
+constexpr auto c1 = -1.f / 2, c2 = 1.f / 24, c3 = -1.f / 720, c4 = 1.f / 40320;
+
+}// detail::sincos
+
+inline auto sincos(const float radians) -> std::pair<float, float> {
+	return { std::sin(radians), std::cos(radians) };
+}
+
+#if SAGE_SIMD_X86
+
+// Structs rather than std::pair, the vector attributes of __m128/__m256 are lost as template arguments
+struct Sincos4 { __m128 sin, cos; };
+struct Sincos8 { __m256 sin, cos; };
+
+inline auto sincos(const __m128 radians) -> Sincos4 {
+	using namespace detail::sincos;
+
+	const auto q = _mm_cvtps_epi32(_mm_mul_ps(radians, _mm_set1_ps(two_over_pi)));	// Rounds to nearest
+	const auto qf = _mm_cvtepi32_ps(q);
+	auto r = _mm_sub_ps(radians, _mm_mul_ps(qf, _mm_set1_ps(pi_over_2_a)));
+	r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(pi_over_2_b)));
+	r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(pi_over_2_c)));
+	const auto r2 = _mm_mul_ps(r, r);
+
+	auto s = _mm_add_ps(_mm_set1_ps(s2), _mm_mul_ps(r2, _mm_set1_ps(s3)));
+	s = _mm_add_ps(_mm_set1_ps(s1), _mm_mul_ps(r2, s));
+	s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), s));
+
+	auto c = _mm_add_ps(_mm_set1_ps(c3), _mm_mul_ps(r2, _mm_set1_ps(c4)));
+	c = _mm_add_ps(_mm_set1_ps(c2), _mm_mul_ps(r2, c));
+	c = _mm_add_ps(_mm_set1_ps(c1), _mm_mul_ps(r2, c));
+	c = _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(r2, c));
+
+	// Odd quadrants swap sin and cos, sin is negated in quadrants 2 and 3, cos in 1 and 2
+	const auto one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+	const auto swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+	const auto sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+	const auto cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+
+	return {
+		_mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sin_sign),
+		_mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cos_sign),
+	};
+}
+
+[[gnu::target("avx2")]]
+inline auto sincos(const __m256 radians) -> Sincos8 {
+	using namespace detail::sincos;
+
+	const auto q = _mm256_cvtps_epi32(_mm256_mul_ps(radians, _mm256_set1_ps(two_over_pi)));
+	const auto qf = _mm256_cvtepi32_ps(q);
+	auto r = _mm256_sub_ps(radians, _mm256_mul_ps(qf, _mm256_set1_ps(pi_over_2_a)));
+	r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(pi_over_2_b)));
+	r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(pi_over_2_c)));
+	const auto r2 = _mm256_mul_ps(r, r);
+
+	auto s = _mm256_add_ps(_mm256_set1_ps(s2), _mm256_mul_ps(r2, _mm256_set1_ps(s3)));
+	s = _mm256_add_ps(_mm256_set1_ps(s1), _mm256_mul_ps(r2, s));
+	s = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), s));
+
+	auto c = _mm256_add_ps(_mm256_set1_ps(c3), _mm256_mul_ps(r2, _mm256_set1_ps(c4)));
+	c = _mm256_add_ps(_mm256_set1_ps(c2), _mm256_mul_ps(r2, c));
+	c = _mm256_add_ps(_mm256_set1_ps(c1), _mm256_mul_ps(r2, c));
+	c = _mm256_add_ps(_mm256_set1_ps(1.f), _mm256_mul_ps(r2, c));
+
+	const auto one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+	const auto swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+	const auto sin_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30));
+	const auto cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), 30));
+
+	return {
+		_mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sin_sign),
+		_mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cos_sign),
+	};
+}
+
+#endif
+
+}// sage::simd
+
+template <>
+FMT_FORMATTER(sage::simd::Level) {
+	FMT_FORMATTER_DEFAULT_PARSE
+
+	FMT_FORMATTER_FORMAT(sage::simd::Level) {
+		using sage::simd::Level;
+
+		switch (obj) {
+			case Level::AVX2:	return fmt::format_to(ctx.out(), "AVX2");
+			case Level::SSE:	return fmt::format_to(ctx.out(), "SSE");
+			default:			return fmt::format_to(ctx.out(), "Scalar");
+		}
+	}
+};
+
+#ifdef SAGE_TEST_SIMD
+namespace {
+
+using namespace sage;
+
+#if SAGE_SIMD_X86
+[[gnu::target("avx2")]]
+auto sincos_avx2(const std::vector<float>& angles, std::vector<float>& sines, std::vector<float>& cosines) -> void {
+	for (auto i = 0ul; i < angles.size(); i += 8) {
+		const auto [s, c] = simd::sincos(_mm256_loadu_ps(angles.data() + i));
+		_mm256_storeu_ps(sines.data() + i, s);
+		_mm256_storeu_ps(cosines.data() + i, c);
+	}
+}
+#endif
+
+TEST_CASE ("SIMD sincos") {
+	constexpr auto n = 4096ul;
+
+	auto angles = std::vector<float>(n);
+	for (const auto [i, a] : angles | vw::enumerate)
+		a = -1000.f + 2000.f * static_cast<float>(i) / n;	// A few hundred turns both ways
+
+	const auto check = [&] (const auto& sines, const auto& cosines) {
+		for (const auto i : vw::iota(0ul, n)) {
+			CHECK_LT(std::abs(sines[i] - std::sin(angles[i])), 1e-5f);
+			CHECK_LT(std::abs(cosines[i] - std::cos(angles[i])), 1e-5f);
+		}
+	};
+
+	auto sines = std::vector<float>(n), cosines = std::vector<float>(n);
+
+	#if SAGE_SIMD_X86
+	for (auto i = 0ul; i < n; i += 4) {
+		const auto [s, c] = simd::sincos(_mm_loadu_ps(angles.data() + i));
+		_mm_storeu_ps(sines.data() + i, s);
+		_mm_storeu_ps(cosines.data() + i, c);
+	}
+	check(sines, cosines);
+
+	if (simd::level() == simd::Level::AVX2) {
+		rg::fill(sines, 0.f);
+		rg::fill(cosines, 0.f);
+
+		sincos_avx2(angles, sines, cosines);
+		check(sines, cosines);
+	}
+	#endif
+
+	CHECK_GE(simd::lanes(simd::level()), 1);
+	CHECK_EQ(fmt::format("{}", simd::Level::AVX2), "AVX2");
+}
+
+}
+#endif
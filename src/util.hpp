@@ -83,6 +83,42 @@ constexpr auto trim(std::string& s, const char to_trim = ' ') -> void {
 template<std::integral I>
 constexpr auto bits = sizeof(I) * 8;
 
+// Stable LSD radix sort of `items` by an unsigned key, a byte per pass. Passes over a byte that is the
+// same in every key are skipped, so a few distinct layers or textures cost few passes.
+//
+// `scratch` is only used to hold items between passes, keep it around to not reallocate.
+template <typename T, typename Key>
+	requires std::unsigned_integral<std::invoke_result_t<Key&, const T&>>
+auto radix_sort(std::vector<T>& items, std::vector<T>& scratch, Key&& key) -> void {
+	using K = std::invoke_result_t<Key&, const T&>;
+	constexpr auto passes = sizeof(K);
+
+	auto counts = std::array<std::array<size_t, 256>, passes>{};
+	for (const auto& item : items) {
+		const auto k = std::invoke(key, item);
+		for (const auto pass : vw::iota(0ul, passes))
+			++counts[pass][(k >> (pass * 8)) & 0xff];
+	}
+
+	scratch.resize(items.size());
+
+	for (const auto pass : vw::iota(0ul, passes)) {
+		auto& count = counts[pass];
+		if (rg::any_of(count, [n = items.size()] (const auto c) { return c == n; }))
+			continue;
+
+		// Counts to offsets
+		auto offset = 0ul;
+		for (auto& c : count)
+			offset += std::exchange(c, offset);
+
+		for (auto& item : items)
+			scratch[count[(std::invoke(key, item) >> (pass * 8)) & 0xff]++] = std::move(item);
+
+		std::swap(items, scratch);
+	}
+}
+
 // Use with care because there may still be a race.
 // Prefer using it when the atomic is strictly encapsulated/controlled,
 // and externals only read it (see window::Base).
@@ -232,6 +268,14 @@ using Front = At<0, Ts...>;
 template <typename... Ts>
 using Back = At<sizeof...(Ts) - 1, Ts...>;
 
+// Position of the first Needle in Haystack
+template <typename Needle, typename... Haystack>
+	requires Any<Needle, Haystack...>
+consteval auto index_of() -> size_t {
+	constexpr bool same[] = { std::same_as<Needle, Haystack>... };
+	return static_cast<size_t>(std::ranges::find(same, true) - std::ranges::begin(same));
+}
+
 }// type::comp
 
 using Real_Name_Ptr = std::unique_ptr<char, decltype([] (auto ptr) { std::free(ptr); })>;
@@ -360,7 +404,8 @@ public:
 		return std::tuple_size_v<Base>;
 	}
 
-	constexpr auto front() -> std::tuple_element_t<0, Base>& {
+	// Deduced so that an empty Polymorphic_Array can still be instantiated
+	constexpr auto front() -> decltype(auto) {
 		return std::get<0>(*this);
 	}
 
@@ -420,16 +465,17 @@ struct std::tuple_element<I, sage::util::Polymorphic_Array<Ts...>>
 
 namespace sage::inline util {
 
+// A vector per type, allocated from a std::pmr::memory_resource, the default one unless given
 template <typename... Ts>
 	requires type::Unique<Ts...>
-struct Polymorphic_Storage : Polymorphic_Container_Base<std::vector<Ts>...> {
+struct Polymorphic_Storage : Polymorphic_Container_Base<std::pmr::vector<Ts>...> {
 	using Types = type::Set<Ts...>;
 
 	template <typename Q>
-	using Vector = std::vector<Q>;
+	using Vector = std::pmr::vector<Q>;
 
 	template <typename Q>
-	using Reference = std::vector<Q>&;
+	using Reference = Vector<Q>&;
 
 	using Forward_Tuple = std::tuple<
 			typename Vector<Ts>::reference
@@ -450,10 +496,16 @@ struct Polymorphic_Storage : Polymorphic_Container_Base<std::vector<Ts>...> {
 
 public:
 	constexpr
-	Polymorphic_Storage(const size_t size) {
+	Polymorphic_Storage(const size_t size, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: Base{Vector<Ts>(resource)...}
+	{
 		resize(size);
 	}
 
+	constexpr auto resource() const -> std::pmr::memory_resource* {
+		return std::get<0>(*this).get_allocator().resource();
+	}
+
 public:
 	constexpr auto size() const -> size_t {
 		return std::apply(
@@ -499,7 +551,7 @@ public:
 };
 
 template <typename... Ts>
-Polymorphic_Storage(std::vector<Ts>&&...) -> Polymorphic_Storage<Ts...>;
+Polymorphic_Storage(std::pmr::vector<Ts>&&...) -> Polymorphic_Storage<Ts...>;
 
 }// sage::util
 
@@ -597,6 +649,10 @@ TEST_CASE ("Type") {
 	CHECK_EQ(type::Unique<int, float, int>,	false);
 	CHECK_EQ(type::Unique<int, double>,		true);
 
+	CHECK_EQ(type::index_of<int, int>(),				0);
+	CHECK_EQ(type::index_of<int, float, int>(),			1);
+	CHECK_EQ(type::index_of<int, float, double, int>(),	2);
+
 	// TODO: Weird behaviour for Set<>::count<>()
 	//CHECK_EQ(type::Set<>					::template count<>(), std::tuple{});
 	CHECK_EQ(type::Set<>					::template count<int>(),						std::tuple{});
@@ -683,6 +739,41 @@ TEST_CASE ("Polymorphic_Storage") {
 					FAIL("Unexpected type in Polymorphic_Array");
 			});
 	}
+
+	SUBCASE ("Memory resource") {
+		auto buffer = std::array<std::byte, 4096>{};
+		auto resource = std::pmr::monotonic_buffer_resource{buffer.data(), buffer.size(), std::pmr::null_memory_resource()};
+
+		auto storage = Storage{10, &resource};
+		CHECK_EQ(storage.resource(), &resource);
+		CHECK_EQ(storage.size(), 30);
+
+		storage.apply_group([&] (const auto& vec) {
+				const auto* data = reinterpret_cast<const std::byte*>(vec.data());
+				CHECK(data >= buffer.data());
+				CHECK(data < buffer.data() + buffer.size());
+			});
+	}
+}
+
+TEST_CASE ("radix_sort") {
+	auto items = std::vector<std::pair<uint64_t, size_t>>{};
+	for (const auto i : vw::iota(0ul, 1000ul))
+		items.emplace_back((i * 7919) % 13 << 40 | (i % 3), i);	// Two bytes differ, duplicates keep their order
+
+	auto expected = items;
+	rg::stable_sort(expected, {}, &std::pair<uint64_t, size_t>::first);
+
+	auto scratch = decltype(items){};
+	radix_sort(items, scratch, [] (const auto& item) { return item.first; });
+	CHECK_EQ(items, expected);
+
+	radix_sort(items, scratch, [] (const auto& item) { return item.first; });
+	CHECK_EQ(items, expected);
+
+	auto empty = decltype(items){};
+	radix_sort(empty, scratch, [] (const auto& item) { return item.first; });
+	CHECK(empty.empty());
 }
 
 TEST_CASE ("toogle_if") {
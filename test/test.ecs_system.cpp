@@ -0,0 +1,2 @@
+#include "test/doctest.hpp"
+#include "src/ecs_system.hpp"